@@ -0,0 +1,49 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include "Engine2D.h"
+
+#define NUM_FRAMES 10
+#define NUM_GIANTS 16
+#define WORLD_WIDTH 1280
+#define WORLD_HEIGHT 720
+#define SMALL_RADIUS 1
+#define GIANT_RADIUS 64
+#define MASS 10000
+#define SPEED 32
+
+// Times collision detection without gravity among thousands of small circles and a few giant ones, the mix
+// that inelastic merging leaves behind. Build it with and without -DENGINE2D_NO_SIZE_GRID (see 'make bench')
+// to compare against the pair loops.
+int main()
+{
+    const int body_counts[] = {2000, 10000, 20000};
+#ifdef ENGINE2D_NO_SIZE_GRID
+    printf("pair loops, ");
+#else
+    printf("size grid, ");
+#endif
+    printf("%s precision, %d giants, %d frames\n", sizeof(REAL) == sizeof(float) ? "single" : "double", NUM_GIANTS, NUM_FRAMES);
+    for (size_t n = 0; n < SDL_arraysize(body_counts); n++)
+    {
+        ENGINE_2D_CONFIG config = Engine2D_DefaultConfig();
+        config.world_width = WORLD_WIDTH;
+        config.world_height = WORLD_HEIGHT;
+        config.seed = 1;
+        ENGINE_2D *engine = Engine2D_InitWithConfig(config, NULL, NULL, NULL, 30, ELASTIC_COLLISION | BOUNDING_BOX);
+        RANDOM *rng = Engine2D_GetRandom(engine);
+        for (int i = 0; i < body_counts[n]; i++)
+        {
+            double radius = i < NUM_GIANTS ? GIANT_RADIUS : SMALL_RADIUS;
+            VECTOR_2D pos = {Random_Unit(rng) * WORLD_WIDTH, Random_Unit(rng) * WORLD_HEIGHT};
+            VECTOR_2D vel = {(2 * Random_Unit(rng) - 1) * SPEED, (2 * Random_Unit(rng) - 1) * SPEED};
+            Engine2D_CreateCircleObject(engine, RGB_WHITE, radius, (PHYS_BODY){MASS * radius * radius, pos, vel});
+        }
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int frame = 0; frame < NUM_FRAMES; frame++)
+            Engine2D_RunSimulation(engine);
+        double ms = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000 / NUM_FRAMES;
+        printf("%d bodies\t%.3lf ms/frame\tchecksum %016llx\n", body_counts[n], ms, (unsigned long long)Engine2D_Checksum(engine));
+        Engine2D_Free(engine);
+    }
+    return 0;
+}
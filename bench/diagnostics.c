@@ -0,0 +1,59 @@
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include "Engine2D.h"
+
+#define NUM_FRAMES 50
+#define WORLD_WIDTH 1280
+#define WORLD_HEIGHT 720
+#define WORLD_SCALE 8
+#define RADIUS 2
+#define MASS 10000
+#define SPEED 4
+
+// Times gravity through the pair tiles and through Barnes-Hut with and without the diagnostics, then checks the
+// potential energy they add up against the separate pass over every pair that Engine2D_GetStats makes.
+int main()
+{
+    const int methods[] = {0, BARNES_HUT};
+    const int num_bodies[] = {4000, 20000};
+    for (size_t m = 0; m < SDL_arraysize(methods); m++)
+    {
+        printf("diagnostics, %s, %d bodies, %d frames\n", methods[m] ? "barnes-hut" : "pair tiles", num_bodies[m], NUM_FRAMES);
+        for (int diagnostics = 0; diagnostics <= 1; diagnostics++)
+        {
+            ENGINE_2D_CONFIG config = Engine2D_DefaultConfig();
+            config.world_width = WORLD_WIDTH;
+            config.world_height = WORLD_HEIGHT;
+            config.buffer_zone = INFINITY;
+            config.seed = 1;
+            int flags = ELASTIC_COLLISION | ENABLE_GRAVITY | methods[m] | (diagnostics ? DIAGNOSTICS : 0);
+            ENGINE_2D *engine = Engine2D_InitWithConfig(config, NULL, NULL, NULL, 30, flags);
+            RANDOM *rng = Engine2D_GetRandom(engine);
+            for (int i = 0; i < num_bodies[m]; i++)
+            {
+                VECTOR_2D pos = {Random_Unit(rng) * WORLD_WIDTH * WORLD_SCALE, Random_Unit(rng) * WORLD_HEIGHT * WORLD_SCALE};
+                VECTOR_2D vel = {(2 * Random_Unit(rng) - 1) * SPEED, (2 * Random_Unit(rng) - 1) * SPEED};
+                Engine2D_CreateCircleObject(engine, RGB_WHITE, RADIUS, (PHYS_BODY){MASS, pos, vel});
+            }
+            Uint64 start = SDL_GetPerformanceCounter();
+            for (int frame = 0; frame < NUM_FRAMES; frame++)
+                Engine2D_RunSimulation(engine);
+            double ms = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000 / NUM_FRAMES;
+            printf("%s\t%.3lf ms/frame\n", diagnostics ? "diagnostics on " : "diagnostics off", ms);
+            if (diagnostics)
+            {
+                // the diagnostics describe the state at the start of the step, which is the state the stats see
+                start = SDL_GetPerformanceCounter();
+                ENGINE_2D_STATS stats = Engine2D_GetStats(engine);
+                ms = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000;
+                Engine2D_RunSimulation(engine);
+                ENGINE_2D_DIAGNOSTICS found = Engine2D_GetDiagnostics(engine);
+                printf("separate pass\t%.3lf ms\tpotential energy off by %.2e\n", ms,
+                       fabs(found.potential_energy - stats.potential_energy) / fabs(stats.potential_energy));
+            }
+            Engine2D_Free(engine);
+        }
+    }
+    return 0;
+}
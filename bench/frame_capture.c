@@ -0,0 +1,46 @@
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include "Engine2D.h"
+
+#define NUM_FRAMES 300
+#define VIEW_WIDTH 1280
+#define VIEW_HEIGHT 720
+#define NUM_BODIES 2000
+#define RADIUS 4
+#define MASS 10000
+#define SPEED 200
+// a pipe into another process, the way frames would go to an encoder
+#define CAPTURE_PATH "|cat > /dev/null"
+
+// Times stepping and drawing with the rasterizer headless without capturing frames, capturing every one of them
+// through a pipe and dropping those the writer can't keep up with, and capturing them all by waiting on the writer.
+int main()
+{
+    const char *modes[] = {"no capture", "capture, dropping", "capture, throttled"};
+    printf("frame capture, %d bodies, %dx%d frames, %d frames\n", NUM_BODIES, VIEW_WIDTH, VIEW_HEIGHT, NUM_FRAMES);
+    for (size_t m = 0; m < SDL_arraysize(modes); m++)
+    {
+        ENGINE_2D_CONFIG config = Engine2D_DefaultConfig();
+        config.world_width = VIEW_WIDTH;
+        config.world_height = VIEW_HEIGHT;
+        config.seed = 1;
+        ENGINE_2D *engine = Engine2D_InitWithConfig(config, NULL, NULL, NULL, 30, ELASTIC_COLLISION | BOUNDING_BOX | SOFTWARE_RENDER);
+        RANDOM *rng = Engine2D_GetRandom(engine);
+        for (int i = 0; i < NUM_BODIES; i++)
+        {
+            VECTOR_2D pos = {Random_Unit(rng) * VIEW_WIDTH, Random_Unit(rng) * VIEW_HEIGHT};
+            VECTOR_2D vel = {(2 * Random_Unit(rng) - 1) * SPEED, (2 * Random_Unit(rng) - 1) * SPEED};
+            Engine2D_CreateCircleObject(engine, RGB_WHITE, RADIUS, (PHYS_BODY){MASS, pos, vel});
+        }
+        if (m > 0 && Engine2D_StartCapture(engine, CAPTURE_PATH, 1, m == 2) != 0)
+            return 1;
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int frame = 0; frame < NUM_FRAMES; frame++)
+            Engine2D_RunSimulation(engine);
+        double ms = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000 / NUM_FRAMES;
+        printf("%s\t%.3lf ms/frame\n", modes[m], ms);
+        Engine2D_Free(engine);
+    }
+    return 0;
+}
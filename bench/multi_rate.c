@@ -0,0 +1,53 @@
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include "Engine2D.h"
+
+#define NUM_FRAMES 100
+#define VIEW_WIDTH 1280
+#define VIEW_HEIGHT 720
+// the bodies are spread over this many views in each direction, the view looking at the one in the middle
+#define WORLD_SCALE 8
+#define NUM_BODIES 10000
+#define RADIUS 2
+#define MASS 10000
+#define SPEED 4
+
+// Times Barnes-Hut gravity over a world far larger than the view with every body pulled on every frame, and with
+// the bodies outside the view pulled on every few frames, comparing how far the total energy drifts in each.
+int main()
+{
+    const int modes[] = {0, MULTI_RATE};
+    printf("multi-rate stepping, %d bodies over %dx%d views, %d frames\n", NUM_BODIES, WORLD_SCALE, WORLD_SCALE, NUM_FRAMES);
+    for (size_t m = 0; m < SDL_arraysize(modes); m++)
+    {
+        ENGINE_2D_CONFIG config = Engine2D_DefaultConfig();
+        config.world_width = VIEW_WIDTH;
+        config.world_height = VIEW_HEIGHT;
+        config.buffer_zone = INFINITY;
+        config.seed = 1;
+        ENGINE_2D *engine = Engine2D_InitWithConfig(config, NULL, NULL, NULL, 30, ELASTIC_COLLISION | ENABLE_GRAVITY | BARNES_HUT | modes[m]);
+        RANDOM *rng = Engine2D_GetRandom(engine);
+        for (int i = 0; i < NUM_BODIES; i++)
+        {
+            VECTOR_2D pos = {
+                (Random_Unit(rng) - 0.5) * VIEW_WIDTH * WORLD_SCALE + VIEW_WIDTH / 2.0,
+                (Random_Unit(rng) - 0.5) * VIEW_HEIGHT * WORLD_SCALE + VIEW_HEIGHT / 2.0,
+            };
+            VECTOR_2D vel = {(2 * Random_Unit(rng) - 1) * SPEED, (2 * Random_Unit(rng) - 1) * SPEED};
+            Engine2D_CreateCircleObject(engine, RGB_WHITE, RADIUS, (PHYS_BODY){MASS, pos, vel});
+        }
+        ENGINE_2D_STATS before = Engine2D_GetStats(engine);
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int frame = 0; frame < NUM_FRAMES; frame++)
+            Engine2D_RunSimulation(engine);
+        double ms = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000 / NUM_FRAMES;
+        ENGINE_2D_STATS after = Engine2D_GetStats(engine);
+        double energy_before = before.kinetic_energy + before.potential_energy;
+        double energy_after = after.kinetic_energy + after.potential_energy;
+        printf("%s\t%.3lf ms/frame\tenergy drift %.2e\n", modes[m] ? "multi-rate" : "full rate ",
+               ms, fabs(energy_after - energy_before) / fabs(energy_before));
+        Engine2D_Free(engine);
+    }
+    return 0;
+}
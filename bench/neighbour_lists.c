@@ -0,0 +1,53 @@
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include "Engine2D.h"
+
+#define NUM_FRAMES 100
+#define WORLD_WIDTH 1280
+#define WORLD_HEIGHT 720
+#define RADIUS 1
+#define MASS 10000
+#define SPEED 4
+
+// Times collision detection without gravity among circles packed close together that drift a fraction of a pixel per
+// frame, finding the pairs anew every frame and then reusing neighbour lists, which should end in the same state.
+int main()
+{
+    const int body_counts[] = {2000, 10000, 20000};
+    const int modes[] = {0, NEIGHBOUR_LISTS};
+    printf("size grid against neighbour lists, %s precision, %d frames\n", sizeof(REAL) == sizeof(float) ? "single" : "double", NUM_FRAMES);
+    for (size_t n = 0; n < SDL_arraysize(body_counts); n++)
+    {
+        // a jittered lattice, so the circles start apart however many there are
+        double spacing = sqrt((double)WORLD_WIDTH * WORLD_HEIGHT / body_counts[n]);
+        int columns = WORLD_WIDTH / spacing;
+        for (size_t m = 0; m < SDL_arraysize(modes); m++)
+        {
+            ENGINE_2D_CONFIG config = Engine2D_DefaultConfig();
+            config.world_width = WORLD_WIDTH;
+            config.world_height = WORLD_HEIGHT;
+            config.seed = 1;
+            ENGINE_2D *engine = Engine2D_InitWithConfig(config, NULL, NULL, NULL, 30, ELASTIC_COLLISION | BOUNDING_BOX | modes[m]);
+            RANDOM *rng = Engine2D_GetRandom(engine);
+            for (int i = 0; i < body_counts[n]; i++)
+            {
+                double jitter = (spacing - 2 * RADIUS) / 2;
+                VECTOR_2D pos = {
+                    (i % columns + 0.5) * spacing + (2 * Random_Unit(rng) - 1) * jitter,
+                    (i / columns + 0.5) * spacing + (2 * Random_Unit(rng) - 1) * jitter,
+                };
+                VECTOR_2D vel = {(2 * Random_Unit(rng) - 1) * SPEED, (2 * Random_Unit(rng) - 1) * SPEED};
+                Engine2D_CreateCircleObject(engine, RGB_WHITE, RADIUS, (PHYS_BODY){MASS, pos, vel});
+            }
+            Uint64 start = SDL_GetPerformanceCounter();
+            for (int frame = 0; frame < NUM_FRAMES; frame++)
+                Engine2D_RunSimulation(engine);
+            double ms = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000 / NUM_FRAMES;
+            printf("%d bodies, %s\t%.3lf ms/frame\tchecksum %016llx\n", body_counts[n], modes[m] ? "lists" : "grid ",
+                   ms, (unsigned long long)Engine2D_Checksum(engine));
+            Engine2D_Free(engine);
+        }
+    }
+    return 0;
+}
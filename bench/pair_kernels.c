@@ -0,0 +1,50 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include "Engine2D.h"
+
+#define NUM_FRAMES 10
+#define WORLD_WIDTH 1280
+#define WORLD_HEIGHT 720
+#define RADIUS 1
+#define MASS 10000
+
+// Times the all pairs gravity pass headless for a few body counts, on one thread and on every CPU.
+// Build it with and without -DENGINE2D_UNTILED_PAIRS (see 'make bench') to compare against the plain pair loop.
+int main()
+{
+    const int body_counts[] = {2000, 5000, 10000};
+    const int thread_counts[] = {1, 0};
+#ifdef ENGINE2D_UNTILED_PAIRS
+    printf("plain pair loop, ");
+#else
+    printf("tiled pair kernel, ");
+#endif
+    printf("%s precision, %d frames\n", sizeof(REAL) == sizeof(float) ? "single" : "double", NUM_FRAMES);
+    for (size_t n = 0; n < SDL_arraysize(body_counts); n++)
+    {
+        for (size_t t = 0; t < SDL_arraysize(thread_counts); t++)
+        {
+            ENGINE_2D_CONFIG config = Engine2D_DefaultConfig();
+            config.world_width = WORLD_WIDTH;
+            config.world_height = WORLD_HEIGHT;
+            config.num_threads = thread_counts[t];
+            config.seed = 1;
+            ENGINE_2D *engine = Engine2D_InitWithConfig(config, NULL, NULL, NULL, 30, ENABLE_GRAVITY);
+            RANDOM *rng = Engine2D_GetRandom(engine);
+            for (int i = 0; i < body_counts[n]; i++)
+            {
+                VECTOR_2D pos = {Random_Unit(rng) * WORLD_WIDTH, Random_Unit(rng) * WORLD_HEIGHT};
+                VECTOR_2D vel = {0, 0};
+                Engine2D_CreateCircleObject(engine, RGB_WHITE, RADIUS, (PHYS_BODY){MASS, pos, vel});
+            }
+            Uint64 start = SDL_GetPerformanceCounter();
+            for (int frame = 0; frame < NUM_FRAMES; frame++)
+                Engine2D_RunSimulation(engine);
+            double ms = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000 / NUM_FRAMES;
+            printf("%d bodies, %s\t%.3lf ms/frame\tchecksum %016llx\n", body_counts[n],
+                   thread_counts[t] == 1 ? "1 thread " : "all CPUs", ms, (unsigned long long)Engine2D_Checksum(engine));
+            Engine2D_Free(engine);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "Quadtree.h"
+#include "Random.h"
+
+#define NUM_BUILDS 10
+#define WORLD_WIDTH 1280
+#define WORLD_HEIGHT 720
+
+void sortAlongMortonCurve(REAL *x, REAL *y, int n);
+
+// Times Quadtree_Build on uniformly scattered points, on one thread and on every CPU, first in random order and
+// then in the Morton order the engine keeps its circles in when spatial sorting is on.
+int main()
+{
+    const int point_counts[] = {100000, 1000000};
+    const int thread_counts[] = {1, 0};
+    printf("quadtree build, %s precision, %d builds\n", sizeof(REAL) == sizeof(float) ? "single" : "double", NUM_BUILDS);
+    for (size_t n = 0; n < SDL_arraysize(point_counts); n++)
+    {
+        int num_points = point_counts[n];
+        REAL *x = (REAL *)malloc(num_points * sizeof(REAL)), *y = (REAL *)malloc(num_points * sizeof(REAL));
+        REAL *mass = (REAL *)malloc(num_points * sizeof(REAL)), *radius = (REAL *)malloc(num_points * sizeof(REAL));
+        RANDOM rng;
+        Random_Seed(&rng, 1);
+        for (int i = 0; i < num_points; i++)
+        {
+            x[i] = Random_Unit(&rng) * WORLD_WIDTH;
+            y[i] = Random_Unit(&rng) * WORLD_HEIGHT;
+            mass[i] = 1;
+            radius[i] = 1;
+        }
+        for (size_t t = 0; t < 2 * SDL_arraysize(thread_counts); t++)
+        {
+            if (t == SDL_arraysize(thread_counts))
+                sortAlongMortonCurve(x, y, num_points);
+            int num_threads = thread_counts[t % SDL_arraysize(thread_counts)];
+            THREAD_POOL *pool = ThreadPool_Init(num_threads > 0 ? num_threads : SDL_GetCPUCount());
+            QUADTREE *tree = Quadtree_Init();
+            Quadtree_Build(tree, pool, x, y, mass, radius, num_points);
+            Uint64 start = SDL_GetPerformanceCounter();
+            for (int build = 0; build < NUM_BUILDS; build++)
+                Quadtree_Build(tree, pool, x, y, mass, radius, num_points);
+            double ms = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000 / NUM_BUILDS;
+            printf("%d %s points, %d threads\t%.3lf ms/build\t%d nodes, %d levels\n",
+                   num_points, t < SDL_arraysize(thread_counts) ? "scattered" : "ordered", ThreadPool_Size(pool), ms,
+                   tree->num_nodes, tree->num_levels);
+            Quadtree_Free(tree);
+            ThreadPool_Free(pool);
+        }
+        free(x);
+        free(y);
+        free(mass);
+        free(radius);
+    }
+    return 0;
+}
+
+// puts the points in the order a build sorts them into
+void sortAlongMortonCurve(REAL *x, REAL *y, int n)
+{
+    REAL *unit = (REAL *)malloc(n * sizeof(REAL));
+    for (int i = 0; i < n; i++)
+        unit[i] = 1;
+    QUADTREE *tree = Quadtree_Init();
+    Quadtree_Build(tree, NULL, x, y, unit, unit, n);
+    SDL_memcpy(x, tree->x, n * sizeof(REAL));
+    SDL_memcpy(y, tree->y, n * sizeof(REAL));
+    Quadtree_Free(tree);
+    free(unit);
+}
@@ -0,0 +1,150 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "Rasterizer.h"
+#include "Random.h"
+
+#define NUM_FRAMES 10
+#define FRAME_WIDTH 1280
+#define FRAME_HEIGHT 720
+#define MIN_RADIUS 8
+#define MAX_RADIUS 16
+#define NUM_TINY_CIRCLES 1000000
+#define MAX_TINY_RADIUS 2
+
+uint32_t fillCirclesPerPixel(uint32_t *pixels, const int *x, const int *y, const int *radius, const uint32_t *color, int n);
+uint32_t hashFrame(const uint32_t *pixels, int n);
+void timeLevelsOfDetail(uint32_t *pixels);
+
+// Times Rasterizer_Draw headless on one thread and on every CPU against filling each circle pixel by pixel with a
+// square root per pixel, the way RenderFillCircle decides which points to draw. Both should give the same frame.
+// Then draws a million circles a few pixels wide whole, as splats and as a heat map.
+int main()
+{
+    const int circle_counts[] = {1000, 10000, 100000};
+    const int thread_counts[] = {1, 0};
+    uint32_t *pixels = (uint32_t *)malloc(FRAME_WIDTH * FRAME_HEIGHT * sizeof(uint32_t));
+    printf("rasterizer, %dx%d frame, %d frames\n", FRAME_WIDTH, FRAME_HEIGHT, NUM_FRAMES);
+    for (size_t n = 0; n < SDL_arraysize(circle_counts); n++)
+    {
+        int num_circles = circle_counts[n];
+        int *x = (int *)malloc(num_circles * sizeof(int)), *y = (int *)malloc(num_circles * sizeof(int));
+        int *radius = (int *)malloc(num_circles * sizeof(int));
+        uint32_t *color = (uint32_t *)malloc(num_circles * sizeof(uint32_t));
+        RANDOM rng;
+        Random_Seed(&rng, 1);
+        for (int i = 0; i < num_circles; i++)
+        {
+            x[i] = Random_Range(&rng, 0, FRAME_WIDTH);
+            y[i] = Random_Range(&rng, 0, FRAME_HEIGHT);
+            radius[i] = Random_Range(&rng, MIN_RADIUS, MAX_RADIUS);
+            color[i] = 0xFF000000u | (uint32_t)Random_Range(&rng, 0, 0xFFFFFF);
+        }
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        uint32_t hash = 0;
+        for (int frame = 0; frame < NUM_FRAMES; frame++)
+            hash = fillCirclesPerPixel(pixels, x, y, radius, color, num_circles);
+        double ms = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000 / NUM_FRAMES;
+        printf("%d circles, per pixel\t%.3lf ms/frame\tframe %08x\n", num_circles, ms, hash);
+
+        for (size_t t = 0; t < SDL_arraysize(thread_counts); t++)
+        {
+            THREAD_POOL *pool = ThreadPool_Init(thread_counts[t] > 0 ? thread_counts[t] : SDL_GetCPUCount());
+            RASTERIZER *raster = Rasterizer_Init();
+            start = SDL_GetPerformanceCounter();
+            for (int frame = 0; frame < NUM_FRAMES; frame++)
+            {
+                Rasterizer_Begin(raster);
+                for (int i = 0; i < num_circles; i++)
+                    Rasterizer_AddCircle(raster, x[i], y[i], radius[i], color[i]);
+                Rasterizer_Draw(raster, pool, pixels, FRAME_WIDTH * sizeof(uint32_t), FRAME_WIDTH, FRAME_HEIGHT, 0xFF000000u);
+            }
+            ms = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000 / NUM_FRAMES;
+            printf("%d circles, %d threads\t%.3lf ms/frame\tframe %08x\n", num_circles, ThreadPool_Size(pool), ms,
+                   hashFrame(pixels, FRAME_WIDTH * FRAME_HEIGHT));
+            Rasterizer_Free(raster);
+            ThreadPool_Free(pool);
+        }
+        free(x);
+        free(y);
+        free(radius);
+        free(color);
+    }
+    timeLevelsOfDetail(pixels);
+    free(pixels);
+    return 0;
+}
+
+void timeLevelsOfDetail(uint32_t *pixels)
+{
+    const int lods[] = {RASTERIZER_LOD_OFF, RASTERIZER_LOD_SPLATS, RASTERIZER_LOD_HEAT_MAP};
+    const char *lod_names[] = {"whole", "splats", "heat map"};
+    double *x = (double *)malloc(NUM_TINY_CIRCLES * sizeof(double)), *y = (double *)malloc(NUM_TINY_CIRCLES * sizeof(double));
+    double *radius = (double *)malloc(NUM_TINY_CIRCLES * sizeof(double));
+    RANDOM rng;
+    Random_Seed(&rng, 1);
+    for (int i = 0; i < NUM_TINY_CIRCLES; i++)
+    {
+        // bunched up towards the centre, the way a galaxy would be
+        x[i] = (Random_Unit(&rng) + Random_Unit(&rng) + Random_Unit(&rng)) / 3 * FRAME_WIDTH;
+        y[i] = (Random_Unit(&rng) + Random_Unit(&rng) + Random_Unit(&rng)) / 3 * FRAME_HEIGHT;
+        radius[i] = Random_Unit(&rng) * MAX_TINY_RADIUS;
+    }
+    THREAD_POOL *pool = ThreadPool_Init(SDL_GetCPUCount());
+    for (size_t l = 0; l < SDL_arraysize(lods); l++)
+    {
+        RASTERIZER *raster = Rasterizer_Init();
+        // a radius no circle reaches puts all of them under the level of detail
+        Rasterizer_SetLevelOfDetail(raster, lods[l], MAX_TINY_RADIUS + 1);
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int frame = 0; frame < NUM_FRAMES; frame++)
+        {
+            Rasterizer_Begin(raster);
+            for (int i = 0; i < NUM_TINY_CIRCLES; i++)
+                Rasterizer_AddCircle(raster, x[i], y[i], radius[i], 0xFFFFFFFFu);
+            Rasterizer_Draw(raster, pool, pixels, FRAME_WIDTH * sizeof(uint32_t), FRAME_WIDTH, FRAME_HEIGHT, 0xFF000000u);
+        }
+        double ms = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000 / NUM_FRAMES;
+        printf("%d tiny circles, %s, %d threads\t%.3lf ms/frame\n", NUM_TINY_CIRCLES, lod_names[l], ThreadPool_Size(pool), ms);
+        Rasterizer_Free(raster);
+    }
+    ThreadPool_Free(pool);
+    free(x);
+    free(y);
+    free(radius);
+}
+
+uint32_t fillCirclesPerPixel(uint32_t *pixels, const int *x, const int *y, const int *radius, const uint32_t *color, int n)
+{
+    for (int p = 0; p < FRAME_WIDTH * FRAME_HEIGHT; p++)
+        pixels[p] = 0xFF000000u;
+    for (int c = 0; c < n; c++)
+    {
+        for (int i = x[c] - radius[c]; i <= x[c] + radius[c]; i++)
+        {
+            if (i < 0 || i >= FRAME_WIDTH)
+                continue;
+            for (int j = y[c] - radius[c]; j <= y[c] + radius[c]; j++)
+            {
+                if (j < 0 || j >= FRAME_HEIGHT)
+                    continue;
+                if (SDL_sqrt((double)(i - x[c]) * (i - x[c]) + (double)(j - y[c]) * (j - y[c])) <= radius[c])
+                    pixels[j * FRAME_WIDTH + i] = color[c];
+            }
+        }
+    }
+    return hashFrame(pixels, FRAME_WIDTH * FRAME_HEIGHT);
+}
+
+// FNV-1a over the pixels
+uint32_t hashFrame(const uint32_t *pixels, int n)
+{
+    uint32_t hash = 2166136261u;
+    for (int p = 0; p < n; p++)
+    {
+        hash ^= pixels[p];
+        hash *= 16777619u;
+    }
+    return hash;
+}
@@ -0,0 +1,96 @@
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "Engine2D.h"
+
+#define NUM_FRAMES 150
+#define CHECK_INTERVAL 10
+#define WORLD_WIDTH 1280
+#define WORLD_HEIGHT 720
+#define RADIUS 0.5
+#define MASS 100000
+#define NUM_BODIES 1500
+#define SPEED 20
+// binaries on a grid far enough apart not to fall together in the frames timed, each starting at the far end of an
+// orbit of this eccentricity
+#define BINARY_SPACING 128
+#define BINARY_SEPARATION 12
+#define BINARY_ECCENTRICITY 0.7
+#define G 6.674e-11
+
+void createCluster(ENGINE_2D *engine);
+void createBinaries(ENGINE_2D *engine);
+
+// Times a cluster collapsing under its own gravity and a field of eccentric binaries at 30 frames a second with plain
+// gravity, each softening kernel and close pairs integrated through the step, and reports how far the total energy
+// strays on the way, as a fraction of the kinetic energy plus the size of the potential energy at the start.
+int main()
+{
+    const char *modes[] = {
+        "",
+        "set --softening plummer --softening-length 4",
+        "set --softening spline --softening-length 4",
+        "set --close-gap 16",
+    };
+    const char *names[] = {"newtonian   ", "plummer     ", "spline      ", "close pairs "};
+    const char *scenes[] = {"cluster", "binaries"};
+    void (*create[])(ENGINE_2D *) = {createCluster, createBinaries};
+    for (size_t s = 0; s < SDL_arraysize(scenes); s++)
+    {
+        printf("softening, %s, %d frames\n", scenes[s], NUM_FRAMES);
+        for (size_t m = 0; m < SDL_arraysize(modes); m++)
+        {
+            ENGINE_2D_CONFIG config = Engine2D_DefaultConfig();
+            config.world_width = WORLD_WIDTH;
+            config.world_height = WORLD_HEIGHT;
+            config.seed = 1;
+            ENGINE_2D *engine = Engine2D_InitWithConfig(config, NULL, NULL, NULL, 30, ELASTIC_COLLISION | ENABLE_GRAVITY | BOUNDING_BOX);
+            create[s](engine);
+            Engine2D_RunCommands(engine, modes[m], strlen(modes[m]), "bench");
+            ENGINE_2D_STATS start_stats = Engine2D_GetStats(engine);
+            double start_energy = start_stats.kinetic_energy + start_stats.potential_energy;
+            double scale = start_stats.kinetic_energy + fabs(start_stats.potential_energy);
+            double drift = 0, ms = 0;
+            for (int frame = 0; frame < NUM_FRAMES; frame++)
+            {
+                Uint64 start = SDL_GetPerformanceCounter();
+                Engine2D_RunSimulation(engine);
+                ms += (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000;
+                if ((frame + 1) % CHECK_INTERVAL != 0)
+                    continue;
+                ENGINE_2D_STATS stats = Engine2D_GetStats(engine);
+                drift = fmax(drift, fabs(stats.kinetic_energy + stats.potential_energy - start_energy) / scale);
+            }
+            printf("%s\t%.3lf ms/frame\tenergy drift up to %.3g\n", names[m], ms / NUM_FRAMES, drift);
+            Engine2D_Free(engine);
+        }
+    }
+    return 0;
+}
+
+void createCluster(ENGINE_2D *engine)
+{
+    RANDOM *rng = Engine2D_GetRandom(engine);
+    for (int i = 0; i < NUM_BODIES; i++)
+    {
+        VECTOR_2D pos = {Random_Unit(rng) * WORLD_WIDTH, Random_Unit(rng) * WORLD_HEIGHT};
+        VECTOR_2D vel = {(2 * Random_Unit(rng) - 1) * SPEED, (2 * Random_Unit(rng) - 1) * SPEED};
+        Engine2D_CreateCircleObject(engine, RGB_WHITE, RADIUS, (PHYS_BODY){MASS, pos, vel});
+    }
+}
+
+void createBinaries(ENGINE_2D *engine)
+{
+    // the default 1024 pixels per meter
+    double mu = G * 1024 * 1024 * 1024 * 2 * MASS;
+    double speed = sqrt(mu / BINARY_SEPARATION * (1 - BINARY_ECCENTRICITY)) / 2;
+    for (int x = BINARY_SPACING / 2; x < WORLD_WIDTH; x += BINARY_SPACING)
+    {
+        for (int y = BINARY_SPACING / 2; y < WORLD_HEIGHT; y += BINARY_SPACING)
+        {
+            Engine2D_CreateCircleObject(engine, RGB_WHITE, RADIUS, (PHYS_BODY){MASS, {x - BINARY_SEPARATION / 2, y}, {0, -speed}});
+            Engine2D_CreateCircleObject(engine, RGB_WHITE, RADIUS, (PHYS_BODY){MASS, {x + BINARY_SEPARATION / 2, y}, {0, speed}});
+        }
+    }
+}
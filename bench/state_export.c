@@ -0,0 +1,81 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include "Engine2D.h"
+#include "StateExport.h"
+
+#define NUM_FRAMES 300
+#define WORLD_WIDTH 1280
+#define WORLD_HEIGHT 720
+#define NUM_BODIES 20000
+#define RADIUS 2
+#define MASS 10000
+#define SPEED 200
+#define EXPORT_NAME "/engine2d_bench"
+
+// Times stepping without exporting state and with every frame published to shared memory, then how long a reader
+// takes to go over the latest frame in place.
+int main()
+{
+    printf("state export, %d bodies, %d frames\n", NUM_BODIES, NUM_FRAMES);
+    for (int exporting = 0; exporting <= 1; exporting++)
+    {
+        ENGINE_2D_CONFIG config = Engine2D_DefaultConfig();
+        config.world_width = WORLD_WIDTH;
+        config.world_height = WORLD_HEIGHT;
+        config.seed = 1;
+        ENGINE_2D *engine = Engine2D_InitWithConfig(config, NULL, NULL, NULL, 30, ELASTIC_COLLISION | BOUNDING_BOX);
+        RANDOM *rng = Engine2D_GetRandom(engine);
+        for (int i = 0; i < NUM_BODIES; i++)
+        {
+            VECTOR_2D pos = {Random_Unit(rng) * WORLD_WIDTH, Random_Unit(rng) * WORLD_HEIGHT};
+            VECTOR_2D vel = {(2 * Random_Unit(rng) - 1) * SPEED, (2 * Random_Unit(rng) - 1) * SPEED};
+            Engine2D_CreateCircleObject(engine, RGB_WHITE, RADIUS, (PHYS_BODY){MASS, pos, vel});
+        }
+        if (exporting && Engine2D_StartExport(engine, EXPORT_NAME) != 0)
+            return 1;
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int frame = 0; frame < NUM_FRAMES; frame++)
+            Engine2D_RunSimulation(engine);
+        double ms = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000 / NUM_FRAMES;
+        printf("%s\t%.3lf ms/frame\n", exporting ? "export" : "no export", ms);
+
+        if (exporting)
+        {
+            size_t size;
+            const STATE_EXPORT_HEADER *header = StateExport_Map(EXPORT_NAME, &size);
+            if (header == NULL)
+                return 1;
+            double sum = 0;
+            int reads = 0;
+            start = SDL_GetPerformanceCounter();
+            for (int r = 0; r < NUM_FRAMES; r++)
+            {
+                const STATE_EXPORT_BODY *bodies;
+                int frame, count;
+                int ticket = StateExport_BeginRead(header, &bodies, &frame, &count);
+                if (ticket < 0)
+                {
+                    // the writer moved to a larger segment or stopped, so map whatever is under the name now
+                    StateExport_Unmap(header, size);
+                    header = StateExport_Map(EXPORT_NAME, &size);
+                    if (header == NULL)
+                        return 1;
+                    continue;
+                }
+                double frame_sum = 0;
+                for (int b = 0; b < count; b++)
+                    frame_sum += bodies[b].x + bodies[b].y;
+                if (StateExport_EndRead(header, ticket))
+                {
+                    sum += frame_sum;
+                    reads++;
+                }
+            }
+            ms = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000 / NUM_FRAMES;
+            printf("read in place\t%.3lf ms/frame (%d reads, checksum %g)\n", ms, reads, sum);
+            StateExport_Unmap(header, size);
+        }
+        Engine2D_Free(engine);
+    }
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "Engine2D.h"
+
+#define NUM_BODIES 2000
+#define NUM_FRAMES 60
+#define WORLD_WIDTH 1280
+#define WORLD_HEIGHT 720
+#define RADIUS 2
+#define MASS 10000
+
+// Times Engine2D_RunSimulation headless for every combination of the flags the step kernels are specialised on.
+// Build it with and without -DENGINE2D_BRANCHY_STEP (see 'make bench') to compare against the branchy loops.
+int main()
+{
+    const int modes[] = {ELASTIC_COLLISION, ENABLE_GRAVITY, BOUNDING_BOX};
+    const char *mode_names[] = {"elastic", "gravity", "walled"};
+#ifdef ENGINE2D_BRANCHY_STEP
+    printf("branchy step, ");
+#else
+    printf("specialised step kernels, ");
+#endif
+    printf("%s precision, %d bodies, %d frames\n", sizeof(REAL) == sizeof(float) ? "single" : "double", NUM_BODIES, NUM_FRAMES);
+    double total_ms = 0;
+    for (int combination = 0; combination < 8; combination++)
+    {
+        int flags = 0;
+        for (int m = 0; m < 3; m++)
+        {
+            if (combination & (1 << m))
+                flags |= modes[m];
+        }
+        srand(1);
+        ENGINE_2D *engine = Engine2D_Init(NULL, NULL, NULL, 30, flags);
+        for (int i = 0; i < NUM_BODIES; i++)
+        {
+            VECTOR_2D pos = {rand() % WORLD_WIDTH, rand() % WORLD_HEIGHT};
+            VECTOR_2D vel = {rand() % 128 - 64, rand() % 128 - 64};
+            Engine2D_CreateCircleObject(engine, RGB_WHITE, RADIUS, (PHYS_BODY){MASS, pos, vel});
+        }
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int frame = 0; frame < NUM_FRAMES; frame++)
+            Engine2D_RunSimulation(engine);
+        double ms = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000 / NUM_FRAMES;
+        total_ms += ms;
+        Engine2D_Free(engine);
+
+        for (int m = 0; m < 3; m++)
+            printf("%s%s", combination & (1 << m) ? "+" : "-", mode_names[m]);
+        printf("\t%.3lf ms/frame\n", ms);
+    }
+    printf("total\t\t\t\t%.3lf ms/frame\n", total_ms);
+    return 0;
+}
@@ -0,0 +1,45 @@
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include "Engine2D.h"
+
+#define NUM_FRAMES 100
+#define VIEW_WIDTH 1280
+#define VIEW_HEIGHT 720
+// the bodies are spread over this many views in each direction
+#define WORLD_SCALE 32
+#define NUM_BODIES 60000
+#define RADIUS 2
+#define MASS 10000
+
+// Times drawing a paused world far larger than the view with the rasterizer headless, zoomed in on a corner of it,
+// on a quarter of it and out on all of it. Builds with ENGINE2D_NO_VIEW_TREE check every body against the view.
+int main()
+{
+    const double zooms[] = {1, 4.0 / WORLD_SCALE, 1.0 / WORLD_SCALE};
+    printf("view culling, %d bodies over %dx%d views, %d frames\n", NUM_BODIES, WORLD_SCALE, WORLD_SCALE, NUM_FRAMES);
+    for (size_t z = 0; z < SDL_arraysize(zooms); z++)
+    {
+        ENGINE_2D_CONFIG config = Engine2D_DefaultConfig();
+        config.world_width = VIEW_WIDTH;
+        config.world_height = VIEW_HEIGHT;
+        config.buffer_zone = INFINITY;
+        config.seed = 1;
+        ENGINE_2D *engine = Engine2D_InitWithConfig(config, NULL, NULL, NULL, 30, ELASTIC_COLLISION | SOFTWARE_RENDER | PAUSED);
+        RANDOM *rng = Engine2D_GetRandom(engine);
+        for (int i = 0; i < NUM_BODIES; i++)
+        {
+            VECTOR_2D pos = {Random_Unit(rng) * VIEW_WIDTH * WORLD_SCALE, Random_Unit(rng) * VIEW_HEIGHT * WORLD_SCALE};
+            Engine2D_CreateCircleObject(engine, RGB_WHITE, RADIUS, (PHYS_BODY){MASS, pos, {0, 0}});
+        }
+        // zooming about the top left of the view keeps it on the corner of the world
+        Engine2D_ZoomCamera(engine, (VECTOR_2D){0, 0}, zooms[z]);
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int frame = 0; frame < NUM_FRAMES; frame++)
+            Engine2D_RunSimulation(engine);
+        double ms = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() * 1000 / NUM_FRAMES;
+        printf("zoom 1/%g\t%.3lf ms/frame\n", 1 / zooms[z], ms);
+        Engine2D_Free(engine);
+    }
+    return 0;
+}
@@ -0,0 +1,43 @@
+#ifndef CONTROLSERVER_H
+#define CONTROLSERVER_H
+
+#include "Engine2D.h"
+
+// every message, both ways, is a uint32 length of what follows the header, a uint8 type and then that many bytes,
+// all in host byte order; a client may send any number of messages without waiting, and each gets one reply in order
+enum CONTROL_MESSAGE
+{
+    // uint32 count, then count bodies; answered with CONTROL_CREATED, or CONTROL_ERROR without creating any if one
+    // has a radius or mass that isn't positive or a value that isn't finite
+    CONTROL_CREATE = 1,
+    // uint32 count, then count int32 ids, none of them clearing every body; answered with CONTROL_OK
+    CONTROL_CLEAR,
+    // console commands, one per line, such as "set --gravity on" or "pause", run between the same two frames;
+    // answered with CONTROL_OK
+    CONTROL_COMMAND,
+    // nothing; answered with CONTROL_STATE
+    CONTROL_READ_STATE,
+
+    // uint32 count of the bodies cleared, 0 for anything else
+    CONTROL_OK = 64,
+    // int32 id of the first body created, the others numbered on from it
+    CONTROL_CREATED,
+    // int32 frame, uint32 count, then count bodies
+    CONTROL_STATE,
+    // text saying what was wrong with the request
+    CONTROL_ERROR,
+};
+
+#define CONTROL_HEADER_SIZE 5
+// a body is an int32 id, ignored when creating, uint8 red, green and blue and a byte of padding, then float64
+// radius, mass, x, y, x velocity and y velocity
+#define CONTROL_BODY_SIZE 56
+
+// serves a Unix domain socket at path from a thread of its own, which decodes and encodes messages without the
+// engine's lock, taking it only to copy bodies in or out or to run commands
+typedef struct CONTROL_SERVER CONTROL_SERVER;
+
+CONTROL_SERVER *ControlServer_Start(ENGINE_2D *engine, const char *path);
+void ControlServer_Stop(CONTROL_SERVER *server);
+
+#endif
@@ -1,17 +1,76 @@
 #ifndef ENGINE2D_H
 #define ENGINE2D_H
 
+#include <stddef.h>
 #include "colors.h"
 #include "Vector2D.h"
 
 typedef struct
 {
-    double mass;
+    REAL mass;
     VECTOR_2D pos, vel;
 } PHYS_BODY;
 
 typedef struct ENGINE_2D ENGINE_2D;
 
+typedef struct
+{
+    double world_width, world_height;
+    double pixels_per_meter;
+    double density;
+    double buffer_zone;
+    int num_threads; // 0 uses one thread per CPU
+    uint64_t seed;
+    size_t history_budget; // bytes of rewind history to keep, 0 keeps none
+    int keyframe_interval; // frames between full snapshots in the rewind history
+} ENGINE_2D_CONFIG;
+
+// a circle as handed to the engine and read back from it in bulk
+typedef struct
+{
+    int id;
+    RGB24 color;
+    REAL radius;
+    PHYS_BODY phys_comp;
+} ENGINE_2D_BODY;
+
+typedef struct
+{
+    int bodies, merges;
+    double kinetic_energy, potential_energy;
+} ENGINE_2D_STATS;
+
+// conserved quantities at the start of a step, the potential energy summed up by the step's own pass over the pairs
+typedef struct
+{
+    int frame, bodies;
+    double mass;
+    double kinetic_energy, potential_energy;
+    VECTOR_2D momentum, centre_of_mass;
+    // about the origin of the world
+    double angular_momentum;
+    // the change in total energy since reference_frame, over the kinetic energy plus the size of the potential then
+    double energy_drift;
+    int reference_frame;
+} ENGINE_2D_DIAGNOSTICS;
+
+// what happens once the energy drifts further than the limit, after which drift is measured from there
+enum DRIFT_ACTIONS
+{
+    DRIFT_ALERT,
+    DRIFT_HALVE_DT,
+};
+
+// how gravity is softened within the softening length of a circle's centre, so near misses don't fling circles apart
+enum SOFTENING_KERNELS
+{
+    SOFTENING_NONE,
+    // as if every circle were a Plummer sphere, softened a little at any distance
+    SOFTENING_PLUMMER,
+    // the cubic spline of SPH codes, exactly Newtonian beyond 2.8 softening lengths
+    SOFTENING_SPLINE,
+};
+
 enum MODES
 {
     ELASTIC_COLLISION = 1,
@@ -21,11 +80,50 @@ enum MODES
     ENABLE_LOGGING = 16,
     PAUSED = 32,
     ENABLE_INPUT = 64,
+    CONTINUOUS_COLLISION = 128,
+    ENABLE_SLEEPING = 256,
+    DETERMINISTIC = 512,
+    SPATIAL_SORT = 1024,
+    BARNES_HUT = 2048,
+    NEIGHBOUR_LISTS = 4096,
+    SOFTWARE_RENDER = 8192,
+    MULTI_RATE = 16384,
+    DIAGNOSTICS = 32768,
 };
 
+ENGINE_2D_CONFIG Engine2D_DefaultConfig();
 ENGINE_2D *Engine2D_Init(void *renderer, void *shared_state_mutex, void *log_file, int fps, int flags);
+ENGINE_2D *Engine2D_InitWithConfig(ENGINE_2D_CONFIG config, void *renderer, void *shared_state_mutex, void *log_file, int fps, int flags);
 void Engine2D_CreateCircleObject(ENGINE_2D *engine, RGB24 color, double radius, PHYS_BODY phys_comp);
+int Engine2D_CreateCircleObjects(ENGINE_2D *engine, const ENGINE_2D_BODY *bodies, int count);
+int Engine2D_ClearCircleObjects(ENGINE_2D *engine, const int *ids, int count);
+int Engine2D_ReadBodies(ENGINE_2D *engine, ENGINE_2D_BODY *bodies, int cap, int *frame);
 void Engine2D_RunSimulation(ENGINE_2D *engine);
+int Engine2D_GetFlags(ENGINE_2D *engine);
+void Engine2D_SetTimeStep(ENGINE_2D *engine, double dt);
+ENGINE_2D_STATS Engine2D_GetStats(ENGINE_2D *engine);
+ENGINE_2D_DIAGNOSTICS Engine2D_GetDiagnostics(ENGINE_2D *engine);
+void Engine2D_SetDriftLimit(ENGINE_2D *engine, double limit, int action);
+void Engine2D_SetSoftening(ENGINE_2D *engine, int kernel, double length);
+void Engine2D_SetCloseEncounters(ENGINE_2D *engine, double gap);
+int Engine2D_FindCircleAt(ENGINE_2D *engine, VECTOR_2D point);
+void Engine2D_LogObjects(ENGINE_2D *engine);
+RANDOM *Engine2D_GetRandom(ENGINE_2D *engine);
+uint64_t Engine2D_Checksum(ENGINE_2D *engine);
+int Engine2D_StartRecording(ENGINE_2D *engine, const char *path);
+ENGINE_2D *Engine2D_LoadReplay(const char *path, void *renderer, void *shared_state_mutex, int num_threads);
+int Engine2D_IsReplayFinished(ENGINE_2D *engine, uint64_t *recorded_checksum);
+const uint32_t *Engine2D_GetFramebuffer(ENGINE_2D *engine, int *width, int *height);
+void Engine2D_PanCamera(ENGINE_2D *engine, VECTOR_2D offset);
+void Engine2D_ZoomCamera(ENGINE_2D *engine, VECTOR_2D point, double factor);
+VECTOR_2D Engine2D_ScreenToWorld(ENGINE_2D *engine, VECTOR_2D point);
+void Engine2D_SetRegionOfInterest(ENGINE_2D *engine, VECTOR_2D min, VECTOR_2D max);
+int Engine2D_StartCapture(ENGINE_2D *engine, const char *path, int interval, int throttle);
+void Engine2D_StopCapture(ENGINE_2D *engine);
+int Engine2D_StartExport(ENGINE_2D *engine, const char *name);
+void Engine2D_StopExport(ENGINE_2D *engine);
+int Engine2D_RunScript(ENGINE_2D *engine, const char *path);
+void Engine2D_RunCommands(ENGINE_2D *engine, const char *text, size_t size, const char *source);
 
 void Engine2D_Free(ENGINE_2D *engine);
 
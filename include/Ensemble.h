@@ -0,0 +1,7 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+// runs the 'ensemble' driver with the arguments that follow the word 'ensemble' on the command line
+int Ensemble_Main(int argc, char *argv[]);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <stdint.h>
+
+// what happens to a frame that arrives while every buffer is waiting to be written
+enum FRAME_CAPTURE_POLICY
+{
+    // the frame is left out of the recording, so drawing never waits on the writer
+    FRAME_CAPTURE_DROP,
+    // drawing waits in FrameCapture_WaitForBuffer for the writer to free a buffer, slowing down to its pace without
+    // losing a frame
+    FRAME_CAPTURE_THROTTLE,
+};
+
+typedef struct
+{
+    int frames_written, frames_dropped;
+    int width, height;
+    // set once a write failed, as when the program reading a pipe exits
+    int failed;
+} FRAME_CAPTURE_STATS;
+
+// ARGB8888 frames copied into a pool of reusable buffers and streamed by a writer thread as raw RGB24, one frame
+// after another with no header, to a file or to the standard input of a command given as "|command"; a command that
+// exits early fails the capture with SIGPIPE ignored, and otherwise ends the program, which is up to the program
+typedef struct FRAME_CAPTURE FRAME_CAPTURE;
+
+FRAME_CAPTURE *FrameCapture_Open(const char *path, int num_buffers, int policy);
+void FrameCapture_WaitForBuffer(FRAME_CAPTURE *capture);
+uint32_t *FrameCapture_Acquire(FRAME_CAPTURE *capture, int width, int height);
+void FrameCapture_Submit(FRAME_CAPTURE *capture);
+FRAME_CAPTURE_STATS FrameCapture_Close(FRAME_CAPTURE *capture);
+
+#endif
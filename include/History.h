@@ -0,0 +1,32 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <SDL2/SDL.h>
+#include <stddef.h>
+#include "Engine2D.h"
+
+// positions are kept to 1/64 pixel and velocities to 1/64 pixel per second between keyframes
+#define HISTORY_POSITION_SCALE 64.0
+#define HISTORY_VELOCITY_SCALE 64.0
+
+// the bodies of a frame as an array of records of record_size bytes, each with its PHYS_BODY motion_offset bytes in;
+// same_apart_from_motion tells whether two records of the same body differ in anything but its position and
+// velocity, which are predicted from one frame to the next, and whatever else the history needn't keep exactly
+typedef struct
+{
+    size_t record_size, motion_offset;
+    SDL_bool (*same_apart_from_motion)(const void *r1, const void *r2);
+} HISTORY_LAYOUT;
+
+// rewind history: a keyframe every keyframe_interval frames and a compact delta for each frame in between, in
+// segments dropped oldest first once they outgrow the budget in bytes
+typedef struct HISTORY HISTORY;
+
+HISTORY *History_Init(HISTORY_LAYOUT layout, size_t budget, int keyframe_interval);
+void History_Capture(HISTORY *history, int frame, int next_id, double dt, const void *records, int count);
+void History_RequestKeyframe(HISTORY *history);
+const void *History_Rewind(HISTORY *history, int frame, int *count, int *next_id);
+int History_OldestFrame(const HISTORY *history, int frame);
+void History_Free(HISTORY *history);
+
+#endif
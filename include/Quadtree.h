@@ -0,0 +1,52 @@
+#ifndef QUADTREE_H
+#define QUADTREE_H
+
+#include <stdint.h>
+#include "ThreadPool.h"
+#include "Vector2D.h"
+
+// a node at level l holds the points whose Morton codes share their top 2 * l bits
+#define QUADTREE_MAX_LEVELS 16
+
+// linear quadtree over points sorted along a Morton curve, kept in flat arrays rather than linked nodes:
+// the points of a node are consecutive, its children are consecutive, and each level follows the one above it
+typedef struct
+{
+    // points in Morton order, with the index each one had when passed to Quadtree_Build
+    int num_points, points_cap;
+    int *point_index;
+    uint32_t *code;
+    REAL *x, *y, *mass, *radius;
+
+    // per node: the points [first, first + count) and the children [first_child, first_child + num_children)
+    int num_nodes, nodes_cap;
+    int *first, *count, *first_child, *num_children;
+    // moments and bounds of the points under each node, radius being the largest among them
+    REAL *total_mass, *com_x, *com_y;
+    REAL *min_x, *min_y, *max_x, *max_y, *max_radius;
+    // the nodes of level l are [level_start[l], level_start[l + 1])
+    int num_levels;
+    int level_start[QUADTREE_MAX_LEVELS + 2];
+    // maps positions to the 16 bit grid the codes were taken on at the last build
+    REAL origin_x, origin_y, scale;
+    // summed sizes of the nodes right after the last build
+    double built_extent;
+
+    // scratch for the parallel passes
+    uint32_t *code_scratch;
+    int *index_scratch;
+    int *chunk_offsets;
+    REAL *chunk_bounds;
+    int chunks_cap;
+    int *loose_nodes;
+    int loose_cap;
+} QUADTREE;
+
+QUADTREE *Quadtree_Init();
+int Quadtree_Build(QUADTREE *tree, THREAD_POOL *pool, const REAL *x, const REAL *y, const REAL *mass, const REAL *radius, int n);
+int Quadtree_Refit(QUADTREE *tree, THREAD_POOL *pool, const REAL *x, const REAL *y, const REAL *mass, const REAL *radius);
+int Quadtree_Query(const QUADTREE *tree, REAL min_x, REAL min_y, REAL max_x, REAL max_y, int *points);
+uint32_t Quadtree_MortonCode(uint32_t x, uint32_t y);
+void Quadtree_Free(QUADTREE *tree);
+
+#endif
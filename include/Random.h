@@ -0,0 +1,17 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <stdint.h>
+
+// a small seeded generator, so that everything random in a run follows from its seed
+typedef struct
+{
+    uint64_t state;
+} RANDOM;
+
+void Random_Seed(RANDOM *rng, uint64_t seed);
+uint32_t Random_Next(RANDOM *rng);
+double Random_Unit(RANDOM *rng);
+int Random_Range(RANDOM *rng, int low, int high);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef RASTERIZER_H
+#define RASTERIZER_H
+
+#include <stdint.h>
+#include "ThreadPool.h"
+
+// the screen is drawn in square tiles of this many pixels a side, each by one thread
+#define RASTERIZER_TILE_SIZE 64
+// circles per pixel at which the heat map turns white
+#define RASTERIZER_HEAT_LEVELS 256
+
+// how circles narrower than the level of detail radius are drawn
+enum RASTERIZER_LOD
+{
+    RASTERIZER_LOD_OFF,
+    // one pixel in the circle's colour
+    RASTERIZER_LOD_SPLATS,
+    // counted per pixel and shown as a heat map beneath the circles drawn whole
+    RASTERIZER_LOD_HEAT_MAP,
+};
+
+// filled circles drawn on the CPU into an ARGB8888 framebuffer: the circles are binned per tile in the order they
+// were added, then every tile is cleared and drawn row by row, so later circles cover earlier ones as they would on a renderer
+typedef struct
+{
+    // circles added since Rasterizer_Begin, centre and radius in whole pixels, a radius of -1 marking a splat
+    int num_circles, circles_cap;
+    int *x, *y, *radius;
+    uint32_t *color;
+    int lod;
+    double lod_radius;
+
+    // the circles overlapping tile t are entries [tile_start[t], tile_start[t + 1]), in the order they were added
+    int tiles_x, tiles_y;
+    int *tile_start;
+    int tiles_cap;
+    int *entries;
+    int entries_cap;
+
+    // splats per pixel for the heat map
+    uint32_t *density;
+    int density_cap;
+    uint32_t heat_palette[RASTERIZER_HEAT_LEVELS];
+
+    // target of the draw in progress
+    uint32_t *pixels;
+    int pitch, width, height;
+    uint32_t background;
+} RASTERIZER;
+
+RASTERIZER *Rasterizer_Init();
+void Rasterizer_Begin(RASTERIZER *raster);
+void Rasterizer_SetLevelOfDetail(RASTERIZER *raster, int lod, double lod_radius);
+int Rasterizer_AddCircle(RASTERIZER *raster, double x, double y, double radius, uint32_t argb);
+int Rasterizer_Draw(RASTERIZER *raster, THREAD_POOL *pool, uint32_t *pixels, int pitch, int width, int height, uint32_t background);
+void Rasterizer_Free(RASTERIZER *raster);
+
+#endif
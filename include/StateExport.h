@@ -0,0 +1,57 @@
+#ifndef STATEEXPORT_H
+#define STATEEXPORT_H
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+
+#define STATE_EXPORT_MAGIC 0x53443245u // "E2DS" in a little-endian dump
+#define STATE_EXPORT_VERSION 1
+
+// a body as published, the same whatever precision the engine simulates in
+typedef struct
+{
+    int32_t id;
+    uint8_t r, g, b, pad;
+    double radius, x, y, vx, vy;
+} STATE_EXPORT_BODY;
+
+typedef struct
+{
+    // odd while the writer is filling the buffer, bumped twice every time it does
+    SDL_atomic_t sequence;
+    int32_t frame, count, pad;
+} STATE_EXPORT_BUFFER;
+
+// the start of the segment; two buffers of capacity bodies each follow it, the first at header_size bytes in and
+// the second capacity * body_size bytes after that. A reader should check magic, version and body_size before
+// trusting anything else
+typedef struct
+{
+    uint32_t magic, version;
+    uint32_t header_size, body_size;
+    int32_t capacity;
+    // the buffer published last, the other one being the one the writer fills next; -1 until the first frame is in
+    SDL_atomic_t latest;
+    // set once the writer has outgrown the segment and replaced it with a larger one under the same name, which a
+    // reader should map instead, or once the writer has stopped
+    SDL_atomic_t stale;
+    int32_t pad;
+    STATE_EXPORT_BUFFER buffers[2];
+} STATE_EXPORT_HEADER;
+
+// every frame's bodies published into a POSIX shared memory segment, which other processes map to read the latest
+// frame in place, without a copy or a system call
+typedef struct STATE_EXPORT STATE_EXPORT;
+
+STATE_EXPORT *StateExport_Open(const char *name, int capacity);
+STATE_EXPORT_BODY *StateExport_Begin(STATE_EXPORT *export, int count);
+void StateExport_Publish(STATE_EXPORT *export, int frame, int count);
+void StateExport_Close(STATE_EXPORT *export);
+
+// the reading side, for other processes
+const STATE_EXPORT_HEADER *StateExport_Map(const char *name, size_t *size);
+void StateExport_Unmap(const STATE_EXPORT_HEADER *header, size_t size);
+int StateExport_BeginRead(const STATE_EXPORT_HEADER *header, const STATE_EXPORT_BODY **bodies, int *frame, int *count);
+SDL_bool StateExport_EndRead(const STATE_EXPORT_HEADER *header, int ticket);
+
+#endif
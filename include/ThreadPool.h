@@ -0,0 +1,14 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+typedef struct THREAD_POOL THREAD_POOL;
+
+// processes the indices [begin, end) of a parallel loop
+typedef void (*PARALLEL_FOR_FN)(void *context, int begin, int end);
+
+THREAD_POOL *ThreadPool_Init(int num_threads);
+int ThreadPool_Size(THREAD_POOL *pool);
+void ThreadPool_ParallelFor(THREAD_POOL *pool, int count, int min_chunk, PARALLEL_FOR_FN fn, void *context);
+void ThreadPool_Free(THREAD_POOL *pool);
+
+#endif
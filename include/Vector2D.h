@@ -1,16 +1,25 @@
 #ifndef VECTOR2D_H
 #define VECTOR2D_H
 
+// build with -DENGINE2D_SINGLE_PRECISION (make PRECISION=single) to store and compute vectors in float
+#ifdef ENGINE2D_SINGLE_PRECISION
+typedef float REAL;
+#define REAL_SQRT sqrtf
+#else
+typedef double REAL;
+#define REAL_SQRT sqrt
+#endif
+
 typedef struct
 {
-    double x, y;
+    REAL x, y;
 } VECTOR_2D;
 
-double Vector2D_Magnitude(VECTOR_2D);
+REAL Vector2D_Magnitude(VECTOR_2D);
 VECTOR_2D Vector2D_Normalised(VECTOR_2D);
 VECTOR_2D Vector2D_Sum(VECTOR_2D, VECTOR_2D);
 VECTOR_2D Vector2D_Difference(VECTOR_2D, VECTOR_2D);
-VECTOR_2D Vector2D_ScalarProduct(VECTOR_2D, double c);
-double Vector2D_DotProduct(VECTOR_2D, VECTOR_2D);
+VECTOR_2D Vector2D_ScalarProduct(VECTOR_2D, REAL c);
+REAL Vector2D_DotProduct(VECTOR_2D, VECTOR_2D);
 
-#endif
\ No newline at end of file
+#endif
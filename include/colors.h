@@ -1,6 +1,8 @@
 #ifndef COLORS_H
 #define COLORS_H
 
+#include "Random.h"
+
 typedef struct
 {
     unsigned char r, g, b;
@@ -15,7 +17,7 @@ extern const RGB24 RGB_CYAN;
 extern const RGB24 RGB_MAGENTA;
 extern const RGB24 RGB_WHITE;
 
-RGB24 generateVividColor();
+RGB24 generateVividColor(RANDOM *rng);
 RGB24 mixTwoColors(RGB24 color1, RGB24 color2);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,505 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "ControlServer.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define MAX_MESSAGE_SIZE (64 << 20)
+#define READ_CHUNK_SIZE 65536
+#define LISTEN_BACKLOG 16
+
+typedef struct
+{
+    int fd;
+    // bytes received but not yet handled, and replies not yet sent from out_sent on
+    unsigned char *in, *out;
+    size_t in_size, in_cap, out_size, out_sent, out_cap;
+    // once the client has sent its last request, or one the server gave up on, it is closed as soon as the replies are out
+    SDL_bool closing;
+} CONTROL_CLIENT;
+
+struct CONTROL_SERVER
+{
+    ENGINE_2D *engine;
+    char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+    int listen_fd;
+    // set once bind has made the socket at path, the only thing at path that Stop may remove
+    SDL_bool bound;
+    // a byte written to wake_fds[1] stops the loop
+    int wake_fds[2];
+    SDL_Thread *thread;
+    CONTROL_CLIENT *clients;
+    int num_clients, clients_cap;
+    struct pollfd *poll_fds;
+    int poll_cap;
+    // bodies and ids decoded from requests or to be encoded into replies, kept between messages
+    ENGINE_2D_BODY *bodies;
+    int bodies_cap;
+    int *ids;
+    int ids_cap;
+};
+
+int SDLCALL serveLoop(void *data);
+SDL_bool setNonBlocking(int fd);
+void acceptClients(CONTROL_SERVER *server);
+SDL_bool readClient(CONTROL_CLIENT *client);
+SDL_bool writeClient(CONTROL_CLIENT *client);
+void closeClient(CONTROL_CLIENT *client);
+void handleMessages(CONTROL_SERVER *server, CONTROL_CLIENT *client);
+void handleMessage(CONTROL_SERVER *server, CONTROL_CLIENT *client, int type, const unsigned char *payload, uint32_t size);
+void handleCreate(CONTROL_SERVER *server, CONTROL_CLIENT *client, const unsigned char *payload, uint32_t size);
+void handleClear(CONTROL_SERVER *server, CONTROL_CLIENT *client, const unsigned char *payload, uint32_t size);
+void handleReadState(CONTROL_SERVER *server, CONTROL_CLIENT *client);
+SDL_bool reserveBytes(unsigned char **bytes, size_t *cap, size_t size);
+SDL_bool reserveBodies(CONTROL_SERVER *server, int count);
+unsigned char *beginReply(CONTROL_CLIENT *client, int type, uint32_t size);
+void replyError(CONTROL_CLIENT *client, const char *message);
+void replyOk(CONTROL_CLIENT *client, uint32_t count);
+
+CONTROL_SERVER *ControlServer_Start(ENGINE_2D *engine, const char *path)
+{
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "control: socket path '%s' is too long\n", path);
+        return NULL;
+    }
+    CONTROL_SERVER *server = (CONTROL_SERVER *)calloc(1, sizeof(CONTROL_SERVER));
+    if (server == NULL)
+    {
+        fprintf(stderr, "ALLOCATION FAILED in %s\n", __func__);
+        return NULL;
+    }
+    server->engine = engine;
+    server->listen_fd = server->wake_fds[0] = server->wake_fds[1] = -1;
+    SDL_strlcpy(server->path, path, sizeof(server->path));
+    SDL_strlcpy(address.sun_path, path, sizeof(address.sun_path));
+    // a socket left behind by an earlier run would make bind fail, anything else at path is left alone
+    struct stat path_stat;
+    if (stat(path, &path_stat) == 0 && S_ISSOCK(path_stat.st_mode))
+        unlink(path);
+    server->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    server->bound = server->listen_fd >= 0 && bind(server->listen_fd, (struct sockaddr *)&address, sizeof(address)) == 0;
+    if (!server->bound || listen(server->listen_fd, LISTEN_BACKLOG) != 0 || !setNonBlocking(server->listen_fd) ||
+        pipe(server->wake_fds) != 0)
+    {
+        fprintf(stderr, "control: cannot listen on '%s': %s\n", path, strerror(errno));
+        ControlServer_Stop(server);
+        return NULL;
+    }
+    server->thread = SDL_CreateThread(serveLoop, "control server", server);
+    if (server->thread == NULL)
+    {
+        fprintf(stderr, "THREAD CREATION FAILED in %s: %s\n", __func__, SDL_GetError());
+        ControlServer_Stop(server);
+        return NULL;
+    }
+    return server;
+}
+
+void ControlServer_Stop(CONTROL_SERVER *server)
+{
+    if (server == NULL)
+        return;
+    if (server->thread != NULL)
+    {
+        char byte = 0;
+        if (write(server->wake_fds[1], &byte, 1) != 1)
+            fprintf(stderr, "control: cannot wake the server: %s\n", strerror(errno));
+        SDL_WaitThread(server->thread, NULL);
+    }
+    for (int c = 0; c < server->num_clients; c++)
+        closeClient(server->clients + c);
+    int fds[] = {server->listen_fd, server->wake_fds[0], server->wake_fds[1]};
+    for (size_t f = 0; f < SDL_arraysize(fds); f++)
+    {
+        if (fds[f] >= 0)
+            close(fds[f]);
+    }
+    if (server->bound)
+        unlink(server->path);
+    free(server->clients);
+    free(server->poll_fds);
+    free(server->bodies);
+    free(server->ids);
+    free(server);
+}
+
+// waits on the listening socket and every client at once, and only ever reads or writes what is ready
+int SDLCALL serveLoop(void *data)
+{
+    CONTROL_SERVER *server = (CONTROL_SERVER *)data;
+    while (SDL_TRUE)
+    {
+        int num_fds = server->num_clients + 2;
+        if (num_fds > server->poll_cap)
+        {
+            int cap = SDL_max(num_fds, 2 * server->poll_cap);
+            struct pollfd *temp = (struct pollfd *)realloc(server->poll_fds, cap * sizeof(struct pollfd));
+            if (temp == NULL)
+            {
+                fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+                return -1;
+            }
+            server->poll_fds = temp;
+            server->poll_cap = cap;
+        }
+        server->poll_fds[0] = (struct pollfd){.fd = server->wake_fds[0], .events = POLLIN};
+        server->poll_fds[1] = (struct pollfd){.fd = server->listen_fd, .events = POLLIN};
+        for (int c = 0; c < server->num_clients; c++)
+        {
+            CONTROL_CLIENT *client = server->clients + c;
+            short events = client->closing ? 0 : POLLIN;
+            if (client->out_sent < client->out_size)
+                events |= POLLOUT;
+            server->poll_fds[c + 2] = (struct pollfd){.fd = client->fd, .events = events};
+        }
+        if (poll(server->poll_fds, num_fds, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "control: poll failed: %s\n", strerror(errno));
+            return -1;
+        }
+        if (server->poll_fds[0].revents != 0)
+            return 0;
+
+        // the clients polled are the first num_fds - 2, any accepted below wait for the next poll
+        int num_polled = num_fds - 2;
+        if (server->poll_fds[1].revents & POLLIN)
+            acceptClients(server);
+        for (int c = 0; c < num_polled; c++)
+        {
+            CONTROL_CLIENT *client = server->clients + c;
+            short revents = server->poll_fds[c + 2].revents;
+            SDL_bool open = SDL_TRUE;
+            if (!client->closing && (revents & (POLLIN | POLLHUP | POLLERR)))
+            {
+                open = readClient(client);
+                if (open)
+                    handleMessages(server, client);
+            }
+            if (open && client->out_sent < client->out_size)
+                open = writeClient(client);
+            if (open && client->closing && client->out_sent == client->out_size)
+                open = SDL_FALSE;
+            if (!open)
+                closeClient(client);
+        }
+        // drop the closed clients, keeping the order of the others
+        int kept = 0;
+        for (int c = 0; c < server->num_clients; c++)
+        {
+            if (server->clients[c].fd >= 0)
+                server->clients[kept++] = server->clients[c];
+        }
+        server->num_clients = kept;
+    }
+}
+
+SDL_bool setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+void acceptClients(CONTROL_SERVER *server)
+{
+    int fd;
+    while ((fd = accept(server->listen_fd, NULL, NULL)) >= 0)
+    {
+        if (!setNonBlocking(fd))
+        {
+            close(fd);
+            continue;
+        }
+        if (server->num_clients >= server->clients_cap)
+        {
+            int cap = SDL_max(8, 2 * server->clients_cap);
+            CONTROL_CLIENT *temp = (CONTROL_CLIENT *)realloc(server->clients, cap * sizeof(CONTROL_CLIENT));
+            if (temp == NULL)
+            {
+                fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+                close(fd);
+                return;
+            }
+            server->clients = temp;
+            server->clients_cap = cap;
+        }
+        server->clients[server->num_clients++] = (CONTROL_CLIENT){.fd = fd};
+    }
+}
+
+// reads whatever has arrived, marking the client closing once it has hung up; false if it can't be read from
+SDL_bool readClient(CONTROL_CLIENT *client)
+{
+    while (SDL_TRUE)
+    {
+        if (!reserveBytes(&client->in, &client->in_cap, client->in_size + READ_CHUNK_SIZE))
+            return SDL_FALSE;
+        ssize_t num_read = recv(client->fd, client->in + client->in_size, READ_CHUNK_SIZE, 0);
+        if (num_read > 0)
+            client->in_size += num_read;
+        else if (num_read == 0)
+        {
+            client->closing = SDL_TRUE;
+            return SDL_TRUE;
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return SDL_TRUE;
+        else if (errno != EINTR)
+            return SDL_FALSE;
+    }
+}
+
+// sends as much of the pending replies as the socket takes, false if the client can't be written to
+SDL_bool writeClient(CONTROL_CLIENT *client)
+{
+    while (client->out_sent < client->out_size)
+    {
+        ssize_t num_sent = send(client->fd, client->out + client->out_sent, client->out_size - client->out_sent, MSG_NOSIGNAL);
+        if (num_sent > 0)
+            client->out_sent += num_sent;
+        else if (num_sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return SDL_TRUE;
+        else if (num_sent < 0 && errno == EINTR)
+            continue;
+        else
+            return SDL_FALSE;
+    }
+    client->out_sent = client->out_size = 0;
+    return SDL_TRUE;
+}
+
+void closeClient(CONTROL_CLIENT *client)
+{
+    if (client->fd >= 0)
+        close(client->fd);
+    free(client->in);
+    free(client->out);
+    *client = (CONTROL_CLIENT){.fd = -1};
+}
+
+// handles every whole message received so far and keeps the start of the next one
+void handleMessages(CONTROL_SERVER *server, CONTROL_CLIENT *client)
+{
+    size_t offset = 0;
+    while (client->in_size - offset >= CONTROL_HEADER_SIZE)
+    {
+        uint32_t size;
+        SDL_memcpy(&size, client->in + offset, sizeof(size));
+        if (size > MAX_MESSAGE_SIZE)
+        {
+            replyError(client, "message too long");
+            client->closing = SDL_TRUE;
+            offset = client->in_size;
+            break;
+        }
+        if (client->in_size - offset < CONTROL_HEADER_SIZE + (size_t)size)
+            break;
+        handleMessage(server, client, client->in[offset + 4], client->in + offset + CONTROL_HEADER_SIZE, size);
+        offset += CONTROL_HEADER_SIZE + size;
+    }
+    memmove(client->in, client->in + offset, client->in_size - offset);
+    client->in_size -= offset;
+}
+
+void handleMessage(CONTROL_SERVER *server, CONTROL_CLIENT *client, int type, const unsigned char *payload, uint32_t size)
+{
+    switch (type)
+    {
+    case CONTROL_CREATE:
+        handleCreate(server, client, payload, size);
+        break;
+    case CONTROL_CLEAR:
+        handleClear(server, client, payload, size);
+        break;
+    case CONTROL_COMMAND:
+        Engine2D_RunCommands(server->engine, (const char *)payload, size, "control");
+        replyOk(client, 0);
+        break;
+    case CONTROL_READ_STATE:
+        handleReadState(server, client);
+        break;
+    default:
+        replyError(client, "unknown message type");
+    }
+}
+
+void handleCreate(CONTROL_SERVER *server, CONTROL_CLIENT *client, const unsigned char *payload, uint32_t size)
+{
+    uint32_t count = 0;
+    if (size >= sizeof(count))
+        SDL_memcpy(&count, payload, sizeof(count));
+    if (size < sizeof(count) || size != sizeof(count) + (uint64_t)count * CONTROL_BODY_SIZE)
+    {
+        replyError(client, "create: size doesn't match the number of bodies");
+        return;
+    }
+    if (!reserveBodies(server, count))
+    {
+        replyError(client, "create: out of memory");
+        return;
+    }
+    const unsigned char *record = payload + sizeof(count);
+    for (uint32_t b = 0; b < count; b++, record += CONTROL_BODY_SIZE)
+    {
+        double fields[6];
+        SDL_memcpy(fields, record + 8, sizeof(fields));
+        server->bodies[b] = (ENGINE_2D_BODY){
+            .color = {record[4], record[5], record[6]},
+            .radius = fields[0],
+            .phys_comp = {fields[1], {fields[2], fields[3]}, {fields[4], fields[5]}},
+        };
+        // checked once converted, as a double too large for a single precision engine only becomes infinite then
+        ENGINE_2D_BODY *body = server->bodies + b;
+        PHYS_BODY *phys = &body->phys_comp;
+        if (!(body->radius > 0 && phys->mass > 0 && isfinite(body->radius) && isfinite(phys->mass) &&
+              isfinite(phys->pos.x) && isfinite(phys->pos.y) && isfinite(phys->vel.x) && isfinite(phys->vel.y)))
+        {
+            replyError(client, "create: radius and mass must be positive and every value finite");
+            return;
+        }
+    }
+    int32_t first_id = Engine2D_CreateCircleObjects(server->engine, server->bodies, count);
+    unsigned char *reply = beginReply(client, CONTROL_CREATED, sizeof(first_id));
+    if (reply != NULL)
+        SDL_memcpy(reply, &first_id, sizeof(first_id));
+}
+
+void handleClear(CONTROL_SERVER *server, CONTROL_CLIENT *client, const unsigned char *payload, uint32_t size)
+{
+    uint32_t count = 0;
+    if (size >= sizeof(count))
+        SDL_memcpy(&count, payload, sizeof(count));
+    if (size < sizeof(count) || size != sizeof(count) + (uint64_t)count * sizeof(int32_t))
+    {
+        replyError(client, "clear: size doesn't match the number of ids");
+        return;
+    }
+    if ((int)count > server->ids_cap)
+    {
+        int *temp = (int *)realloc(server->ids, count * sizeof(int));
+        if (temp == NULL)
+        {
+            fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+            replyError(client, "clear: out of memory");
+            return;
+        }
+        server->ids = temp;
+        server->ids_cap = count;
+    }
+    for (uint32_t k = 0; k < count; k++)
+    {
+        int32_t id;
+        SDL_memcpy(&id, payload + sizeof(count) + k * sizeof(id), sizeof(id));
+        server->ids[k] = id;
+    }
+    replyOk(client, Engine2D_ClearCircleObjects(server->engine, count > 0 ? server->ids : NULL, count));
+}
+
+void handleReadState(CONTROL_SERVER *server, CONTROL_CLIENT *client)
+{
+    int frame, count;
+    // bodies created since the last read may not fit, in which case make room and read again
+    while ((count = Engine2D_ReadBodies(server->engine, server->bodies, server->bodies_cap, &frame)) > server->bodies_cap)
+    {
+        if (!reserveBodies(server, count))
+        {
+            replyError(client, "read state: out of memory");
+            return;
+        }
+    }
+    unsigned char *reply = beginReply(client, CONTROL_STATE, 2 * sizeof(int32_t) + (size_t)count * CONTROL_BODY_SIZE);
+    if (reply == NULL)
+        return;
+    int32_t header[] = {frame, count};
+    SDL_memcpy(reply, header, sizeof(header));
+    unsigned char *record = reply + sizeof(header);
+    for (int b = 0; b < count; b++, record += CONTROL_BODY_SIZE)
+    {
+        ENGINE_2D_BODY *body = server->bodies + b;
+        int32_t id = body->id;
+        double fields[] = {body->radius, body->phys_comp.mass, body->phys_comp.pos.x, body->phys_comp.pos.y,
+                           body->phys_comp.vel.x, body->phys_comp.vel.y};
+        SDL_memcpy(record, &id, sizeof(id));
+        record[4] = body->color.r;
+        record[5] = body->color.g;
+        record[6] = body->color.b;
+        record[7] = 0;
+        SDL_memcpy(record + 8, fields, sizeof(fields));
+    }
+}
+
+SDL_bool reserveBytes(unsigned char **bytes, size_t *cap, size_t size)
+{
+    if (size <= *cap)
+        return SDL_TRUE;
+    size_t new_cap = SDL_max(size, 2 * *cap);
+    unsigned char *temp = (unsigned char *)realloc(*bytes, new_cap);
+    if (temp == NULL)
+    {
+        fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+        return SDL_FALSE;
+    }
+    *bytes = temp;
+    *cap = new_cap;
+    return SDL_TRUE;
+}
+
+SDL_bool reserveBodies(CONTROL_SERVER *server, int count)
+{
+    if (count <= server->bodies_cap)
+        return SDL_TRUE;
+    int cap = SDL_max(count, 2 * server->bodies_cap);
+    ENGINE_2D_BODY *temp = (ENGINE_2D_BODY *)realloc(server->bodies, cap * sizeof(ENGINE_2D_BODY));
+    if (temp == NULL)
+    {
+        fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+        return SDL_FALSE;
+    }
+    server->bodies = temp;
+    server->bodies_cap = cap;
+    return SDL_TRUE;
+}
+
+// appends the header of a reply of size bytes and returns where its payload goes, NULL if there is no room for it
+unsigned char *beginReply(CONTROL_CLIENT *client, int type, uint32_t size)
+{
+    if (!reserveBytes(&client->out, &client->out_cap, client->out_size + CONTROL_HEADER_SIZE + size))
+    {
+        client->closing = SDL_TRUE;
+        return NULL;
+    }
+    unsigned char *header = client->out + client->out_size;
+    SDL_memcpy(header, &size, sizeof(size));
+    header[4] = type;
+    client->out_size += CONTROL_HEADER_SIZE + size;
+    return header + CONTROL_HEADER_SIZE;
+}
+
+void replyError(CONTROL_CLIENT *client, const char *message)
+{
+    unsigned char *reply = beginReply(client, CONTROL_ERROR, strlen(message));
+    if (reply != NULL)
+        SDL_memcpy(reply, message, strlen(message));
+}
+
+void replyOk(CONTROL_CLIENT *client, uint32_t count)
+{
+    unsigned char *reply = beginReply(client, CONTROL_OK, sizeof(count));
+    if (reply != NULL)
+        SDL_memcpy(reply, &count, sizeof(count));
+}
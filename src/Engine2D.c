@@ -3,78 +3,452 @@
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
 #include "Engine2D.h"
+#include "ThreadPool.h"
+#include "Quadtree.h"
+#include "Rasterizer.h"
+#include "FrameCapture.h"
+#include "StateExport.h"
+#include "History.h"
 
-#define WINDOW_WIDTH 1280
-#define WINDOW_HEIGHT 720
-// #define FRAMES_PER_SEC 30
+#define DEFAULT_WORLD_WIDTH 1280
+#define DEFAULT_WORLD_HEIGHT 720
 #define DEFAULT_ARR_CAPACITY 512
-#define PIXELS_PER_METER 1024
+#define DEFAULT_PIXELS_PER_METER 1024
 #define MIN_RADIUS 8
-#define MAX_RADIUS 16
-#define DENSITY 768
-#define LOG_FILE "log.txt"
-#define LOG_INTERVAL_SECS 1
+#define DEFAULT_DENSITY 768
 #define INPUT_BUFFER_SIZE 256
+// scripts are read this many bytes at a time
+#define SCRIPT_CHUNK_SIZE 65536
+#define MAX_SCRIPT_DEPTH 8
 #define ELASTIC 1
 #define INELASTIC 0
 #define DELIM " \t\r\n"
-#define DEFAULT_SPEED 196
-#define BUFFER_ZONE 128
-#define STARTUP_FRAMES 5
+#define DEFAULT_BUFFER_ZONE 128
+#define REPLAY_VERSION 1
+#define REPLAY_KIND_SIZE 16
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+#define DEFAULT_KEYFRAME_INTERVAL 300
+// circles narrower than this many pixels are drawn as splats, which a whole circle that small would be anyway
+#define DEFAULT_LOD_RADIUS 1.0
+// pixels per unit of world the camera can zoom between
+#define MIN_CAMERA_ZOOM 1e-6
+#define MAX_CAMERA_ZOOM 1e3
+#define MAX_CCD_EVENTS_PER_BODY 4
+#define WALL_X -1
+#define WALL_Y -2
+#define NO_IMPACT -3
+#define MAX_CONTACT_COLORS 64
+#define MIN_CONTACTS_PER_THREAD 64
+#define SLEEP_SPEED 2.0
+#define WAKE_SPEED 4.0
+#define SLEEP_FRAMES 60
+#define SLEEP_CONTACT_MARGIN 1.0
+#define REORDER_CHECK_FRAMES 16
+#define MIN_REORDER_OBJECTS 64
+// re-sort once circles adjacent in the array are this many times further apart than right after the last sort
+#define REORDER_DEGRADATION 2.0
+#define MORTON_AXIS_BITS 16
+// a pair of tiles of positions, masses, radii and accumulators fits in L1
+#define PAIR_TILE_SIZE 256
+#define MIN_TILED_OBJECTS 1024
+// a group of circles counts as one mass once its size is below this fraction of its distance
+#define BARNES_HUT_OPENING_ANGLE 0.5
+#define TREE_WALK_CHUNK 256
+// between full builds the tree is refitted to the circles it was built over
+#define TREE_REBUILD_INTERVAL 120
+#define MAX_TREE_GHOST_FRACTION 0.125
+// with multi-rate stepping, circles outside the region of interest take their pull once every this many frames
+#define DEFAULT_FAR_INTERVAL 8
+// and the region reaches this fraction of its size past its edges, so circles are promoted before they show up
+#define ROI_MARGIN 0.25
+#define DEFAULT_SOFTENING_LENGTH 8.0
+// the spline kernel softens gravity within this many softening lengths and leaves it Newtonian beyond
+#define SPLINE_SOFTENING_RATIO 2.8
+// a close pair's orbit is taken through the step in substeps of this fraction of its time scale at their distance
+#define CLOSE_SUBSTEP_FRACTION 0.01
+#define MAX_CLOSE_SUBSTEPS 4096
+// with gravity off, contacts come from a grid once all pairs cost more than binning the circles
+#define MIN_GRID_OBJECTS 256
+#define MAX_GRID_LEVELS 16
+#define GRID_QUERY_CHUNK 256
+#define NEIGHBOUR_SKIN 4.0
+#define NEIGHBOUR_CHECK_CHUNK 1024
+// below this many circles, culling the view checks every circle instead of querying a tree
+#define MIN_VIEW_TREE_OBJECTS 4096
+#define RADIX_BITS 8
+// frames drawn ahead of the capture's writer before they are dropped or drawing waits for it
+#define CAPTURE_BUFFERS 8
+// bodies the state export has room for before its segment first grows
+#define EXPORT_CAPACITY 4096
 
 typedef struct
 {
     SDL_bool alive;
-    Uint16 id;
+    int id;
     RGB24 color;
-    double radius;
+    REAL radius;
     PHYS_BODY phys_comp;
+    SDL_bool asleep;
+    int still_frames;
+    int island; // id of the island's representative while asleep
+    int kicked_frame; // last frame it took its pull on, with multi-rate stepping
 } CIRCLE_OBJ;
 
 typedef struct
 {
     CIRCLE_OBJ *data;
     int size, cap;
+    // slot of each id, possibly stale: check the id found there before trusting it
+    int *slot_of_id;
+    int id_cap;
 } OBJECT_ARRAY;
 
+typedef struct
+{
+    double time;
+    int partner; // index of the other circle, or WALL_X / WALL_Y / NO_IMPACT
+} IMPACT;
+
+typedef struct
+{
+    int i, j;
+} CONTACT;
+
+typedef struct
+{
+    CONTACT *data, *sorted;
+    int size, cap;
+    // contacts of colour c are sorted[batch_start[c] .. batch_start[c + 1]), no circle appears twice in a colour
+    int batch_start[MAX_CONTACT_COLORS + 2];
+    Uint64 *used_colors;
+    int used_colors_cap;
+} CONTACT_ARRAY;
+
+typedef struct
+{
+    ENGINE_2D *engine;
+    CONTACT *contacts;
+} CONTACT_BATCH;
+
+// two circles within the close gap of touching, whose orbit about each other is integrated through the step
+typedef struct
+{
+    int i, j;
+    double dist_squared;
+    // the velocities of i and j that drift them along the chord of the orbit, and those the orbit leaves them with
+    VECTOR_2D drift[2], end[2];
+} CLOSE_PAIR;
+
+// circles packed structure-of-arrays for the tiled pair pass, with the velocity change accumulated for each
+typedef struct
+{
+    REAL *x, *y, *mass, *radius;
+    REAL *dvx, *dvy;
+    // with the potential energy tracked, the mass over distance of the circles each one was paired with
+    REAL *potential;
+    // slot -1 marks a circle gone since the tree was built, which stays in it as a massless ghost
+    int *slot, *id;
+    // with multi-rate stepping, the frames of pull each circle takes in this step, 0 when it sits this one out
+    int *kick_frames;
+    int *asleep;
+    int size, cap;
+    // packed awake circles first for the tiled pass with sleeping, which skips the tiles past num_awake together
+    int num_awake;
+    // one per task of a round, merged in a fixed order so the result doesn't depend on the thread count, along with
+    // the close pairs and the island links found with sleeping
+    CONTACT_ARRAY **round_contacts, **round_close, **round_links;
+    int num_round_contacts;
+} PAIR_TILES;
+
+typedef struct
+{
+    ENGINE_2D *engine;
+    int round, num_tiles;
+    SDL_bool gravity, sleeping;
+} TILE_ROUND;
+
+typedef struct
+{
+    ENGINE_2D *engine;
+    SDL_bool gravity, sleeping;
+} TREE_WALK;
+
+// with sleeping, the grid finds the pairs within the link margin and leaves out those of two sleeping circles
+typedef struct
+{
+    ENGINE_2D *engine;
+    SDL_bool sleeping;
+} GRID_QUERY;
+
+// circles binned by size: the cells of level l are 2^l times the smallest circle's diameter and each circle sits
+// in the cell its centre falls in on the lowest level whose cells are as wide as it, all levels sharing one hash
+typedef struct
+{
+    // per packed circle
+    int *level, *cell_x, *cell_y, *bucket;
+    // the circles of bucket b are entries [bucket_start[b], bucket_start[b + 1])
+    int *bucket_start, *entries;
+    int num_buckets, cap, buckets_cap;
+    REAL cell_size[MAX_GRID_LEVELS];
+    int level_count[MAX_GRID_LEVELS];
+    // added to every radius, so the grid can find pairs that are merely close
+    REAL margin;
+} SIZE_GRID;
+
+// ids of the circles that were within reach of each other plus a skin when the list was built, which holds every
+// pair that can touch for as long as no circle has moved more than half a skin from where it was
+typedef struct
+{
+    CONTACT_ARRAY *pairs;
+    // position of each id below built_next_id at the build
+    REAL *built_x, *built_y;
+    int built_cap;
+    // cleared by updatePositions once some circle has moved too far
+    SDL_bool valid;
+    // built with the link margin added to the skin, for sleeping
+    SDL_bool built_sleeping;
+    int updated_frame, built_next_id, built_merges;
+} NEIGHBOUR_LIST;
+
+// console lines waiting for the next frame boundary in deterministic mode
+typedef struct
+{
+    char (*lines)[INPUT_BUFFER_SIZE];
+    int size, cap;
+} COMMAND_QUEUE;
+
+// the hot loops of a frame, specialised for one combination of mode flags
+typedef struct
+{
+    void (*simulate_gravitational_force)(ENGINE_2D *engine);
+    PARALLEL_FOR_FN resolve_contact_range;
+    void (*update_positions)(ENGINE_2D *engine, double step);
+} STEP_KERNEL;
+
 struct ENGINE_2D
 {
     SDL_Renderer *renderer;
     SDL_mutex *shared_state_mutex;
     SDL_Thread *input_thread;
+    // a byte written to console_wake_fds[1] stops the input thread
+    int console_wake_fds[2];
     FILE *log_file;
     OBJECT_ARRAY *objects;
+    CONTACT_ARRAY *contacts;
+    // pairs within the close gap of touching, for integrateClosePairs
+    CONTACT_ARRAY *close_contacts;
+    CONTACT_ARRAY *island_links;
+    THREAD_POOL *thread_pool;
+    const STEP_KERNEL *step_kernel;
+    ENGINE_2D_CONFIG config;
+    double gravitational_constant;
     double dt;
     int flags;
+    int next_id, log_count;
+    SDL_atomic_t merge_count;
+    SDL_bool owns_console;
+    RANDOM rng;
+    // number of completed steps, which is what commands and replay records are stamped with
+    int frame;
+    COMMAND_QUEUE pending_commands;
+    SDL_bool applying_command;
+    // scripts being applied, each sourced from the one before
+    int script_depth;
+    FILE *record_file;
+    FILE *replay_file;
+    char replay_record[INPUT_BUFFER_SIZE];
+    int replay_frame;
+    SDL_bool replay_at_end;
+    uint64_t replay_checksum;
+    HISTORY *history;
+    int pending_steps;
+    // locality measured right after the last spatial sort, 0 before the first one
+    double sorted_locality;
+    PAIR_TILES pair_tiles;
+    QUADTREE *tree;
+    SIZE_GRID grid;
+    NEIGHBOUR_LIST neighbours;
+    RASTERIZER *rasterizer;
+    // the rasterizer draws into a streaming texture with a renderer, and into frame_pixels without one
+    SDL_Texture *frame_texture;
+    uint32_t *frame_pixels;
+    int frame_width, frame_height;
+    // how the rasterizer draws circles narrower than lod_radius pixels
+    int lod;
+    double lod_radius;
+    // world position at the centre of the view and pixels per unit of world; the view is the size of the output
+    VECTOR_2D camera_centre;
+    double camera_zoom;
+    int view_width, view_height;
+    // the circles indexed by position for culling the view, for when it is drawn again without a step in between
+    PAIR_TILES view_tiles;
+    QUADTREE *view_tree;
+    int view_tree_built_frame, view_tree_updated_frame, view_tree_next_id;
+    int view_drawn_frame;
+    // slots of the circles in view, and room to sort them
+    int *visible, *visible_scratch;
+    int visible_cap;
+    // frames the tree was last built and last brought up to date on, and the next id when it was built
+    int tree_built_frame, tree_updated_frame, tree_next_id;
+    // with MULTI_RATE, circles outside the region of interest take their pull every far_interval frames
+    int far_interval;
+    // corners of the region in world coordinates, the view when empty or the world in deterministic mode
+    VECTOR_2D roi_min, roi_max;
+    // every capture_interval-th frame drawn is copied out for the capture's writer; starting and stopping the
+    // capture takes capture_mutex before shared_state_mutex, so a throttled frame can wait on it outside the latter
+    FRAME_CAPTURE *capture;
+    SDL_mutex *capture_mutex;
+    int capture_interval, capture_count;
+    // every frame's bodies are published here for other processes
+    STATE_EXPORT *state_export;
+    // with DIAGNOSTICS, the force pass adds up the sum over pairs of m1 * m2 / distance while track_potential is set
+    ENGINE_2D_DIAGNOSTICS diagnostics;
+    double potential_sum;
+    SDL_bool track_potential;
+    // what the drift is measured against, which starts over whenever energy isn't expected to carry over
+    double reference_energy, reference_scale, reference_dt;
+    int reference_bodies, reference_merges, reference_asleep;
+    // bodies asleep at the start of the step, whose velocities going to or coming from 0 the energy can't account for
+    int asleep_bodies;
+    SDL_bool dissipated;
+    double drift_limit;
+    int drift_action;
+    SDL_bool halve_dt;
+    // gravity is softened within softening_length of a circle by softening_kernel, the Plummer kernel adding
+    // softening_squared to every squared distance and the spline one taking over within spline_length
+    int softening_kernel;
+    double softening_length, softening_squared, spline_length, spline_squared;
+    // pairs passing within close_gap of touching have their orbit integrated in substeps; step_close_gap is what the
+    // current step uses, 0 when it can't
+    double close_gap, step_close_gap;
+    CLOSE_PAIR *close_pairs;
+    int num_close_pairs, close_pairs_cap;
+    SDL_bool *close_claimed;
+    int close_claimed_cap;
 };
 
 const double π = 3.141592653589793;
-const double G = 6.6743E-11 * PIXELS_PER_METER * PIXELS_PER_METER * PIXELS_PER_METER;
-// const double dt = 1.0 / FRAMES_PER_SEC;
-SDL_bool input_thread_exists = SDL_FALSE;
+const double G = 6.6743E-11;
+// the console reads the process's stdin, so only one engine at a time may own it
+SDL_atomic_t console_claimed;
 
 SDL_bool isPointInsideCircle(VECTOR_2D point, CIRCLE_OBJ circle_obj);
 void logArrInfo();
 void logInfoOf(FILE *log_file, CIRCLE_OBJ *circle_obj);
 void Engine2D_RunSimulation();
 void sanitiseObjectArray();
-void simulateForces();
-void simulateGravitationalForce();
-void handleCollision(CIRCLE_OBJ *c1, CIRCLE_OBJ *c2, SDL_bool is_collision_elastic);
-void updatePositionsAndCheckBounds();
-void RenderFillCircle(SDL_Renderer *renderer, CIRCLE_OBJ *circle_obj);
+void simulateForces(ENGINE_2D *engine);
+const STEP_KERNEL *selectStepKernel(int flags);
+void wakeDisturbedCircles(ENGINE_2D *engine);
+void wakeIsland(OBJECT_ARRAY *objects, CIRCLE_OBJ *circle_obj);
+void updateSleepStates(ENGINE_2D *engine);
+int findIslandRoot(int *parent, int i);
+void handleCollision(CIRCLE_OBJ *c1, CIRCLE_OBJ *c2, SDL_bool is_collision_elastic, double density);
+void bounceCircles(CIRCLE_OBJ *c1, CIRCLE_OBJ *c2);
+void mergeCircles(CIRCLE_OBJ *c1, CIRCLE_OBJ *c2, double density);
+CONTACT_ARRAY *Contacts_Init();
+void Contacts_Free(CONTACT_ARRAY *contacts);
+void addContact(CONTACT_ARRAY *contacts, int i, int j);
+void colorContacts(CONTACT_ARRAY *contacts, int num_objects);
+void resolveContacts(ENGINE_2D *engine);
+void sweepAndResolveImpacts(ENGINE_2D *engine);
+double sweptCircleTimeOfImpact(CIRCLE_OBJ *c1, CIRCLE_OBJ *c2);
+double wallTimeOfImpact(ENGINE_2D *engine, CIRCLE_OBJ *circle_obj, int *wall);
+void findEarliestImpactOf(ENGINE_2D *engine, IMPACT *impacts, int i, double now);
+void RenderFillCircle(ENGINE_2D *engine, CIRCLE_OBJ *circle_obj);
+void startConsole(ENGINE_2D *engine);
+void stopConsole(ENGINE_2D *engine);
 int processUserInput(void *data);
+void handleConsoleLine(ENGINE_2D *engine, char *input);
+void executeCommand(ENGINE_2D *engine, char *input);
+void queueCommand(COMMAND_QUEUE *queue, char *input);
+SDL_bool handleControlCommand(ENGINE_2D *engine, char *command, char *input);
+char *loadScript(const char *path, size_t *size);
+void applyScript(ENGINE_2D *engine, const char *path, const char *text, size_t size);
+void applyFrameInputs(ENGINE_2D *engine);
+void addCircleObject(ENGINE_2D *engine, CIRCLE_OBJ circle_obj);
+void recordCircle(ENGINE_2D *engine, CIRCLE_OBJ *circle_obj);
+void readNextReplayRecord(ENGINE_2D *engine);
+void applyReplayRecord(ENGINE_2D *engine);
+void stopRecording(ENGINE_2D *engine);
+void renderObjects(ENGINE_2D *engine);
+void rasterizeObjects(ENGINE_2D *engine, int num_visible);
+int collectVisibleCircles(ENGINE_2D *engine);
+SDL_bool updateViewTree(ENGINE_2D *engine);
+VECTOR_2D viewOrigin(ENGINE_2D *engine);
+void sortSlots(int *slots, int *scratch, int n, int limit);
+SDL_bool prepareFrameTarget(ENGINE_2D *engine, int width, int height);
+void captureFrame(ENGINE_2D *engine, const uint32_t *pixels, int pitch);
+void exportState(ENGINE_2D *engine);
+void beginDiagnostics(ENGINE_2D *engine);
+void finishDiagnostics(ENGINE_2D *engine);
+void setDriftReference(ENGINE_2D *engine, double energy, int merges);
+void sumTilePotentials(ENGINE_2D *engine, double share);
+REAL softenedInverseCube(const ENGINE_2D *engine, REAL dist_squared);
+REAL softenedInverse(const ENGINE_2D *engine, REAL dist_squared);
+REAL splineInverseCube(REAL length, REAL dist_squared);
+REAL splineInverse(REAL length, REAL dist_squared);
+void integrateClosePairs(ENGINE_2D *engine);
+void integrateClosePair(ENGINE_2D *engine, CLOSE_PAIR *pair);
+void kickClosePair(ENGINE_2D *engine, int i, int j);
+void finishClosePairs(ENGINE_2D *engine);
+void reserveObjects(OBJECT_ARRAY *objects, int cap);
+void indexObjectId(OBJECT_ARRAY *objects, int slot);
+void indexObjectIds(OBJECT_ARRAY *objects);
+double measureLocality(OBJECT_ARRAY *objects);
+void reorderObjectsIfScattered(ENGINE_2D *engine);
+void sortObjectsAlongMortonCurve(OBJECT_ARRAY *objects);
+void simulatePairsTiled(ENGINE_2D *engine, SDL_bool gravity, SDL_bool sleeping);
+void simulatePairsWithTree(ENGINE_2D *engine, SDL_bool gravity, SDL_bool sleeping);
+SDL_bool updateTree(ENGINE_2D *engine, int num_chunks);
+void assignKickFrames(ENGINE_2D *engine);
+int refreshPairTiles(PAIR_TILES *tiles, OBJECT_ARRAY *objects);
+void walkTreeRange(void *context, int begin, int end);
+void walkTree(ENGINE_2D *engine, int point, int chunk, SDL_bool gravity, SDL_bool sleeping);
+void mergeRoundContacts(ENGINE_2D *engine, int num_tasks);
+void sortContacts(ENGINE_2D *engine);
+void applyPairTiles(ENGINE_2D *engine);
+void simulateContactsWithGrid(ENGINE_2D *engine, SDL_bool sleeping);
+SDL_bool buildSizeGrid(SIZE_GRID *grid, PAIR_TILES *tiles, REAL margin);
+void freeSizeGrid(SIZE_GRID *grid);
+void simulateContactsWithNeighbourList(ENGINE_2D *engine, SDL_bool sleeping);
+SDL_bool buildNeighbourList(ENGINE_2D *engine, SDL_bool sleeping);
+void checkNeighbourRange(void *context, int begin, int end);
+void freeNeighbourList(NEIGHBOUR_LIST *list);
+Uint32 hashGridCell(int level, int cell_x, int cell_y);
+void queryGridRange(void *context, int begin, int end);
+void queryGrid(ENGINE_2D *engine, int k, CONTACT_ARRAY *contacts, CONTACT_ARRAY *links, SDL_bool sleeping);
+SDL_bool packPairTiles(PAIR_TILES *tiles, OBJECT_ARRAY *objects, int num_round_tasks, SDL_bool awake_first);
+SDL_bool reserveRoundContacts(PAIR_TILES *tiles, int num_round_tasks);
+void freePairTiles(PAIR_TILES *tiles);
+void interactTileRange(void *context, int begin, int end);
+void interactTiles(ENGINE_2D *engine, int tile_a, int tile_b, int task, SDL_bool gravity, SDL_bool sleeping);
+int compareContacts(const void *a, const void *b);
+int compareClosePairs(const void *a, const void *b);
+void captureHistory(ENGINE_2D *engine);
+SDL_bool isSameCircleApartFromMotion(const void *r1, const void *r2);
+SDL_bool rewindHistory(ENGINE_2D *engine, int frames);
 void handleCreateCommand(ENGINE_2D *engine, char *input);
 void handleClearCommand(ENGINE_2D *engine, char *input);
 void handleSetCommand(ENGINE_2D *engine, char *input);
 void handlePauseCommand(ENGINE_2D *engine, char *input);
 void handleResumeCommand(ENGINE_2D *engine, char *input);
+void handleStepCommand(ENGINE_2D *engine, char *input);
+void handleRewindCommand(ENGINE_2D *engine, char *input);
+void handleSourceCommand(ENGINE_2D *engine, char *input);
+void handleStatsCommand(ENGINE_2D *engine, char *input);
 CIRCLE_OBJ *findCircleById(OBJECT_ARRAY *objects, int id);
-SDL_bool tryParseIntOptionArg(char *command_name, char *input_flag, char *short_option, char *long_option, int *p_arg_value);
-SDL_bool tryParseFloatOptionArg(char *command_name, char *input_flag, char *short_option, char *long_option, double *p_arg_value);
-SDL_bool tryParseCharOptionArg(char *command_name, char *input_flag, char *short_option, char *long_option, char *p_arg_value);
-SDL_bool tryParseStrOptionArg(char *command_name, char *input_flag, char *short_option, char *long_option, char *buffer, int buf_size);
+SDL_bool tryParseIntOptionArg(char *command_name, char *input_flag, char **save_ptr, char *short_option, char *long_option, int *p_arg_value);
+SDL_bool tryParseFloatOptionArg(char *command_name, char *input_flag, char **save_ptr, char *short_option, char *long_option, double *p_arg_value);
+SDL_bool tryParseCharOptionArg(char *command_name, char *input_flag, char **save_ptr, char *short_option, char *long_option, char *p_arg_value);
+SDL_bool tryParseStrOptionArg(char *command_name, char *input_flag, char **save_ptr, char *short_option, char *long_option, char *buffer, int buf_size);
 
 OBJECT_ARRAY *Objects_Init()
 {
@@ -82,35 +456,480 @@ OBJECT_ARRAY *Objects_Init()
     objects->cap = DEFAULT_ARR_CAPACITY;
     objects->size = 0;
     objects->data = (CIRCLE_OBJ *)malloc(sizeof(CIRCLE_OBJ) * objects->cap);
+    objects->slot_of_id = NULL;
+    objects->id_cap = 0;
     return objects;
 }
 
-void *Objects_Free(OBJECT_ARRAY *objects)
+void Objects_Free(OBJECT_ARRAY *objects)
 {
+    free(objects->slot_of_id);
     free(objects->data);
     objects->data = NULL;
     objects->cap = objects->size = 0;
     free(objects);
 }
 
+CONTACT_ARRAY *Contacts_Init()
+{
+    CONTACT_ARRAY *contacts = (CONTACT_ARRAY *)calloc(1, sizeof(CONTACT_ARRAY));
+    contacts->cap = DEFAULT_ARR_CAPACITY;
+    contacts->data = (CONTACT *)malloc(sizeof(CONTACT) * contacts->cap);
+    contacts->sorted = (CONTACT *)malloc(sizeof(CONTACT) * contacts->cap);
+    return contacts;
+}
+
+void Contacts_Free(CONTACT_ARRAY *contacts)
+{
+    free(contacts->data);
+    free(contacts->sorted);
+    free(contacts->used_colors);
+    free(contacts);
+}
+
+ENGINE_2D_CONFIG Engine2D_DefaultConfig()
+{
+    return (ENGINE_2D_CONFIG){
+        .world_width = DEFAULT_WORLD_WIDTH,
+        .world_height = DEFAULT_WORLD_HEIGHT,
+        .pixels_per_meter = DEFAULT_PIXELS_PER_METER,
+        .density = DEFAULT_DENSITY,
+        .buffer_zone = DEFAULT_BUFFER_ZONE,
+        .num_threads = 0,
+        .seed = 1,
+        .history_budget = 0,
+        .keyframe_interval = DEFAULT_KEYFRAME_INTERVAL,
+    };
+}
+
 ENGINE_2D *Engine2D_Init(void *renderer, void *shared_state_mutex, void *log_file, int fps, int flags)
 {
-    ENGINE_2D *engine = (ENGINE_2D *)malloc(sizeof(ENGINE_2D));
+    return Engine2D_InitWithConfig(Engine2D_DefaultConfig(), renderer, shared_state_mutex, log_file, fps, flags);
+}
+
+ENGINE_2D *Engine2D_InitWithConfig(ENGINE_2D_CONFIG config, void *renderer, void *shared_state_mutex, void *log_file, int fps, int flags)
+{
+    ENGINE_2D *engine = (ENGINE_2D *)calloc(1, sizeof(ENGINE_2D));
     engine->renderer = renderer;
     engine->shared_state_mutex = shared_state_mutex;
     engine->log_file = log_file;
+    engine->config = config;
+    // G in pixels^3 / (kg s^2)
+    engine->gravitational_constant = G * config.pixels_per_meter * config.pixels_per_meter * config.pixels_per_meter;
     engine->dt = 1.0 / fps;
     engine->flags = flags;
+    engine->next_id = 1;
+    engine->log_count = 1;
+    Random_Seed(&engine->rng, config.seed);
     engine->objects = Objects_Init();
-    if ((engine->flags & ENABLE_INPUT) && !input_thread_exists)
+    engine->contacts = Contacts_Init();
+    engine->close_contacts = Contacts_Init();
+    engine->island_links = Contacts_Init();
+    engine->tree = Quadtree_Init();
+    // so the first frame with Barnes-Hut on builds the tree
+    engine->tree_updated_frame = -2;
+    engine->far_interval = DEFAULT_FAR_INTERVAL;
+    engine->diagnostics.reference_frame = -1;
+    // what a softening kernel uses once it is picked, with none picked yet
+    engine->softening_length = DEFAULT_SOFTENING_LENGTH;
+    engine->neighbours.pairs = Contacts_Init();
+    engine->neighbours.updated_frame = -2;
+    engine->rasterizer = Rasterizer_Init();
+    engine->lod = RASTERIZER_LOD_SPLATS;
+    engine->lod_radius = DEFAULT_LOD_RADIUS;
+    // the view starts out showing the world the size it is, corner to corner when it is as big as the output
+    engine->camera_centre = (VECTOR_2D){config.world_width / 2, config.world_height / 2};
+    engine->camera_zoom = 1;
+    engine->view_width = config.world_width;
+    engine->view_height = config.world_height;
+    engine->view_tree = Quadtree_Init();
+    engine->view_drawn_frame = -1;
+    HISTORY_LAYOUT history_layout = {sizeof(CIRCLE_OBJ), offsetof(CIRCLE_OBJ, phys_comp), isSameCircleApartFromMotion};
+    engine->history = History_Init(history_layout, config.history_budget, config.keyframe_interval);
+    engine->capture_mutex = SDL_CreateMutex();
+    engine->thread_pool = ThreadPool_Init(config.num_threads > 0 ? config.num_threads : SDL_GetCPUCount());
+    if ((engine->flags & ENABLE_INPUT) && SDL_AtomicCAS(&console_claimed, 0, 1))
+        startConsole(engine);
+    return engine;
+}
+
+int Engine2D_GetFlags(ENGINE_2D *engine)
+{
+    SDL_LockMutex(engine->shared_state_mutex);
+    int flags = engine->flags;
+    SDL_UnlockMutex(engine->shared_state_mutex);
+    return flags;
+}
+
+void Engine2D_SetTimeStep(ENGINE_2D *engine, double dt)
+{
+    SDL_LockMutex(engine->shared_state_mutex);
+    engine->dt = dt;
+    if (engine->record_file != NULL)
+        fprintf(engine->record_file, "%d dt %a\n", engine->frame, dt);
+    SDL_UnlockMutex(engine->shared_state_mutex);
+}
+
+RANDOM *Engine2D_GetRandom(ENGINE_2D *engine)
+{
+    return &engine->rng;
+}
+
+// the frame the rasterizer last drew without a renderer, for capturing frames offscreen
+const uint32_t *Engine2D_GetFramebuffer(ENGINE_2D *engine, int *width, int *height)
+{
+    SDL_LockMutex(engine->shared_state_mutex);
+    const uint32_t *pixels = engine->frame_pixels;
+    *width = engine->frame_width;
+    *height = engine->frame_height;
+    SDL_UnlockMutex(engine->shared_state_mutex);
+    return pixels;
+}
+
+// moves the view by offset pixels, so whatever was under a point on screen ends up offset away from it
+void Engine2D_PanCamera(ENGINE_2D *engine, VECTOR_2D offset)
+{
+    SDL_LockMutex(engine->shared_state_mutex);
+    engine->camera_centre.x -= offset.x / engine->camera_zoom;
+    engine->camera_centre.y -= offset.y / engine->camera_zoom;
+    SDL_UnlockMutex(engine->shared_state_mutex);
+}
+
+// scales the zoom by factor, keeping the world position under point where it is on screen
+void Engine2D_ZoomCamera(ENGINE_2D *engine, VECTOR_2D point, double factor)
+{
+    SDL_LockMutex(engine->shared_state_mutex);
+    VECTOR_2D origin = viewOrigin(engine);
+    VECTOR_2D anchor = {origin.x + point.x / engine->camera_zoom, origin.y + point.y / engine->camera_zoom};
+    engine->camera_zoom = SDL_clamp(engine->camera_zoom * factor, MIN_CAMERA_ZOOM, MAX_CAMERA_ZOOM);
+    origin = viewOrigin(engine);
+    engine->camera_centre.x += anchor.x - (origin.x + point.x / engine->camera_zoom);
+    engine->camera_centre.y += anchor.y - (origin.y + point.y / engine->camera_zoom);
+    SDL_UnlockMutex(engine->shared_state_mutex);
+}
+
+// circles outside the region step the pull on them at a coarser rate with MULTI_RATE on, an empty region meaning the view
+void Engine2D_SetRegionOfInterest(ENGINE_2D *engine, VECTOR_2D min, VECTOR_2D max)
+{
+    SDL_LockMutex(engine->shared_state_mutex);
+    engine->roi_min = min;
+    engine->roi_max = max;
+    SDL_UnlockMutex(engine->shared_state_mutex);
+}
+
+VECTOR_2D Engine2D_ScreenToWorld(ENGINE_2D *engine, VECTOR_2D point)
+{
+    SDL_LockMutex(engine->shared_state_mutex);
+    VECTOR_2D origin = viewOrigin(engine);
+    VECTOR_2D world = {origin.x + point.x / engine->camera_zoom, origin.y + point.y / engine->camera_zoom};
+    SDL_UnlockMutex(engine->shared_state_mutex);
+    return world;
+}
+
+// streams every interval-th frame drawn to path as raw RGB24, or to a command given as "|command"; when the writer
+// falls behind, frames are dropped, or with throttle set the next frame waits for it without holding the engine's
+// lock. The program should ignore SIGPIPE if a command that exits early isn't to end it
+int Engine2D_StartCapture(ENGINE_2D *engine, const char *path, int interval, int throttle)
+{
+    SDL_LockMutex(engine->capture_mutex);
+    SDL_LockMutex(engine->shared_state_mutex);
+    if (engine->capture != NULL || interval < 1)
+    {
+        SDL_UnlockMutex(engine->shared_state_mutex);
+        SDL_UnlockMutex(engine->capture_mutex);
+        fprintf(stderr, engine->capture != NULL ? "capture: already capturing\n" : "capture: interval must be at least 1\n");
+        return -1;
+    }
+    engine->capture = FrameCapture_Open(path, CAPTURE_BUFFERS, throttle ? FRAME_CAPTURE_THROTTLE : FRAME_CAPTURE_DROP);
+    engine->capture_interval = interval;
+    engine->capture_count = 0;
+    int status = engine->capture != NULL ? 0 : -1;
+    SDL_UnlockMutex(engine->shared_state_mutex);
+    SDL_UnlockMutex(engine->capture_mutex);
+    return status;
+}
+
+void Engine2D_StopCapture(ENGINE_2D *engine)
+{
+    SDL_LockMutex(engine->capture_mutex);
+    SDL_LockMutex(engine->shared_state_mutex);
+    FRAME_CAPTURE *capture = engine->capture;
+    engine->capture = NULL;
+    SDL_UnlockMutex(engine->shared_state_mutex);
+    SDL_UnlockMutex(engine->capture_mutex);
+    if (capture == NULL)
+        return;
+    FRAME_CAPTURE_STATS stats = FrameCapture_Close(capture);
+    printf("capture: wrote %d frames of %dx%d rgb24, dropped %d%s\n", stats.frames_written, stats.width, stats.height,
+           stats.frames_dropped, stats.failed ? ", stopped by an error" : "");
+}
+
+// publishes the bodies after every frame into the POSIX shared memory segment called name, such as "/engine2d"
+int Engine2D_StartExport(ENGINE_2D *engine, const char *name)
+{
+    SDL_LockMutex(engine->shared_state_mutex);
+    if (engine->state_export != NULL)
+    {
+        SDL_UnlockMutex(engine->shared_state_mutex);
+        fprintf(stderr, "export: already exporting\n");
+        return -1;
+    }
+    engine->state_export = StateExport_Open(name, SDL_max(engine->objects->size, EXPORT_CAPACITY));
+    // readers see the bodies as they are now, not only once the next frame is done
+    if (engine->state_export != NULL)
+        exportState(engine);
+    SDL_UnlockMutex(engine->shared_state_mutex);
+    return engine->state_export != NULL ? 0 : -1;
+}
+
+void Engine2D_StopExport(ENGINE_2D *engine)
+{
+    SDL_LockMutex(engine->shared_state_mutex);
+    if (engine->state_export != NULL)
+        StateExport_Close(engine->state_export);
+    engine->state_export = NULL;
+    SDL_UnlockMutex(engine->shared_state_mutex);
+}
+
+// runs the commands in the script at path as if typed at the console, all between the same two frames
+int Engine2D_RunScript(ENGINE_2D *engine, const char *path)
+{
+    size_t size;
+    char *text = loadScript(path, &size);
+    if (text == NULL)
+        return -1;
+    applyScript(engine, path, text, size);
+    free(text);
+    return 0;
+}
+
+// runs size bytes of console commands, one per line, as a script
+void Engine2D_RunCommands(ENGINE_2D *engine, const char *text, size_t size, const char *source)
+{
+    applyScript(engine, source, text, size);
+}
+
+// hashes the state of every live circle, so two runs can be compared bit for bit
+uint64_t Engine2D_Checksum(ENGINE_2D *engine)
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+    SDL_LockMutex(engine->shared_state_mutex);
+    for (int i = 0; i < engine->objects->size; i++)
+    {
+        CIRCLE_OBJ *circle_obj = engine->objects->data + i;
+        if (!circle_obj->alive)
+            continue;
+        REAL fields[] = {
+            circle_obj->radius,
+            circle_obj->phys_comp.mass,
+            circle_obj->phys_comp.pos.x,
+            circle_obj->phys_comp.pos.y,
+            circle_obj->phys_comp.vel.x,
+            circle_obj->phys_comp.vel.y,
+        };
+        const unsigned char *bytes = (const unsigned char *)fields;
+        for (size_t b = 0; b < sizeof(fields); b++)
+            hash = (hash ^ bytes[b]) * FNV_PRIME;
+        hash = (hash ^ circle_obj->id) * FNV_PRIME;
+    }
+    SDL_UnlockMutex(engine->shared_state_mutex);
+    return hash;
+}
+
+// writes the engine's settings and current circles to path, then every input from here on
+int Engine2D_StartRecording(ENGINE_2D *engine, const char *path)
+{
+    SDL_LockMutex(engine->shared_state_mutex);
+    if (engine->frame != 0 || engine->record_file != NULL)
+    {
+        SDL_UnlockMutex(engine->shared_state_mutex);
+        fprintf(stderr, "record: recording must start before the first frame\n");
+        return -1;
+    }
+    engine->record_file = fopen(path, "w");
+    if (engine->record_file == NULL)
+    {
+        SDL_UnlockMutex(engine->shared_state_mutex);
+        fprintf(stderr, "record: cannot open '%s'\n", path);
+        return -1;
+    }
+    // console commands must land on frame boundaries to be replayable
+    engine->flags |= DETERMINISTIC;
+    fprintf(engine->record_file,
+            "ENGINE2D_REPLAY %d\n"
+            "precision %s\n"
+            "seed %llu\n"
+            "flags %d\n"
+            "dt %a\n"
+            "world %a %a\n"
+            "pixels_per_meter %a\n"
+            "density %a\n"
+            "buffer_zone %a\n",
+            REPLAY_VERSION, sizeof(REAL) == sizeof(float) ? "single" : "double",
+            (unsigned long long)engine->config.seed, engine->flags & ~(ENABLE_INPUT | PAUSED), engine->dt,
+            engine->config.world_width, engine->config.world_height, engine->config.pixels_per_meter,
+            engine->config.density, engine->config.buffer_zone);
+    // the first step compacts the array the same way, so dump it in that order
+    sanitiseObjectArray(engine->objects);
+    for (int i = 0; i < engine->objects->size; i++)
+        recordCircle(engine, engine->objects->data + i);
+    fprintf(engine->record_file, "%d next_id %d\n", engine->frame, engine->next_id);
+    SDL_UnlockMutex(engine->shared_state_mutex);
+    return 0;
+}
+
+ENGINE_2D *Engine2D_LoadReplay(const char *path, void *renderer, void *shared_state_mutex, int num_threads)
+{
+    FILE *replay_file = fopen(path, "r");
+    if (replay_file == NULL)
+    {
+        fprintf(stderr, "replay: cannot open '%s'\n", path);
+        return NULL;
+    }
+    ENGINE_2D_CONFIG config = Engine2D_DefaultConfig();
+    config.num_threads = num_threads;
+    int version, flags;
+    unsigned long long seed;
+    double dt;
+    char precision[REPLAY_KIND_SIZE];
+    int fields = fscanf(replay_file,
+                        "ENGINE2D_REPLAY %d precision %15s seed %llu flags %d dt %lf world %lf %lf "
+                        "pixels_per_meter %lf density %lf buffer_zone %lf ",
+                        &version, precision, &seed, &flags, &dt, &config.world_width, &config.world_height,
+                        &config.pixels_per_meter, &config.density, &config.buffer_zone);
+    if (fields != 10 || version != REPLAY_VERSION)
+    {
+        fprintf(stderr, "replay: '%s' is not a version %d replay file\n", path, REPLAY_VERSION);
+        fclose(replay_file);
+        return NULL;
+    }
+    if (strcmp(precision, sizeof(REAL) == sizeof(float) ? "single" : "double") != 0)
+    {
+        fprintf(stderr, "replay: '%s' was recorded in %s precision, rebuild with the same PRECISION\n", path, precision);
+        fclose(replay_file);
+        return NULL;
+    }
+    config.seed = seed;
+    ENGINE_2D *engine = Engine2D_InitWithConfig(config, renderer, shared_state_mutex, NULL, 1, flags | DETERMINISTIC);
+    engine->dt = dt;
+    engine->replay_file = replay_file;
+    readNextReplayRecord(engine);
+    return engine;
+}
+
+// true once every recorded frame has been stepped; the checksum is 0 if the recording was cut short
+int Engine2D_IsReplayFinished(ENGINE_2D *engine, uint64_t *recorded_checksum)
+{
+    SDL_LockMutex(engine->shared_state_mutex);
+    SDL_bool is_finished = engine->replay_file == NULL || engine->replay_frame < 0 ||
+                           (engine->replay_at_end && engine->frame >= engine->replay_frame);
+    if (recorded_checksum != NULL)
+        *recorded_checksum = engine->replay_at_end ? engine->replay_checksum : 0;
+    SDL_UnlockMutex(engine->shared_state_mutex);
+    return is_finished;
+}
+
+ENGINE_2D_STATS Engine2D_GetStats(ENGINE_2D *engine)
+{
+    ENGINE_2D_STATS stats = {0};
+    SDL_LockMutex(engine->shared_state_mutex);
+    OBJECT_ARRAY *objects = engine->objects;
+    for (int i = 0; i < objects->size; i++)
+    {
+        if (!objects->data[i].alive)
+            continue;
+        PHYS_BODY *body = &objects->data[i].phys_comp;
+        stats.bodies++;
+        stats.kinetic_energy += 0.5 * body->mass * Vector2D_DotProduct(body->vel, body->vel);
+        // without gravity the bodies don't interact at a distance, so there is no potential energy to count
+        if (!(engine->flags & ENABLE_GRAVITY))
+            continue;
+        for (int j = i + 1; j < objects->size; j++)
+        {
+            if (!objects->data[j].alive)
+                continue;
+            VECTOR_2D displacement = Vector2D_Difference(objects->data[j].phys_comp.pos, body->pos);
+            double dist_squared = Vector2D_DotProduct(displacement, displacement);
+            if (dist_squared > 0)
+                stats.potential_energy -= engine->gravitational_constant * body->mass * objects->data[j].phys_comp.mass *
+                                          softenedInverse(engine, dist_squared);
+        }
+    }
+    stats.merges = SDL_AtomicGet(&engine->merge_count);
+    SDL_UnlockMutex(engine->shared_state_mutex);
+    return stats;
+}
+
+// the quantities as of the start of the last step taken with DIAGNOSTICS on
+ENGINE_2D_DIAGNOSTICS Engine2D_GetDiagnostics(ENGINE_2D *engine)
+{
+    SDL_LockMutex(engine->shared_state_mutex);
+    ENGINE_2D_DIAGNOSTICS diagnostics = engine->diagnostics;
+    SDL_UnlockMutex(engine->shared_state_mutex);
+    return diagnostics;
+}
+
+// acts once the energy drifts by more than limit, a fraction of the energy at the reference frame; 0 never does
+void Engine2D_SetDriftLimit(ENGINE_2D *engine, double limit, int action)
+{
+    SDL_LockMutex(engine->shared_state_mutex);
+    engine->drift_limit = limit;
+    engine->drift_action = action;
+    SDL_UnlockMutex(engine->shared_state_mutex);
+}
+
+// softens gravity within length units of a circle's centre with one of the SOFTENING_KERNELS
+void Engine2D_SetSoftening(ENGINE_2D *engine, int kernel, double length)
+{
+    SDL_LockMutex(engine->shared_state_mutex);
+    engine->softening_kernel = kernel;
+    engine->softening_length = length;
+    engine->softening_squared = kernel == SOFTENING_PLUMMER ? length * length : 0;
+    engine->spline_length = kernel == SOFTENING_SPLINE ? SPLINE_SOFTENING_RATIO * length : 0;
+    engine->spline_squared = engine->spline_length * engine->spline_length;
+    SDL_UnlockMutex(engine->shared_state_mutex);
+}
+
+// integrates the orbits of pairs that pass within gap units of touching in substeps instead of one kick a step,
+// never if gap is 0
+void Engine2D_SetCloseEncounters(ENGINE_2D *engine, double gap)
+{
+    SDL_LockMutex(engine->shared_state_mutex);
+    engine->close_gap = gap;
+    SDL_UnlockMutex(engine->shared_state_mutex);
+}
+
+int Engine2D_FindCircleAt(ENGINE_2D *engine, VECTOR_2D point)
+{
+    int id = 0;
+    SDL_LockMutex(engine->shared_state_mutex);
+    for (int i = 0; i < engine->objects->size; i++)
     {
-        engine->input_thread = SDL_CreateThread(processUserInput, "input thread", engine);
-        input_thread_exists = SDL_TRUE;
+        if (engine->objects->data[i].alive && isPointInsideCircle(point, engine->objects->data[i]))
+        {
+            id = engine->objects->data[i].id;
+            break;
+        }
     }
+    SDL_UnlockMutex(engine->shared_state_mutex);
+    return id;
+}
+
+void Engine2D_LogObjects(ENGINE_2D *engine)
+{
+    if (engine->log_file != NULL)
+        logArrInfo(engine);
 }
 
 void Engine2D_Free(ENGINE_2D *engine)
 {
+    // first, as a command being typed in may still use everything else
+    if (engine->owns_console)
+        stopConsole(engine);
+    stopRecording(engine);
+    Engine2D_StopCapture(engine);
+    SDL_DestroyMutex(engine->capture_mutex);
+    Engine2D_StopExport(engine);
     engine->renderer = NULL;
     engine->shared_state_mutex = NULL;
     engine->log_file = NULL;
@@ -118,6 +937,32 @@ void Engine2D_Free(ENGINE_2D *engine)
     engine->flags = 0;
     Objects_Free(engine->objects);
     engine->objects = NULL;
+    Contacts_Free(engine->contacts);
+    engine->contacts = NULL;
+    Contacts_Free(engine->close_contacts);
+    engine->close_contacts = NULL;
+    Contacts_Free(engine->island_links);
+    engine->island_links = NULL;
+    ThreadPool_Free(engine->thread_pool);
+    engine->thread_pool = NULL;
+    if (engine->replay_file != NULL)
+        fclose(engine->replay_file);
+    free(engine->pending_commands.lines);
+    History_Free(engine->history);
+    freePairTiles(&engine->pair_tiles);
+    Quadtree_Free(engine->tree);
+    freeSizeGrid(&engine->grid);
+    freeNeighbourList(&engine->neighbours);
+    Rasterizer_Free(engine->rasterizer);
+    if (engine->frame_texture != NULL)
+        SDL_DestroyTexture(engine->frame_texture);
+    free(engine->frame_pixels);
+    freePairTiles(&engine->view_tiles);
+    Quadtree_Free(engine->view_tree);
+    free(engine->visible);
+    free(engine->visible_scratch);
+    free(engine->close_pairs);
+    free(engine->close_claimed);
     free(engine);
 }
 
@@ -129,8 +974,7 @@ SDL_bool isPointInsideCircle(VECTOR_2D point, CIRCLE_OBJ circle_obj)
 
 void logArrInfo(ENGINE_2D *engine)
 {
-    static int log_count = 1;
-    fprintf(engine->log_file, "ENTRY: #%d\n", log_count);
+    fprintf(engine->log_file, "ENTRY: #%d\n", engine->log_count);
     SDL_LockMutex(engine->shared_state_mutex);
     for (int i = 0; i < engine->objects->size; i++)
     {
@@ -138,7 +982,7 @@ void logArrInfo(ENGINE_2D *engine)
         logInfoOf(engine->log_file, engine->objects->data + i);
     }
     SDL_UnlockMutex(engine->shared_state_mutex);
-    log_count++;
+    engine->log_count++;
 }
 
 void logInfoOf(FILE *log_file, CIRCLE_OBJ *circle_obj)
@@ -156,275 +1000,2861 @@ void logInfoOf(FILE *log_file, CIRCLE_OBJ *circle_obj)
 
 void Engine2D_CreateCircleObject(ENGINE_2D *engine, RGB24 color, double radius, PHYS_BODY phys_comp)
 {
-    static int id = 1;
+    SDL_LockMutex(engine->shared_state_mutex);
 
     CIRCLE_OBJ circle_obj = {
         .alive = SDL_TRUE,
-        .id = id++,
+        .id = engine->next_id++,
         .color = color,
         .radius = radius,
         .phys_comp = phys_comp,
     };
+    addCircleObject(engine, circle_obj);
+    // a recorded command recreates its own circles on replay
+    if (engine->record_file != NULL && !engine->applying_command)
+        recordCircle(engine, &circle_obj);
 
-    SDL_LockMutex(engine->shared_state_mutex);
+    SDL_UnlockMutex(engine->shared_state_mutex);
+}
 
-    if (engine->objects->size >= engine->objects->cap)
+// adds count circles under one lock, numbered on from the id returned; the ids in bodies are ignored
+int Engine2D_CreateCircleObjects(ENGINE_2D *engine, const ENGINE_2D_BODY *bodies, int count)
+{
+    SDL_LockMutex(engine->shared_state_mutex);
+    int first_id = engine->next_id;
+    reserveObjects(engine->objects, engine->objects->size + count);
+    for (int b = 0; b < count; b++)
     {
-        CIRCLE_OBJ *temp = (CIRCLE_OBJ *)realloc(engine->objects->data, engine->objects->cap * 4 * sizeof(CIRCLE_OBJ));
-        if (temp)
-        {
-            engine->objects->cap *= 4;
-            engine->objects->data = temp;
-        }
-        else
-            fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+        CIRCLE_OBJ circle_obj = {
+            .alive = SDL_TRUE,
+            .id = engine->next_id++,
+            .color = bodies[b].color,
+            .radius = bodies[b].radius,
+            .phys_comp = bodies[b].phys_comp,
+        };
+        addCircleObject(engine, circle_obj);
+        if (engine->record_file != NULL)
+            recordCircle(engine, &circle_obj);
     }
-    engine->objects->data[engine->objects->size++] = circle_obj;
-
     SDL_UnlockMutex(engine->shared_state_mutex);
+    return first_id;
 }
 
-void Engine2D_RunSimulation(ENGINE_2D *engine)
+// clears the circles with the given ids, or every circle when ids is NULL; returns how many there were
+int Engine2D_ClearCircleObjects(ENGINE_2D *engine, const int *ids, int count)
 {
+    int cleared = 0;
     SDL_LockMutex(engine->shared_state_mutex);
+    if (ids == NULL)
+    {
+        for (int i = 0; i < engine->objects->size; i++)
+            cleared += engine->objects->data[i].alive;
+        engine->objects->size = 0;
+        if (engine->record_file != NULL)
+            fprintf(engine->record_file, "%d command clear\n", engine->frame);
+    }
+    for (int k = 0; ids != NULL && k < count; k++)
+    {
+        CIRCLE_OBJ *circle_obj = findCircleById(engine->objects, ids[k]);
+        if (circle_obj == NULL || !circle_obj->alive)
+            continue;
+        circle_obj->alive = SDL_FALSE;
+        cleared++;
+        if (engine->record_file != NULL)
+            fprintf(engine->record_file, "%d command clear --id %d\n", engine->frame, ids[k]);
+    }
+    SDL_UnlockMutex(engine->shared_state_mutex);
+    return cleared;
+}
 
-    sanitiseObjectArray(engine->objects);
-    simulateForces(engine);
-    updatePositionsAndCheckBounds(engine);
+// copies up to cap live circles into bodies, holding the lock for the copy alone, and returns how many there are,
+// which is more than cap when bodies is too small for all of them
+int Engine2D_ReadBodies(ENGINE_2D *engine, ENGINE_2D_BODY *bodies, int cap, int *frame)
+{
+    int count = 0;
+    SDL_LockMutex(engine->shared_state_mutex);
     for (int i = 0; i < engine->objects->size; i++)
-        RenderFillCircle(engine->renderer, engine->objects->data + i);
-
+    {
+        CIRCLE_OBJ *circle_obj = engine->objects->data + i;
+        if (!circle_obj->alive)
+            continue;
+        if (count < cap)
+            bodies[count] = (ENGINE_2D_BODY){circle_obj->id, circle_obj->color, circle_obj->radius, circle_obj->phys_comp};
+        count++;
+    }
+    if (frame != NULL)
+        *frame = engine->frame;
     SDL_UnlockMutex(engine->shared_state_mutex);
+    return count;
 }
 
-void sanitiseObjectArray(OBJECT_ARRAY *objects)
+void addCircleObject(ENGINE_2D *engine, CIRCLE_OBJ circle_obj)
 {
-    int i = 0, j = objects->size;
-    while (i < j)
+    circle_obj.kicked_frame = engine->frame - 1;
+    if (engine->objects->size >= engine->objects->cap)
+        reserveObjects(engine->objects, engine->objects->cap * 4);
+    if (engine->objects->size < engine->objects->cap)
     {
-        if (objects->data[i].alive)
-            i++;
-        else
-            objects->data[i] = objects->data[--j];
+        engine->objects->data[engine->objects->size] = circle_obj;
+        indexObjectId(engine->objects, engine->objects->size++);
     }
-    // all elements before i are alive, and all elements from j onwards are dead
-    // when i == j, the loop ends and i points to a dead element
-    // therefore total num of alive elements is i
-    objects->size = i;
+}
 
-    if (objects->size < objects->cap / 8)
+void reserveObjects(OBJECT_ARRAY *objects, int cap)
+{
+    if (cap <= objects->cap)
+        return;
+    CIRCLE_OBJ *temp = (CIRCLE_OBJ *)realloc(objects->data, cap * sizeof(CIRCLE_OBJ));
+    if (temp)
     {
-        CIRCLE_OBJ *temp = (CIRCLE_OBJ *)realloc(objects->data, objects->cap / 2 * sizeof(CIRCLE_OBJ));
-        if (temp)
+        objects->cap = cap;
+        objects->data = temp;
+    }
+    else
+        fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+}
+
+void indexObjectId(OBJECT_ARRAY *objects, int slot)
+{
+    int id = objects->data[slot].id;
+    if (id >= objects->id_cap)
+    {
+        int id_cap = SDL_max(id + 1, objects->id_cap * 2);
+        int *temp = (int *)realloc(objects->slot_of_id, id_cap * sizeof(int));
+        if (temp == NULL)
         {
-            objects->cap /= 2;
-            objects->data = temp;
-        }
-        else
             fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+            return;
+        }
+        for (int k = objects->id_cap; k < id_cap; k++)
+            temp[k] = -1;
+        objects->id_cap = id_cap;
+        objects->slot_of_id = temp;
     }
+    objects->slot_of_id[id] = slot;
 }
 
-void simulateForces(ENGINE_2D *engine)
+void indexObjectIds(OBJECT_ARRAY *objects)
 {
-    simulateGravitationalForce(engine);
+    for (int i = 0; i < objects->size; i++)
+        indexObjectId(objects, i);
 }
 
-void simulateGravitationalForce(ENGINE_2D *engine)
+// mean distance between circles next to each other in the array, in units of the mean spacing between circles
+double measureLocality(OBJECT_ARRAY *objects)
 {
-    for (int i = 0; i < engine->objects->size - 1; i++)
+    if (objects->size < 2)
+        return 0;
+    VECTOR_2D min = objects->data[0].phys_comp.pos, max = min;
+    double total = 0;
+    for (int i = 1; i < objects->size; i++)
     {
-        if (!engine->objects->data[i].alive)
+        VECTOR_2D pos = objects->data[i].phys_comp.pos;
+        min.x = SDL_min(min.x, pos.x);
+        min.y = SDL_min(min.y, pos.y);
+        max.x = SDL_max(max.x, pos.x);
+        max.y = SDL_max(max.y, pos.y);
+        total += Vector2D_Magnitude(Vector2D_Difference(pos, objects->data[i - 1].phys_comp.pos));
+    }
+    double spacing = SDL_sqrt(SDL_max((max.x - min.x) * (max.y - min.y), 1.0) / objects->size);
+    return total / (objects->size - 1) / spacing;
+}
+
+// circles drift away from their neighbours in memory as they move, so re-sort them once that has got bad enough
+void reorderObjectsIfScattered(ENGINE_2D *engine)
+{
+    if (engine->frame % REORDER_CHECK_FRAMES != 0 || engine->objects->size < MIN_REORDER_OBJECTS)
+        return;
+    if (measureLocality(engine->objects) <= REORDER_DEGRADATION * engine->sorted_locality)
+        return;
+    sortObjectsAlongMortonCurve(engine->objects);
+    engine->sorted_locality = measureLocality(engine->objects);
+    History_RequestKeyframe(engine->history);
+}
+
+void sortObjectsAlongMortonCurve(OBJECT_ARRAY *objects)
+{
+    int n = objects->size;
+    Uint32 *keys = (Uint32 *)malloc(2 * n * sizeof(Uint32));
+    int *order = (int *)malloc(2 * n * sizeof(int));
+    CIRCLE_OBJ *sorted = (CIRCLE_OBJ *)malloc(objects->cap * sizeof(CIRCLE_OBJ));
+    if (keys == NULL || order == NULL || sorted == NULL)
+    {
+        fprintf(stderr, "ALLOCATION FAILED in %s\n", __func__);
+        free(keys);
+        free(order);
+        free(sorted);
+        return;
+    }
+
+    // quantise within the circles' bounding box rather than the world, since unwalled circles can leave it
+    VECTOR_2D min = objects->data[0].phys_comp.pos, max = min;
+    for (int i = 1; i < n; i++)
+    {
+        min.x = SDL_min(min.x, objects->data[i].phys_comp.pos.x);
+        min.y = SDL_min(min.y, objects->data[i].phys_comp.pos.y);
+        max.x = SDL_max(max.x, objects->data[i].phys_comp.pos.x);
+        max.y = SDL_max(max.y, objects->data[i].phys_comp.pos.y);
+    }
+    double extent = SDL_max(SDL_max(max.x - min.x, max.y - min.y), 1.0);
+    double scale = ((1 << MORTON_AXIS_BITS) - 1) / extent;
+    for (int i = 0; i < n; i++)
+    {
+        Uint32 x = (Uint32)((objects->data[i].phys_comp.pos.x - min.x) * scale);
+        Uint32 y = (Uint32)((objects->data[i].phys_comp.pos.y - min.y) * scale);
+        keys[i] = Quadtree_MortonCode(x, y);
+        order[i] = i;
+    }
+
+    // least significant digit radix sort, which keeps equal codes in their current order
+    Uint32 *keys_in = keys, *keys_out = keys + n;
+    int *order_in = order, *order_out = order + n;
+    for (int shift = 0; shift < 2 * MORTON_AXIS_BITS; shift += RADIX_BITS)
+    {
+        int offsets[1 << RADIX_BITS] = {0};
+        for (int i = 0; i < n; i++)
+            offsets[keys_in[i] >> shift & ((1 << RADIX_BITS) - 1)]++;
+        for (int d = 0, sum = 0; d < 1 << RADIX_BITS; d++)
+        {
+            int count = offsets[d];
+            offsets[d] = sum;
+            sum += count;
+        }
+        for (int i = 0; i < n; i++)
+        {
+            int k = offsets[keys_in[i] >> shift & ((1 << RADIX_BITS) - 1)]++;
+            keys_out[k] = keys_in[i];
+            order_out[k] = order_in[i];
+        }
+        Uint32 *keys_temp = keys_in;
+        keys_in = keys_out;
+        keys_out = keys_temp;
+        int *order_temp = order_in;
+        order_in = order_out;
+        order_out = order_temp;
+    }
+
+    for (int i = 0; i < n; i++)
+        sorted[i] = objects->data[order_in[i]];
+    free(objects->data);
+    objects->data = sorted;
+    indexObjectIds(objects);
+    free(keys);
+    free(order);
+}
+
+void recordCircle(ENGINE_2D *engine, CIRCLE_OBJ *circle_obj)
+{
+    // hexadecimal floats round-trip exactly
+    fprintf(engine->record_file, "%d circle %d %d %d %d %a %a %a %a %a %a\n",
+            engine->frame, circle_obj->id, circle_obj->color.r, circle_obj->color.g, circle_obj->color.b,
+            (double)circle_obj->radius, (double)circle_obj->phys_comp.mass,
+            (double)circle_obj->phys_comp.pos.x, (double)circle_obj->phys_comp.pos.y,
+            (double)circle_obj->phys_comp.vel.x, (double)circle_obj->phys_comp.vel.y);
+}
+
+void stopRecording(ENGINE_2D *engine)
+{
+    if (engine->record_file == NULL)
+        return;
+    FILE *record_file = engine->record_file;
+    engine->record_file = NULL;
+    fprintf(record_file, "%d end %016llx\n", engine->frame, (unsigned long long)Engine2D_Checksum(engine));
+    fclose(record_file);
+}
+
+void readNextReplayRecord(ENGINE_2D *engine)
+{
+    unsigned long long checksum;
+    char kind[REPLAY_KIND_SIZE];
+    if (fgets(engine->replay_record, INPUT_BUFFER_SIZE, engine->replay_file) == NULL ||
+        sscanf(engine->replay_record, "%d %15s", &engine->replay_frame, kind) != 2)
+    {
+        engine->replay_frame = -1;
+        return;
+    }
+    if (strcmp(kind, "end") == 0 && sscanf(engine->replay_record, "%*d end %llx", &checksum) == 1)
+    {
+        engine->replay_at_end = SDL_TRUE;
+        engine->replay_checksum = checksum;
+    }
+}
+
+void applyReplayRecord(ENGINE_2D *engine)
+{
+    char kind[REPLAY_KIND_SIZE];
+    int offset = 0;
+    sscanf(engine->replay_record, "%*d %15s %n", kind, &offset);
+    char *args = engine->replay_record + offset;
+    if (strcmp(kind, "circle") == 0)
+    {
+        int id, r, g, b;
+        double radius, mass, pos_x, pos_y, vel_x, vel_y;
+        if (sscanf(args, "%d %d %d %d %lf %lf %lf %lf %lf %lf", &id, &r, &g, &b, &radius, &mass, &pos_x, &pos_y, &vel_x, &vel_y) != 10)
+        {
+            fprintf(stderr, "replay: malformed record '%s'\n", engine->replay_record);
+            return;
+        }
+        CIRCLE_OBJ circle_obj = {
+            .alive = SDL_TRUE,
+            .id = id,
+            .color = {r, g, b},
+            .radius = radius,
+            .phys_comp = {mass, {pos_x, pos_y}, {vel_x, vel_y}},
+        };
+        addCircleObject(engine, circle_obj);
+        if (engine->record_file != NULL)
+            recordCircle(engine, &circle_obj);
+        engine->next_id = id + 1;
+    }
+    else if (strcmp(kind, "next_id") == 0)
+    {
+        sscanf(args, "%d", &engine->next_id);
+        if (engine->record_file != NULL)
+            fprintf(engine->record_file, "%d next_id %d\n", engine->frame, engine->next_id);
+    }
+    else if (strcmp(kind, "dt") == 0)
+    {
+        double dt;
+        if (sscanf(args, "%lf", &dt) == 1)
+            Engine2D_SetTimeStep(engine, dt);
+    }
+    else if (strcmp(kind, "command") == 0)
+        executeCommand(engine, args);
+    else if (strcmp(kind, "end") != 0)
+        fprintf(stderr, "replay: unknown record '%s'\n", engine->replay_record);
+}
+
+// applies the replay records and console commands stamped with the current frame
+void applyFrameInputs(ENGINE_2D *engine)
+{
+    while (engine->replay_file != NULL && !engine->replay_at_end &&
+           engine->replay_frame >= 0 && engine->replay_frame <= engine->frame)
+    {
+        applyReplayRecord(engine);
+        readNextReplayRecord(engine);
+    }
+    for (int i = 0; i < engine->pending_commands.size; i++)
+        executeCommand(engine, engine->pending_commands.lines[i]);
+    engine->pending_commands.size = 0;
+}
+
+void Engine2D_RunSimulation(ENGINE_2D *engine)
+{
+    // a throttled capture holds back only this thread, not the console or others waiting on the engine's lock
+    SDL_LockMutex(engine->capture_mutex);
+    if (engine->capture != NULL)
+        FrameCapture_WaitForBuffer(engine->capture);
+    SDL_UnlockMutex(engine->capture_mutex);
+    SDL_LockMutex(engine->shared_state_mutex);
+    applyFrameInputs(engine);
+    if (engine->flags & PAUSED)
+    {
+        // a paused engine only advances by the frames asked for with 'step'
+        if (engine->pending_steps == 0)
+        {
+            renderObjects(engine);
+            exportState(engine);
+            SDL_UnlockMutex(engine->shared_state_mutex);
+            return;
+        }
+        engine->pending_steps--;
+    }
+
+    // branch on the mode flags once per frame instead of once per pair or circle
+    engine->step_kernel = selectStepKernel(engine->flags);
+    sanitiseObjectArray(engine->objects);
+    if (engine->flags & SPATIAL_SORT)
+        reorderObjectsIfScattered(engine);
+    if (engine->flags & DIAGNOSTICS)
+        beginDiagnostics(engine);
+    simulateForces(engine);
+    if (engine->flags & DIAGNOSTICS)
+        finishDiagnostics(engine);
+    if (engine->flags & ENABLE_SLEEPING)
+        wakeDisturbedCircles(engine);
+    resolveContacts(engine);
+    if (engine->flags & CONTINUOUS_COLLISION)
+        sweepAndResolveImpacts(engine);
+    else
+        engine->step_kernel->update_positions(engine, engine->dt);
+    if (engine->num_close_pairs > 0)
+        finishClosePairs(engine);
+    if (engine->flags & ENABLE_SLEEPING)
+        updateSleepStates(engine);
+    renderObjects(engine);
+    engine->frame++;
+    // stamped with the frame it takes effect on, as if it were typed in between the two frames
+    if (engine->halve_dt)
+    {
+        engine->halve_dt = SDL_FALSE;
+        printf("diagnostics: energy drifted by %.3g%%, dt halved to %g\n", 100 * engine->diagnostics.energy_drift, engine->dt / 2);
+        Engine2D_SetTimeStep(engine, engine->dt / 2);
+    }
+    captureHistory(engine);
+    exportState(engine);
+
+    SDL_UnlockMutex(engine->shared_state_mutex);
+}
+
+void renderObjects(ENGINE_2D *engine)
+{
+    // without a renderer the engine runs headless, with only the rasterizer's framebuffer to draw into
+    if (engine->renderer == NULL && !(engine->flags & SOFTWARE_RENDER))
+        return;
+    int width = engine->config.world_width, height = engine->config.world_height;
+    if (engine->renderer != NULL && SDL_GetRendererOutputSize(engine->renderer, &width, &height) != 0)
+        return;
+    engine->view_width = width;
+    engine->view_height = height;
+    int num_visible = collectVisibleCircles(engine);
+    if (engine->flags & SOFTWARE_RENDER)
+        rasterizeObjects(engine, num_visible);
+    else
+    {
+        for (int v = 0; v < num_visible; v++)
+            RenderFillCircle(engine, engine->objects->data + engine->visible[v]);
+        captureFrame(engine, NULL, 0);
+    }
+}
+
+// draws the circles in view on the CPU and uploads the frame once, instead of a draw call per pixel of every circle
+void rasterizeObjects(ENGINE_2D *engine, int num_visible)
+{
+    int width = engine->view_width, height = engine->view_height;
+    if (engine->rasterizer == NULL || !prepareFrameTarget(engine, width, height))
+        return;
+    VECTOR_2D origin = viewOrigin(engine);
+    double zoom = engine->camera_zoom;
+    Rasterizer_SetLevelOfDetail(engine->rasterizer, engine->lod, engine->lod_radius);
+    Rasterizer_Begin(engine->rasterizer);
+    for (int v = 0; v < num_visible; v++)
+    {
+        CIRCLE_OBJ *circle_obj = engine->objects->data + engine->visible[v];
+        VECTOR_2D pos = circle_obj->phys_comp.pos;
+        uint32_t argb = 0xFF000000u | circle_obj->color.r << 16 | circle_obj->color.g << 8 | circle_obj->color.b;
+        if (Rasterizer_AddCircle(engine->rasterizer, (pos.x - origin.x) * zoom, (pos.y - origin.y) * zoom, circle_obj->radius * zoom, argb) != 0)
+            break;
+    }
+
+    uint32_t background = 0xFF000000u | RGB_BLACK.r << 16 | RGB_BLACK.g << 8 | RGB_BLACK.b;
+    if (engine->frame_texture == NULL)
+    {
+        Rasterizer_Draw(engine->rasterizer, engine->thread_pool, engine->frame_pixels, width * sizeof(uint32_t), width, height, background);
+        captureFrame(engine, engine->frame_pixels, width * sizeof(uint32_t));
+        return;
+    }
+    void *pixels;
+    int pitch;
+    if (SDL_LockTexture(engine->frame_texture, NULL, &pixels, &pitch) != 0)
+    {
+        fprintf(stderr, "TEXTURE LOCK FAILED in %s: %s\n", __func__, SDL_GetError());
+        return;
+    }
+    Rasterizer_Draw(engine->rasterizer, engine->thread_pool, pixels, pitch, width, height, background);
+    // the locked pixels are the whole frame, which saves reading it back from the renderer
+    captureFrame(engine, pixels, pitch);
+    SDL_UnlockTexture(engine->frame_texture);
+    SDL_RenderCopy(engine->renderer, engine->frame_texture, NULL, NULL);
+}
+
+// gathers the slots of the live circles reaching into the view, in slot order so that they overlap as they always
+// have; also keeps the conversion to whole pixels in range. Returns how many there are.
+int collectVisibleCircles(ENGINE_2D *engine)
+{
+    OBJECT_ARRAY *objects = engine->objects;
+    int cap = SDL_max(objects->size, engine->view_tree != NULL ? engine->view_tree->num_points : 0);
+    if (cap > engine->visible_cap)
+    {
+        cap = SDL_max(cap, 2 * engine->visible_cap);
+        int **arrays[] = {&engine->visible, &engine->visible_scratch};
+        for (size_t a = 0; a < SDL_arraysize(arrays); a++)
+        {
+            int *temp = (int *)realloc(*arrays[a], cap * sizeof(int));
+            if (temp == NULL)
+            {
+                fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+                return 0;
+            }
+            *arrays[a] = temp;
+        }
+        engine->visible_cap = cap;
+    }
+    VECTOR_2D origin = viewOrigin(engine);
+    REAL min_x = origin.x, min_y = origin.y;
+    REAL max_x = origin.x + engine->view_width / engine->camera_zoom, max_y = origin.y + engine->view_height / engine->camera_zoom;
+    int num_visible = 0;
+    SDL_bool redrawn = engine->view_drawn_frame == engine->frame;
+    engine->view_drawn_frame = engine->frame;
+#ifndef ENGINE2D_NO_VIEW_TREE
+    // a step moves every circle, and checking each of them costs less than refitting the tree to them, so the tree
+    // only pays for itself over frames drawn again without a step, as while paused and looking around the world
+    if (redrawn && objects->size >= MIN_VIEW_TREE_OBJECTS && updateViewTree(engine))
+    {
+        QUADTREE *tree = engine->view_tree;
+        int num_found = Quadtree_Query(tree, min_x, min_y, max_x, max_y, engine->visible);
+        for (int f = 0; f < num_found; f++)
+        {
+            // circles cleared since the last step are still in the tree
+            int slot = engine->view_tiles.slot[tree->point_index[engine->visible[f]]];
+            if (slot >= 0 && objects->data[slot].alive)
+                engine->visible[num_visible++] = slot;
+        }
+        // the tree finds them in Morton order
+        sortSlots(engine->visible, engine->visible_scratch, num_visible, objects->size);
+        return num_visible;
+    }
+#else
+    (void)redrawn;
+#endif
+    for (int i = 0; i < objects->size; i++)
+    {
+        CIRCLE_OBJ *circle_obj = objects->data + i;
+        VECTOR_2D pos = circle_obj->phys_comp.pos;
+        if (circle_obj->alive && pos.x + circle_obj->radius >= min_x && pos.y + circle_obj->radius >= min_y &&
+            pos.x - circle_obj->radius < max_x && pos.y - circle_obj->radius < max_y)
+            engine->visible[num_visible++] = i;
+    }
+    return num_visible;
+}
+
+// refits the view's tree to where the circles are now if they have stepped since, building it again whenever
+// updateTree would
+SDL_bool updateViewTree(ENGINE_2D *engine)
+{
+    PAIR_TILES *tiles = &engine->view_tiles;
+    if (engine->view_tree == NULL)
+        return SDL_FALSE;
+    SDL_bool rebuild = engine->view_tree_next_id != engine->next_id || engine->frame < engine->view_tree_built_frame ||
+                       engine->frame - engine->view_tree_built_frame >= TREE_REBUILD_INTERVAL;
+    if (!rebuild && engine->view_tree_updated_frame == engine->frame)
+        return SDL_TRUE;
+    if (!rebuild)
+    {
+        int ghosts = refreshPairTiles(tiles, engine->objects);
+        rebuild = ghosts > MAX_TREE_GHOST_FRACTION * tiles->size ||
+                  Quadtree_Refit(engine->view_tree, engine->thread_pool, tiles->x, tiles->y, tiles->mass, tiles->radius) < 0;
+    }
+    if (rebuild)
+    {
+        if (!packPairTiles(tiles, engine->objects, 0, SDL_FALSE) ||
+            Quadtree_Build(engine->view_tree, engine->thread_pool, tiles->x, tiles->y, tiles->mass, tiles->radius, tiles->size) != 0)
+        {
+            engine->view_tree_next_id = 0;
+            return SDL_FALSE;
+        }
+        engine->view_tree_built_frame = engine->frame;
+        engine->view_tree_next_id = engine->next_id;
+    }
+    engine->view_tree_updated_frame = engine->frame;
+    return SDL_TRUE;
+}
+
+// world position of the top left corner of the view
+VECTOR_2D viewOrigin(ENGINE_2D *engine)
+{
+    return (VECTOR_2D){
+        engine->camera_centre.x - engine->view_width / 2.0 / engine->camera_zoom,
+        engine->camera_centre.y - engine->view_height / 2.0 / engine->camera_zoom,
+    };
+}
+
+// least significant digit radix sort of slots below limit, in as many passes as limit has digits
+void sortSlots(int *slots, int *scratch, int n, int limit)
+{
+    int *slots_in = slots, *slots_out = scratch;
+    for (int shift = 0; limit >> shift > 0; shift += RADIX_BITS)
+    {
+        int offsets[1 << RADIX_BITS] = {0};
+        for (int i = 0; i < n; i++)
+            offsets[slots_in[i] >> shift & ((1 << RADIX_BITS) - 1)]++;
+        for (int d = 0, sum = 0; d < 1 << RADIX_BITS; d++)
+        {
+            int count = offsets[d];
+            offsets[d] = sum;
+            sum += count;
+        }
+        for (int i = 0; i < n; i++)
+            slots_out[offsets[slots_in[i] >> shift & ((1 << RADIX_BITS) - 1)]++] = slots_in[i];
+        int *temp = slots_in;
+        slots_in = slots_out;
+        slots_out = temp;
+    }
+    if (slots_in != slots)
+        SDL_memcpy(slots, slots_in, n * sizeof(int));
+}
+
+// keeps a streaming texture the size of the output, or a framebuffer the size of the world when headless
+SDL_bool prepareFrameTarget(ENGINE_2D *engine, int width, int height)
+{
+    if (width == engine->frame_width && height == engine->frame_height &&
+        (engine->renderer != NULL ? engine->frame_texture != NULL : engine->frame_pixels != NULL))
+        return SDL_TRUE;
+    if (engine->frame_texture != NULL)
+        SDL_DestroyTexture(engine->frame_texture);
+    free(engine->frame_pixels);
+    engine->frame_texture = NULL;
+    engine->frame_pixels = NULL;
+    engine->frame_width = engine->frame_height = 0;
+    if (width <= 0 || height <= 0)
+        return SDL_FALSE;
+    if (engine->renderer != NULL)
+    {
+        engine->frame_texture = SDL_CreateTexture(engine->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+        if (engine->frame_texture == NULL)
+        {
+            fprintf(stderr, "TEXTURE CREATION FAILED in %s: %s\n", __func__, SDL_GetError());
+            return SDL_FALSE;
+        }
+    }
+    else
+    {
+        engine->frame_pixels = (uint32_t *)malloc((size_t)width * height * sizeof(uint32_t));
+        if (engine->frame_pixels == NULL)
+        {
+            fprintf(stderr, "ALLOCATION FAILED in %s\n", __func__);
+            return SDL_FALSE;
+        }
+    }
+    engine->frame_width = width;
+    engine->frame_height = height;
+    return SDL_TRUE;
+}
+
+// copies the live circles into the export's free buffer and makes it the latest, readers of the other one undisturbed
+void exportState(ENGINE_2D *engine)
+{
+    if (engine->state_export == NULL)
+        return;
+    STATE_EXPORT_BODY *bodies = StateExport_Begin(engine->state_export, engine->objects->size);
+    if (bodies == NULL)
+        return;
+    int count = 0;
+    for (int i = 0; i < engine->objects->size; i++)
+    {
+        CIRCLE_OBJ *circle_obj = engine->objects->data + i;
+        if (!circle_obj->alive)
+            continue;
+        PHYS_BODY *phys_comp = &circle_obj->phys_comp;
+        bodies[count++] = (STATE_EXPORT_BODY){
+            .id = circle_obj->id,
+            .r = circle_obj->color.r,
+            .g = circle_obj->color.g,
+            .b = circle_obj->color.b,
+            .radius = circle_obj->radius,
+            .x = phys_comp->pos.x,
+            .y = phys_comp->pos.y,
+            .vx = phys_comp->vel.x,
+            .vy = phys_comp->vel.y,
+        };
+    }
+    StateExport_Publish(engine->state_export, engine->frame, count);
+}
+
+// copies the frame just drawn into a buffer of the capture, from pixels or else read back from the renderer; the
+// copy is all drawing waits for, unless the writer has fallen so far behind that the capture throttles it
+void captureFrame(ENGINE_2D *engine, const uint32_t *pixels, int pitch)
+{
+    if (engine->capture == NULL || engine->capture_count++ % engine->capture_interval != 0)
+        return;
+    int width = engine->view_width, height = engine->view_height;
+    uint32_t *buffer = FrameCapture_Acquire(engine->capture, width, height);
+    if (buffer == NULL)
+        return;
+    if (pixels != NULL)
+    {
+        for (int y = 0; y < height; y++)
+            SDL_memcpy(buffer + (size_t)y * width, (const unsigned char *)pixels + (size_t)y * pitch, width * sizeof(uint32_t));
+    }
+    else if (SDL_RenderReadPixels(engine->renderer, NULL, SDL_PIXELFORMAT_ARGB8888, buffer, width * sizeof(uint32_t)) != 0)
+    {
+        fprintf(stderr, "capture: cannot read back the frame: %s\n", SDL_GetError());
+        return;
+    }
+    FrameCapture_Submit(engine->capture);
+}
+
+void captureHistory(ENGINE_2D *engine)
+{
+    History_Capture(engine->history, engine->frame, engine->next_id, engine->dt, engine->objects->data, engine->objects->size);
+}
+
+// everything but position, velocity and the sleep countdown, which deltas don't track
+SDL_bool isSameCircleApartFromMotion(const void *r1, const void *r2)
+{
+    const CIRCLE_OBJ *c1 = (const CIRCLE_OBJ *)r1, *c2 = (const CIRCLE_OBJ *)r2;
+    return c1->alive == c2->alive && c1->id == c2->id && c1->asleep == c2->asleep && c1->island == c2->island &&
+           c1->radius == c2->radius && c1->phys_comp.mass == c2->phys_comp.mass &&
+           c1->color.r == c2->color.r && c1->color.g == c2->color.g && c1->color.b == c2->color.b;
+}
+
+// restores the state from 'frames' frames ago and forgets everything after it
+SDL_bool rewindHistory(ENGINE_2D *engine, int frames)
+{
+    int size, next_id;
+    const CIRCLE_OBJ *circles = (const CIRCLE_OBJ *)History_Rewind(engine->history, engine->frame - frames, &size, &next_id);
+    if (circles == NULL)
+        return SDL_FALSE;
+    reserveObjects(engine->objects, size);
+    memcpy(engine->objects->data, circles, size * sizeof(CIRCLE_OBJ));
+    engine->objects->size = size;
+    indexObjectIds(engine->objects);
+    for (int i = 0; i < engine->objects->size; i++)
+        engine->objects->data[i].still_frames = 0;
+    engine->next_id = next_id;
+    engine->frame -= frames;
+    return SDL_TRUE;
+}
+
+void sanitiseObjectArray(OBJECT_ARRAY *objects)
+{
+    // compact in place keeping the survivors in order, so a spatially sorted array stays sorted
+    int size = 0;
+    for (int i = 0; i < objects->size; i++)
+    {
+        if (!objects->data[i].alive)
+            continue;
+        if (size != i)
+        {
+            objects->data[size] = objects->data[i];
+            indexObjectId(objects, size);
+        }
+        size++;
+    }
+    objects->size = size;
+
+    if (objects->size < objects->cap / 8)
+    {
+        CIRCLE_OBJ *temp = (CIRCLE_OBJ *)realloc(objects->data, objects->cap / 2 * sizeof(CIRCLE_OBJ));
+        if (temp)
+        {
+            objects->cap /= 2;
+            objects->data = temp;
+        }
+        else
+            fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+    }
+}
+
+void simulateForces(ENGINE_2D *engine)
+{
+    // a close pair drifts along the chord of its orbit, which sweeping for impacts would take for its path
+    SDL_bool close_pairs = (engine->flags & ENABLE_GRAVITY) && !(engine->flags & CONTINUOUS_COLLISION) && engine->dt > 0;
+    engine->step_close_gap = close_pairs ? engine->close_gap : 0;
+    engine->num_close_pairs = 0;
+    engine->step_kernel->simulate_gravitational_force(engine);
+    if (engine->step_close_gap > 0)
+        integrateClosePairs(engine);
+}
+
+// adds up everything but the potential energy, which the force pass adds up as it visits the pairs
+void beginDiagnostics(ENGINE_2D *engine)
+{
+    OBJECT_ARRAY *objects = engine->objects;
+    double mass = 0, kinetic = 0, momentum_x = 0, momentum_y = 0, moment_x = 0, moment_y = 0, angular = 0;
+    int bodies = 0, asleep = 0;
+    for (int i = 0; i < objects->size; i++)
+    {
+        if (!objects->data[i].alive)
+            continue;
+        PHYS_BODY *body = &objects->data[i].phys_comp;
+        bodies++;
+        asleep += objects->data[i].asleep;
+        mass += body->mass;
+        kinetic += 0.5 * body->mass * Vector2D_DotProduct(body->vel, body->vel);
+        momentum_x += body->mass * body->vel.x;
+        momentum_y += body->mass * body->vel.y;
+        moment_x += body->mass * body->pos.x;
+        moment_y += body->mass * body->pos.y;
+        angular += body->mass * (body->pos.x * body->vel.y - body->pos.y * body->vel.x);
+    }
+    ENGINE_2D_DIAGNOSTICS *diagnostics = &engine->diagnostics;
+    diagnostics->frame = engine->frame;
+    diagnostics->bodies = bodies;
+    diagnostics->mass = mass;
+    diagnostics->kinetic_energy = kinetic;
+    diagnostics->momentum = (VECTOR_2D){momentum_x, momentum_y};
+    diagnostics->centre_of_mass = mass > 0 ? (VECTOR_2D){moment_x / mass, moment_y / mass} : (VECTOR_2D){0, 0};
+    diagnostics->angular_momentum = angular;
+    engine->asleep_bodies = asleep;
+    engine->potential_sum = 0;
+    // without gravity the bodies don't interact at a distance, so there is no potential energy to count
+    engine->track_potential = (engine->flags & ENABLE_GRAVITY) != 0;
+}
+
+// measures the drift in energy since the reference frame, which starts over whenever bodies come or go, fall asleep
+// or wake, dt changes, the engine rewinds or inelastic contacts take energy away, and once the drift has gone past
+// the limit
+void finishDiagnostics(ENGINE_2D *engine)
+{
+    ENGINE_2D_DIAGNOSTICS *diagnostics = &engine->diagnostics;
+    engine->track_potential = SDL_FALSE;
+    diagnostics->potential_energy = -engine->gravitational_constant * engine->potential_sum;
+    double energy = diagnostics->kinetic_energy + diagnostics->potential_energy;
+    int merges = SDL_AtomicGet(&engine->merge_count);
+    SDL_bool dissipated = engine->dissipated;
+    // the contacts found in this pass are resolved before the next one
+    engine->dissipated = !(engine->flags & ELASTIC_COLLISION) && engine->contacts->size > 0;
+    if (diagnostics->reference_frame < 0 || diagnostics->frame < diagnostics->reference_frame || dissipated ||
+        diagnostics->bodies != engine->reference_bodies || merges != engine->reference_merges || engine->dt != engine->reference_dt ||
+        engine->asleep_bodies != engine->reference_asleep)
+    {
+        diagnostics->energy_drift = 0;
+        setDriftReference(engine, energy, merges);
+        return;
+    }
+    diagnostics->energy_drift = engine->reference_scale > 0 ? (energy - engine->reference_energy) / engine->reference_scale : 0;
+    if (engine->drift_limit <= 0 || fabs(diagnostics->energy_drift) <= engine->drift_limit)
+        return;
+    if (engine->drift_action == DRIFT_HALVE_DT)
+        engine->halve_dt = SDL_TRUE;
+    else
+        printf("diagnostics: energy drifted by %.3g%% between frames %d and %d\n", 100 * diagnostics->energy_drift,
+               diagnostics->reference_frame, diagnostics->frame);
+    setDriftReference(engine, energy, merges);
+}
+
+void setDriftReference(ENGINE_2D *engine, double energy, int merges)
+{
+    ENGINE_2D_DIAGNOSTICS *diagnostics = &engine->diagnostics;
+    diagnostics->reference_frame = diagnostics->frame;
+    engine->reference_energy = energy;
+    engine->reference_scale = diagnostics->kinetic_energy + fabs(diagnostics->potential_energy);
+    engine->reference_dt = engine->dt;
+    engine->reference_bodies = diagnostics->bodies;
+    engine->reference_merges = merges;
+    engine->reference_asleep = engine->asleep_bodies;
+}
+
+// share is the part of each pair's potential energy that each of the two circles was given
+void sumTilePotentials(ENGINE_2D *engine, double share)
+{
+    PAIR_TILES *tiles = &engine->pair_tiles;
+    double sum = 0;
+    for (int k = 0; k < tiles->size; k++)
+        sum += (double)tiles->mass[k] * tiles->potential[k];
+    engine->potential_sum += share * sum;
+}
+
+// what 1 / r^3 becomes under the softening kernel, the pull on a circle being its partner's mass times this times
+// the displacement to it
+REAL softenedInverseCube(const ENGINE_2D *engine, REAL dist_squared)
+{
+    REAL softened = dist_squared + (REAL)engine->softening_squared;
+    if (softened < (REAL)engine->spline_squared)
+        return splineInverseCube(engine->spline_length, dist_squared);
+    return 1 / (softened * REAL_SQRT(softened));
+}
+
+// what 1 / r becomes under the softening kernel, so the potential energy stays the one the pull comes from
+REAL softenedInverse(const ENGINE_2D *engine, REAL dist_squared)
+{
+    REAL softened = dist_squared + (REAL)engine->softening_squared;
+    if (softened < (REAL)engine->spline_squared)
+        return splineInverse(engine->spline_length, dist_squared);
+    return 1 / REAL_SQRT(softened);
+}
+
+// the cubic spline kernel within length of a circle's centre, as in GADGET-2 (Springel 2005), meeting 1 / r^3 at length
+REAL splineInverseCube(REAL length, REAL dist_squared)
+{
+    REAL u = REAL_SQRT(dist_squared) / length;
+    REAL inverse_cube = 1 / (length * length * length);
+    if (u < 0.5)
+        return inverse_cube * ((REAL)(32.0 / 3) + u * u * (32 * u - (REAL)38.4));
+    return inverse_cube * ((REAL)(64.0 / 3) - 48 * u + (REAL)38.4 * u * u - (REAL)(32.0 / 3) * u * u * u - (REAL)(1.0 / 15) / (u * u * u));
+}
+
+REAL splineInverse(REAL length, REAL dist_squared)
+{
+    REAL u = REAL_SQRT(dist_squared) / length;
+    if (u < 0.5)
+        return ((REAL)2.8 - u * u * ((REAL)(16.0 / 3) + u * u * ((REAL)6.4 * u - (REAL)9.6))) / length;
+    return ((REAL)3.2 - (REAL)(1.0 / 15) / u - u * u * ((REAL)(32.0 / 3) + u * (-16 + u * ((REAL)9.6 - (REAL)(32.0 / 15) * u)))) / length;
+}
+
+// takes the close pairs the force pass found through the step. A circle goes through the step with at most one
+// partner, the closest, and only if it isn't touching anything or asleep; the other pairs get the single kick any
+// other pair gets
+void integrateClosePairs(ENGINE_2D *engine)
+{
+    CONTACT_ARRAY *contacts = engine->contacts, *close_contacts = engine->close_contacts;
+    OBJECT_ARRAY *objects = engine->objects;
+    if (objects->size > engine->close_claimed_cap)
+    {
+        SDL_bool *temp = (SDL_bool *)realloc(engine->close_claimed, objects->size * sizeof(SDL_bool));
+        if (temp == NULL)
+        {
+            fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+            return;
+        }
+        engine->close_claimed = temp;
+        engine->close_claimed_cap = objects->size;
+    }
+    memset(engine->close_claimed, 0, objects->size * sizeof(SDL_bool));
+    for (int k = 0; k < contacts->size; k++)
+        engine->close_claimed[contacts->data[k].i] = engine->close_claimed[contacts->data[k].j] = SDL_TRUE;
+    int num_close = 0;
+    for (int k = 0; k < close_contacts->size; k++)
+    {
+        CONTACT contact = close_contacts->data[k];
+        if (num_close >= engine->close_pairs_cap)
+        {
+            int cap = SDL_max(DEFAULT_ARR_CAPACITY, engine->close_pairs_cap * 2);
+            CLOSE_PAIR *temp = (CLOSE_PAIR *)realloc(engine->close_pairs, cap * sizeof(CLOSE_PAIR));
+            if (temp == NULL)
+            {
+                fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+                kickClosePair(engine, contact.i, contact.j);
+                continue;
+            }
+            engine->close_pairs = temp;
+            engine->close_pairs_cap = cap;
+        }
+        VECTOR_2D displacement = Vector2D_Difference(objects->data[contact.i].phys_comp.pos, objects->data[contact.j].phys_comp.pos);
+        engine->close_pairs[num_close++] = (CLOSE_PAIR){contact.i, contact.j, Vector2D_DotProduct(displacement, displacement), {{0, 0}}, {{0, 0}}};
+    }
+    close_contacts->size = 0;
+    if (num_close > 1)
+        qsort(engine->close_pairs, num_close, sizeof(CLOSE_PAIR), compareClosePairs);
+
+    int num_integrated = 0;
+    for (int k = 0; k < num_close; k++)
+    {
+        CLOSE_PAIR pair = engine->close_pairs[k];
+        if (engine->close_claimed[pair.i] || engine->close_claimed[pair.j] || objects->data[pair.i].asleep || objects->data[pair.j].asleep)
+        {
+            kickClosePair(engine, pair.i, pair.j);
+            continue;
+        }
+        engine->close_claimed[pair.i] = engine->close_claimed[pair.j] = SDL_TRUE;
+        engine->close_pairs[num_integrated++] = pair;
+    }
+    // once every kick is in, so the velocities finishClosePairs goes by are changed by nothing but the walls
+    for (int k = 0; k < num_integrated; k++)
+        integrateClosePair(engine, engine->close_pairs + k);
+    engine->num_close_pairs = num_integrated;
+}
+
+// integrates the orbit of j about i through the step with kick-drift-kick substeps short next to the time scale of
+// the orbit where they are, stopping after the substep in which they touch, for the contact to be resolved on the
+// next frame. Their centre of mass carries on as it was, and they are left with the velocities that drift them to
+// where the orbit ends, along its chord
+void integrateClosePair(ENGINE_2D *engine, CLOSE_PAIR *pair)
+{
+    PHYS_BODY *body1 = &engine->objects->data[pair->i].phys_comp;
+    PHYS_BODY *body2 = &engine->objects->data[pair->j].phys_comp;
+    double total_mass = body1->mass + body2->mass;
+    double mu = engine->gravitational_constant * total_mass;
+    double radii = engine->objects->data[pair->i].radius + engine->objects->data[pair->j].radius;
+    double x0 = body2->pos.x - body1->pos.x, y0 = body2->pos.y - body1->pos.y;
+    double x = x0, y = y0, vx = body2->vel.x - body1->vel.x, vy = body2->vel.y - body1->vel.y;
+    double dist_squared = x * x + y * y;
+    double inverse_cube = softenedInverseCube(engine, dist_squared);
+    double time = 0;
+    for (int substep = 0; substep < MAX_CLOSE_SUBSTEPS && time < engine->dt; substep++)
+    {
+        double h = CLOSE_SUBSTEP_FRACTION * sqrt(dist_squared * sqrt(dist_squared) / mu);
+        if (h > engine->dt - time || substep == MAX_CLOSE_SUBSTEPS - 1)
+            h = engine->dt - time;
+        vx -= 0.5 * h * mu * inverse_cube * x;
+        vy -= 0.5 * h * mu * inverse_cube * y;
+        x += h * vx;
+        y += h * vy;
+        time += h;
+        dist_squared = x * x + y * y;
+        inverse_cube = dist_squared > 0 ? softenedInverseCube(engine, dist_squared) : 0;
+        vx -= 0.5 * h * mu * inverse_cube * x;
+        vy -= 0.5 * h * mu * inverse_cube * y;
+        // the substep's kick is finished first, so they touch moving as the orbit has them there
+        if (dist_squared < radii * radii)
+            break;
+    }
+    VECTOR_2D centre = {(body1->mass * body1->vel.x + body2->mass * body2->vel.x) / total_mass,
+                        (body1->mass * body1->vel.y + body2->mass * body2->vel.y) / total_mass};
+    double chord_x = (x - x0) / engine->dt, chord_y = (y - y0) / engine->dt;
+    double share1 = body2->mass / total_mass, share2 = body1->mass / total_mass;
+    pair->drift[0] = (VECTOR_2D){centre.x - share1 * chord_x, centre.y - share1 * chord_y};
+    pair->drift[1] = (VECTOR_2D){centre.x + share2 * chord_x, centre.y + share2 * chord_y};
+    pair->end[0] = (VECTOR_2D){centre.x - share1 * vx, centre.y - share1 * vy};
+    pair->end[1] = (VECTOR_2D){centre.x + share2 * vx, centre.y + share2 * vy};
+    body1->vel = pair->drift[0];
+    body2->vel = pair->drift[1];
+}
+
+void kickClosePair(ENGINE_2D *engine, int i, int j)
+{
+    PHYS_BODY *body1 = &engine->objects->data[i].phys_comp;
+    PHYS_BODY *body2 = &engine->objects->data[j].phys_comp;
+    VECTOR_2D displacement = Vector2D_Difference(body2->pos, body1->pos);
+    REAL scale = (REAL)(engine->gravitational_constant * engine->dt) * softenedInverseCube(engine, Vector2D_DotProduct(displacement, displacement));
+    body1->vel = Vector2D_Sum(body1->vel, Vector2D_ScalarProduct(displacement, scale * body2->mass));
+    body2->vel = Vector2D_Difference(body2->vel, Vector2D_ScalarProduct(displacement, scale * body1->mass));
+}
+
+// once the drift has taken each close pair along its chord, leaves it moving as it was at the end of its orbit,
+// turned around on each axis a wall turned its drift around on
+void finishClosePairs(ENGINE_2D *engine)
+{
+    for (int k = 0; k < engine->num_close_pairs; k++)
+    {
+        CLOSE_PAIR *pair = engine->close_pairs + k;
+        int slots[2] = {pair->i, pair->j};
+        for (int b = 0; b < 2; b++)
+        {
+            // nothing but a wall changes a drifting circle's velocity, and it only ever negates a component
+            VECTOR_2D *vel = &engine->objects->data[slots[b]].phys_comp.vel;
+            vel->x = vel->x == pair->drift[b].x ? pair->end[b].x : -pair->end[b].x;
+            vel->y = vel->y == pair->drift[b].y ? pair->end[b].y : -pair->end[b].y;
+        }
+    }
+    engine->num_close_pairs = 0;
+}
+
+static inline void interactPairKernel(ENGINE_2D *engine, int i, int j, const SDL_bool gravity, const SDL_bool sleeping);
+
+static inline void simulateGravitationalForceKernel(ENGINE_2D *engine, const SDL_bool gravity, const SDL_bool sleeping)
+{
+    OBJECT_ARRAY *objects = engine->objects;
+    engine->contacts->size = 0;
+    engine->close_contacts->size = 0;
+    engine->island_links->size = 0;
+
+    // each of these skips the pairs of two sleeping circles itself
+    if (!gravity && (engine->flags & NEIGHBOUR_LISTS))
+    {
+        simulateContactsWithNeighbourList(engine, sleeping);
+        return;
+    }
+#ifndef ENGINE2D_NO_SIZE_GRID
+    if (!gravity && objects->size >= MIN_GRID_OBJECTS)
+    {
+        simulateContactsWithGrid(engine, sleeping);
+        return;
+    }
+#endif
+    if (engine->flags & BARNES_HUT)
+    {
+        simulatePairsWithTree(engine, gravity, sleeping);
+        return;
+    }
+#ifndef ENGINE2D_UNTILED_PAIRS
+    if (objects->size >= MIN_TILED_OBJECTS)
+    {
+        simulatePairsTiled(engine, gravity, sleeping);
+        return;
+    }
+#endif
+
+    int *awake = NULL, num_awake = 0;
+    if (sleeping)
+    {
+        awake = (int *)malloc(objects->size * sizeof(int));
+        for (int i = 0; awake != NULL && i < objects->size; i++)
+        {
+            if (objects->data[i].alive && !objects->data[i].asleep)
+                awake[num_awake++] = i;
+        }
+    }
+    if (awake != NULL && num_awake < objects->size)
+    {
+        // pairs of sleeping circles are skipped, so the cost follows the number of awake circles
+        for (int a = 0; a < num_awake; a++)
+        {
+            int i = awake[a];
+            for (int j = 0; j < objects->size; j++)
+            {
+                if (j == i || !objects->data[j].alive)
+                    continue;
+                if (!objects->data[j].asleep && j < i)
+                    // already visited from the awake circle j
+                    continue;
+                interactPairKernel(engine, SDL_min(i, j), SDL_max(i, j), gravity, sleeping);
+            }
+        }
+        // the pairs of sleeping circles neither pull nor touch, but still count towards the potential energy
+        for (int i = 0; gravity && engine->track_potential && i < objects->size; i++)
+        {
+            if (!objects->data[i].alive || !objects->data[i].asleep)
+                continue;
+            for (int j = i + 1; j < objects->size; j++)
+            {
+                if (!objects->data[j].alive || !objects->data[j].asleep)
+                    continue;
+                VECTOR_2D displacement = Vector2D_Difference(objects->data[j].phys_comp.pos, objects->data[i].phys_comp.pos);
+                REAL dist_squared = Vector2D_DotProduct(displacement, displacement);
+                if (dist_squared > 0)
+                    engine->potential_sum += (double)objects->data[i].phys_comp.mass * objects->data[j].phys_comp.mass *
+                                             softenedInverse(engine, dist_squared);
+            }
+        }
+        free(awake);
+        return;
+    }
+    free(awake);
+    for (int i = 0; i < objects->size - 1; i++)
+    {
+        if (!objects->data[i].alive)
+            continue;
+        for (int j = i + 1; j < objects->size; j++)
+        {
+            if (!objects->data[j].alive)
+                continue;
+            interactPairKernel(engine, i, j, gravity, sleeping);
+        }
+    }
+}
+
+static inline void interactPairKernel(ENGINE_2D *engine, int i, int j, const SDL_bool gravity, const SDL_bool sleeping)
+{
+    REAL m1 = engine->objects->data[i].phys_comp.mass;
+    REAL m2 = engine->objects->data[j].phys_comp.mass;
+    VECTOR_2D pos1 = engine->objects->data[i].phys_comp.pos;
+    VECTOR_2D pos2 = engine->objects->data[j].phys_comp.pos;
+    VECTOR_2D displacement = Vector2D_Difference(pos2, pos1);
+    REAL dist = Vector2D_Magnitude(displacement);
+    REAL radii = engine->objects->data[i].radius + engine->objects->data[j].radius;
+    if (sleeping && dist < radii + SLEEP_CONTACT_MARGIN)
+        addContact(engine->island_links, i, j);
+    if (gravity && engine->track_potential && dist > 0)
+        engine->potential_sum += (double)m1 * m2 * softenedInverse(engine, dist * dist);
+    if (dist < radii)
+    {
+        // resolved in batches by resolveContacts once every pair has been visited
+        addContact(engine->contacts, i, j);
+        return;
+    }
+    if (gravity && dist < radii + (REAL)engine->step_close_gap)
+    {
+        // taken through the step by integrateClosePairs
+        addContact(engine->close_contacts, i, j);
+        return;
+    }
+    if (gravity)
+    {
+        // softened, the pull is the inverse cube times the distance rather than the inverse square
+        REAL force_magnitude = engine->softening_kernel == SOFTENING_NONE
+                                   ? (REAL)engine->gravitational_constant * m1 * m2 / (dist * dist)
+                                   : (REAL)engine->gravitational_constant * m1 * m2 * dist * softenedInverseCube(engine, dist * dist);
+        VECTOR_2D force = Vector2D_ScalarProduct(
+            Vector2D_Normalised(displacement),
+            force_magnitude);
+
+        engine->objects->data[i].phys_comp.vel = Vector2D_Sum(
+            engine->objects->data[i].phys_comp.vel,
+            Vector2D_ScalarProduct(force, engine->dt / m1));
+
+        engine->objects->data[j].phys_comp.vel = Vector2D_Difference(
+            engine->objects->data[j].phys_comp.vel,
+            Vector2D_ScalarProduct(force, engine->dt / m2));
+    }
+}
+
+// visits every pair tile by tile, applying each pair's force to both circles, and spreads the tile pairs over
+// the thread pool in rounds where no tile appears twice, so no two threads ever write the same accumulator
+void simulatePairsTiled(ENGINE_2D *engine, SDL_bool gravity, SDL_bool sleeping)
+{
+    PAIR_TILES *tiles = &engine->pair_tiles;
+    int num_tiles = (engine->objects->size + PAIR_TILE_SIZE - 1) / PAIR_TILE_SIZE;
+    // round robin pairing needs an even number of tiles, the extra one stands for a bye
+    int num_slots = num_tiles + (num_tiles & 1);
+    if (!packPairTiles(tiles, engine->objects, num_tiles, sleeping))
+        return;
+
+    // round 0 pairs each tile with itself, the rest pair every tile with every other tile once
+    TILE_ROUND round = {engine, 0, num_tiles, gravity, sleeping};
+    for (round.round = 0; round.round < num_slots; round.round++)
+    {
+        int num_tasks = round.round == 0 ? num_tiles : num_slots / 2;
+        ThreadPool_ParallelFor(engine->thread_pool, num_tasks, 1, interactTileRange, &round);
+        mergeRoundContacts(engine, num_tasks);
+    }
+    // every pair was visited once, from the circle in the lower tile
+    if (gravity && engine->track_potential)
+        sumTilePotentials(engine, 1);
+    applyPairTiles(engine);
+}
+
+// Barnes-Hut: each circle walks a quadtree of all the circles, taking the pull of a distant group from its
+// centre of mass and only visiting the circles of groups that are close or that it may touch. With sleeping, a
+// sleeping circle sits the step out like one that isn't due its pull, so it is only woken by a contact
+void simulatePairsWithTree(ENGINE_2D *engine, SDL_bool gravity, SDL_bool sleeping)
+{
+    PAIR_TILES *tiles = &engine->pair_tiles;
+    int num_chunks = (engine->objects->size + TREE_WALK_CHUNK - 1) / TREE_WALK_CHUNK;
+    if (!updateTree(engine, num_chunks))
+        return;
+    if (gravity && (engine->flags & MULTI_RATE))
+        assignKickFrames(engine);
+    // the walks go in Morton order, so neighbouring walks visit mostly the same nodes
+    num_chunks = (tiles->size + TREE_WALK_CHUNK - 1) / TREE_WALK_CHUNK;
+    TREE_WALK walk = {engine, gravity, sleeping};
+    ThreadPool_ParallelFor(engine->thread_pool, num_chunks, 1, walkTreeRange, &walk);
+    mergeRoundContacts(engine, num_chunks);
+    // every circle took the pull of all the others, so each pair was counted from both ends
+    if (gravity && engine->track_potential)
+        sumTilePotentials(engine, 0.5);
+    applyPairTiles(engine);
+}
+
+// circles in or heading into the region of interest take their pull every frame, and the rest every far_interval
+// frames, a share of them on each frame; either way a circle takes the pull of every frame since it last did
+void assignKickFrames(ENGINE_2D *engine)
+{
+    PAIR_TILES *tiles = &engine->pair_tiles;
+    VECTOR_2D min = engine->roi_min, max = engine->roi_max;
+    if (engine->flags & DETERMINISTIC)
+    {
+        // neither the view nor a region set through the API is recorded, so they mustn't change the outcome
+        min = (VECTOR_2D){0, 0};
+        max = (VECTOR_2D){engine->config.world_width, engine->config.world_height};
+    }
+    else if (min.x >= max.x || min.y >= max.y)
+    {
+        min = viewOrigin(engine);
+        max = (VECTOR_2D){min.x + engine->view_width / engine->camera_zoom, min.y + engine->view_height / engine->camera_zoom};
+    }
+    REAL margin = ROI_MARGIN * SDL_max(max.x - min.x, max.y - min.y);
+    min.x -= margin;
+    min.y -= margin;
+    max.x += margin;
+    max.y += margin;
+    int interval = SDL_max(engine->far_interval, 1);
+    REAL lookahead = interval * engine->dt;
+    for (int k = 0; k < tiles->size; k++)
+    {
+        tiles->kick_frames[k] = 0;
+        if (tiles->slot[k] < 0)
+            continue;
+        CIRCLE_OBJ *circle_obj = engine->objects->data + tiles->slot[k];
+        VECTOR_2D pos = circle_obj->phys_comp.pos;
+        VECTOR_2D ahead = Vector2D_Sum(pos, Vector2D_ScalarProduct(circle_obj->phys_comp.vel, lookahead));
+        SDL_bool is_near = (pos.x >= min.x && pos.x <= max.x && pos.y >= min.y && pos.y <= max.y) ||
+                           (ahead.x >= min.x && ahead.x <= max.x && ahead.y >= min.y && ahead.y <= max.y);
+        if (!is_near && (circle_obj->id + engine->frame) % interval != 0)
+            continue;
+        // a rewind can leave the last kick in the future
+        tiles->kick_frames[k] = SDL_clamp(engine->frame - circle_obj->kicked_frame, 1, interval);
+        circle_obj->kicked_frame = engine->frame;
+    }
+}
+
+// refits the tree when it was brought up to date on the frame before and holds every circle; builds it again
+// after new circles, many removals, or every TREE_REBUILD_INTERVAL frames, since a refit keeps the layout of its nodes
+SDL_bool updateTree(ENGINE_2D *engine, int num_chunks)
+{
+    PAIR_TILES *tiles = &engine->pair_tiles;
+    SDL_bool rebuild = engine->tree_updated_frame != engine->frame - 1 || engine->tree_next_id != engine->next_id ||
+                       engine->frame - engine->tree_built_frame >= TREE_REBUILD_INTERVAL;
+    if (!rebuild)
+    {
+        int ghosts = refreshPairTiles(tiles, engine->objects);
+        rebuild = ghosts > MAX_TREE_GHOST_FRACTION * tiles->size ||
+                  Quadtree_Refit(engine->tree, engine->thread_pool, tiles->x, tiles->y, tiles->mass, tiles->radius) < 0;
+    }
+    if (rebuild)
+    {
+        if (!packPairTiles(tiles, engine->objects, num_chunks, SDL_FALSE) ||
+            Quadtree_Build(engine->tree, engine->thread_pool, tiles->x, tiles->y, tiles->mass, tiles->radius, tiles->size) != 0)
+        {
+            engine->tree_updated_frame = -2;
+            return SDL_FALSE;
+        }
+        engine->tree_built_frame = engine->frame;
+        engine->tree_next_id = engine->next_id;
+    }
+    engine->tree_updated_frame = engine->frame;
+    return SDL_TRUE;
+}
+
+// reloads the circles packed for the last build in the same order, returning how many are gone
+int refreshPairTiles(PAIR_TILES *tiles, OBJECT_ARRAY *objects)
+{
+    int ghosts = 0;
+    for (int k = 0; k < tiles->size; k++)
+    {
+        CIRCLE_OBJ *circle_obj = findCircleById(objects, tiles->id[k]);
+        tiles->dvx[k] = tiles->dvy[k] = tiles->potential[k] = 0;
+        if (circle_obj == NULL || !circle_obj->alive)
+        {
+            tiles->slot[k] = -1;
+            tiles->mass[k] = tiles->radius[k] = 0;
+            ghosts++;
+            continue;
+        }
+        tiles->x[k] = circle_obj->phys_comp.pos.x;
+        tiles->y[k] = circle_obj->phys_comp.pos.y;
+        tiles->mass[k] = circle_obj->phys_comp.mass;
+        tiles->radius[k] = circle_obj->radius;
+        tiles->slot[k] = circle_obj - objects->data;
+        tiles->asleep[k] = circle_obj->asleep;
+    }
+    return ghosts;
+}
+
+void walkTreeRange(void *context, int begin, int end)
+{
+    TREE_WALK *walk = (TREE_WALK *)context;
+    int num_points = walk->engine->tree->num_points;
+    for (int chunk = begin; chunk < end; chunk++)
+    {
+        for (int point = chunk * TREE_WALK_CHUNK; point < SDL_min((chunk + 1) * TREE_WALK_CHUNK, num_points); point++)
+            walkTree(walk->engine, point, chunk, walk->gravity, walk->sleeping);
+    }
+}
+
+// adds what it finds to the arrays of its chunk
+void walkTree(ENGINE_2D *engine, int point, int chunk, SDL_bool gravity, SDL_bool sleeping)
+{
+    QUADTREE *tree = engine->tree;
+    PAIR_TILES *tiles = &engine->pair_tiles;
+    CONTACT_ARRAY *contacts = tiles->round_contacts[chunk], *close_contacts = tiles->round_close[chunk], *links = tiles->round_links[chunk];
+    REAL xi = tree->x[point], yi = tree->y[point], ri = tree->radius[point];
+    int slot_i = tiles->slot[tree->point_index[point]];
+    if (slot_i < 0)
+        return;
+    SDL_bool multi_rate = gravity && (engine->flags & MULTI_RATE);
+    SDL_bool track_potential = gravity && engine->track_potential;
+    SDL_bool asleep = sleeping && tiles->asleep[tree->point_index[point]];
+    int kick_frames = asleep ? 0 : multi_rate ? tiles->kick_frames[tree->point_index[point]] : 1;
+    // a circle sitting this step out still walks for its share of the potential energy, and for its island links
+    // while awake, leaving contacts to others
+    if (kick_frames == 0 && !track_potential && (asleep || !sleeping))
+        return;
+    REAL g_dt = engine->gravitational_constant * engine->dt * kick_frames;
+    REAL softening_squared = engine->softening_squared, spline_squared = engine->spline_squared;
+    REAL reach_i = ri + (gravity ? engine->step_close_gap : 0);
+    REAL link_i = ri + SLEEP_CONTACT_MARGIN;
+    REAL node_reach_i = sleeping && !asleep ? SDL_max(reach_i, link_i) : reach_i;
+    REAL dvx = 0, dvy = 0, potential = 0;
+    // a node pushes at most 4 children in place of itself on each level
+    int stack[3 * (QUADTREE_MAX_LEVELS + 1) + 1];
+    int depth = 0;
+    stack[depth++] = 0;
+    while (depth > 0)
+    {
+        int node = stack[--depth];
+        REAL gap_x = SDL_max(SDL_max(tree->min_x[node] - xi, xi - tree->max_x[node]), 0);
+        REAL gap_y = SDL_max(SDL_max(tree->min_y[node] - yi, yi - tree->max_y[node]), 0);
+        REAL reach = node_reach_i + tree->max_radius[node];
+        SDL_bool may_touch = gap_x * gap_x + gap_y * gap_y < reach * reach;
+        REAL dx = tree->com_x[node] - xi, dy = tree->com_y[node] - yi;
+        REAL dist_squared = dx * dx + dy * dy;
+        REAL size = SDL_max(tree->max_x[node] - tree->min_x[node], tree->max_y[node] - tree->min_y[node]);
+        if (!may_touch && (!gravity || size * size < BARNES_HUT_OPENING_ANGLE * BARNES_HUT_OPENING_ANGLE * dist_squared))
+        {
+            if (gravity)
+            {
+                REAL softened = dist_squared + softening_squared;
+                REAL scale = softened < spline_squared ? g_dt * tree->total_mass[node] * splineInverseCube(engine->spline_length, dist_squared)
+                                                       : g_dt * tree->total_mass[node] / (softened * REAL_SQRT(softened));
+                dvx += scale * dx;
+                dvy += scale * dy;
+            }
+            if (track_potential)
+                potential += tree->total_mass[node] * softenedInverse(engine, dist_squared);
+            continue;
+        }
+        if (tree->num_children[node] > 0)
+        {
+            for (int child = tree->first_child[node]; child < tree->first_child[node] + tree->num_children[node]; child++)
+                stack[depth++] = child;
+            continue;
+        }
+        for (int k = tree->first[node]; k < tree->first[node] + tree->count[node]; k++)
+        {
+            int slot_k = tiles->slot[tree->point_index[k]];
+            if (k == point || slot_k < 0)
+                continue;
+            dx = tree->x[k] - xi;
+            dy = tree->y[k] - yi;
+            dist_squared = dx * dx + dy * dy;
+            if (track_potential && dist_squared > 0)
+                potential += tree->mass[k] * softenedInverse(engine, dist_squared);
+            SDL_bool asleep_k = sleeping && tiles->asleep[tree->point_index[k]];
+            // the awake circle of a pair keeps its link, the one in the lower slot when both are
+            REAL link = link_i + tree->radius[k];
+            if (sleeping && !asleep && (asleep_k || slot_i < slot_k) && dist_squared < link * link)
+                addContact(links, slot_i, slot_k);
+            REAL reach = reach_i + tree->radius[k];
+            if (dist_squared < reach * reach)
+            {
+                REAL radii = ri + tree->radius[k];
+                int kick_frames_k = asleep_k ? 0 : multi_rate ? tiles->kick_frames[tree->point_index[k]] : 1;
+                SDL_bool close = dist_squared >= radii * radii;
+                // a close pair is only taken through the step together when both take their pull every frame, and
+                // otherwise pulls like any other pair
+                if (!close || (kick_frames == 1 && kick_frames_k == 1))
+                {
+                    // a sleeping circle is left to the awake one even when that sits this step out
+                    if (kick_frames == 0 && (asleep || !asleep_k))
+                        continue;
+                    // both circles find the pair, the one in the lower slot keeps it unless the other sits this step out
+                    if (slot_i < slot_k)
+                        addContact(close ? close_contacts : contacts, slot_i, slot_k);
+                    else if (kick_frames_k == 0)
+                        addContact(contacts, slot_k, slot_i);
+                    continue;
+                }
+            }
+            if (gravity)
+            {
+                REAL softened = dist_squared + softening_squared;
+                REAL scale = softened < spline_squared ? g_dt * tree->mass[k] * splineInverseCube(engine->spline_length, dist_squared)
+                                                       : g_dt * tree->mass[k] / (softened * REAL_SQRT(softened));
+                dvx += scale * dx;
+                dvy += scale * dy;
+            }
+        }
+    }
+    tiles->dvx[tree->point_index[point]] = dvx;
+    tiles->dvy[tree->point_index[point]] = dvy;
+    tiles->potential[tree->point_index[point]] = potential;
+}
+
+void mergeRoundContacts(ENGINE_2D *engine, int num_tasks)
+{
+    for (int t = 0; t < num_tasks; t++)
+    {
+        CONTACT_ARRAY *contacts = engine->pair_tiles.round_contacts[t];
+        for (int k = 0; k < contacts->size; k++)
+            addContact(engine->contacts, contacts->data[k].i, contacts->data[k].j);
+        contacts->size = 0;
+        CONTACT_ARRAY *close_contacts = engine->pair_tiles.round_close[t];
+        for (int k = 0; k < close_contacts->size; k++)
+            addContact(engine->close_contacts, close_contacts->data[k].i, close_contacts->data[k].j);
+        close_contacts->size = 0;
+        CONTACT_ARRAY *links = engine->pair_tiles.round_links[t];
+        for (int k = 0; k < links->size; k++)
+            addContact(engine->island_links, links->data[k].i, links->data[k].j);
+        links->size = 0;
+    }
+}
+
+void sortContacts(ENGINE_2D *engine)
+{
+    // same order as the plain pair loop, which the greedy colouring of contacts depends on
+    qsort(engine->contacts->data, engine->contacts->size, sizeof(CONTACT), compareContacts);
+}
+
+void applyPairTiles(ENGINE_2D *engine)
+{
+    PAIR_TILES *tiles = &engine->pair_tiles;
+    sortContacts(engine);
+    for (int i = 0; i < tiles->size; i++)
+    {
+        if (tiles->slot[i] < 0)
+            continue;
+        VECTOR_2D *vel = &engine->objects->data[tiles->slot[i]].phys_comp.vel;
+        vel->x += tiles->dvx[i];
+        vel->y += tiles->dvy[i];
+    }
+}
+
+// a single cell size suits no one once merged giants share the world with thousands of small circles, so each
+// circle only looks around its own cell on its own level and the levels of larger circles above it
+void simulateContactsWithGrid(ENGINE_2D *engine, SDL_bool sleeping)
+{
+    PAIR_TILES *tiles = &engine->pair_tiles;
+    int num_chunks = (engine->objects->size + GRID_QUERY_CHUNK - 1) / GRID_QUERY_CHUNK;
+    if (!packPairTiles(tiles, engine->objects, num_chunks, SDL_FALSE) ||
+        !buildSizeGrid(&engine->grid, tiles, sleeping ? SLEEP_CONTACT_MARGIN : 0))
+        return;
+    num_chunks = (tiles->size + GRID_QUERY_CHUNK - 1) / GRID_QUERY_CHUNK;
+    GRID_QUERY query = {engine, sleeping};
+    ThreadPool_ParallelFor(engine->thread_pool, num_chunks, 1, queryGridRange, &query);
+    mergeRoundContacts(engine, num_chunks);
+    sortContacts(engine);
+}
+
+SDL_bool buildSizeGrid(SIZE_GRID *grid, PAIR_TILES *tiles, REAL margin)
+{
+    int n = tiles->size;
+    if (n > grid->cap)
+    {
+        int cap = SDL_max(n, grid->cap * 2);
+        int **columns[] = {&grid->level, &grid->cell_x, &grid->cell_y, &grid->bucket, &grid->entries};
+        for (size_t c = 0; c < SDL_arraysize(columns); c++)
+        {
+            int *temp = (int *)realloc(*columns[c], cap * sizeof(int));
+            if (temp == NULL)
+            {
+                fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+                return SDL_FALSE;
+            }
+            *columns[c] = temp;
+        }
+        grid->cap = cap;
+    }
+    // twice as many buckets as circles keeps collisions between cells rare
+    int num_buckets = 1;
+    while (num_buckets < 2 * n)
+        num_buckets *= 2;
+    if (num_buckets + 1 > grid->buckets_cap)
+    {
+        int *temp = (int *)realloc(grid->bucket_start, (num_buckets + 1) * sizeof(int));
+        if (temp == NULL)
+        {
+            fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+            return SDL_FALSE;
+        }
+        grid->bucket_start = temp;
+        grid->buckets_cap = num_buckets + 1;
+    }
+    grid->num_buckets = num_buckets;
+    grid->margin = margin;
+
+    REAL smallest = n > 0 ? tiles->radius[0] : 0;
+    for (int k = 1; k < n; k++)
+        smallest = SDL_min(smallest, tiles->radius[k]);
+    grid->cell_size[0] = 2 * SDL_max(smallest + margin / 2, (REAL)0.5);
+    for (int l = 1; l < MAX_GRID_LEVELS; l++)
+        grid->cell_size[l] = 2 * grid->cell_size[l - 1];
+    SDL_memset(grid->level_count, 0, sizeof(grid->level_count));
+    SDL_memset(grid->bucket_start, 0, (num_buckets + 1) * sizeof(int));
+    for (int k = 0; k < n; k++)
+    {
+        // circles wider than the top level's cells would be missed, but that is 2^15 times the smallest one
+        int l = 0;
+        while (l < MAX_GRID_LEVELS - 1 && grid->cell_size[l] < 2 * tiles->radius[k] + margin)
+            l++;
+        grid->level[k] = l;
+        grid->cell_x[k] = (int)SDL_floor(tiles->x[k] / grid->cell_size[l]);
+        grid->cell_y[k] = (int)SDL_floor(tiles->y[k] / grid->cell_size[l]);
+        grid->bucket[k] = hashGridCell(l, grid->cell_x[k], grid->cell_y[k]) & (num_buckets - 1);
+        grid->level_count[l]++;
+        grid->bucket_start[grid->bucket[k] + 1]++;
+    }
+    for (int b = 0; b < num_buckets; b++)
+        grid->bucket_start[b + 1] += grid->bucket_start[b];
+    // filling a bucket moves its start to its end, which is where the next one starts
+    for (int k = 0; k < n; k++)
+        grid->entries[grid->bucket_start[grid->bucket[k]]++] = k;
+    for (int b = num_buckets; b > 0; b--)
+        grid->bucket_start[b] = grid->bucket_start[b - 1];
+    grid->bucket_start[0] = 0;
+    return SDL_TRUE;
+}
+
+void freeSizeGrid(SIZE_GRID *grid)
+{
+    free(grid->level);
+    free(grid->cell_x);
+    free(grid->cell_y);
+    free(grid->bucket);
+    free(grid->entries);
+    free(grid->bucket_start);
+    *grid = (SIZE_GRID){0};
+}
+
+Uint32 hashGridCell(int level, int cell_x, int cell_y)
+{
+    return (Uint32)cell_x * 73856093u ^ (Uint32)cell_y * 19349663u ^ (Uint32)level * 83492791u;
+}
+
+void queryGridRange(void *context, int begin, int end)
+{
+    GRID_QUERY *query = (GRID_QUERY *)context;
+    PAIR_TILES *tiles = &query->engine->pair_tiles;
+    for (int chunk = begin; chunk < end; chunk++)
+    {
+        for (int k = chunk * GRID_QUERY_CHUNK; k < SDL_min((chunk + 1) * GRID_QUERY_CHUNK, tiles->size); k++)
+            queryGrid(query->engine, k, tiles->round_contacts[chunk], tiles->round_links[chunk], query->sleeping);
+    }
+}
+
+// without sleeping every pair within reach is a contact, or a neighbour when the grid has the skin for its margin
+void queryGrid(ENGINE_2D *engine, int k, CONTACT_ARRAY *contacts, CONTACT_ARRAY *links, SDL_bool sleeping)
+{
+    SIZE_GRID *grid = &engine->grid;
+    PAIR_TILES *tiles = &engine->pair_tiles;
+    REAL xk = tiles->x[k], yk = tiles->y[k], rk = tiles->radius[k];
+    for (int l = grid->level[k]; l < MAX_GRID_LEVELS; l++)
+    {
+        if (grid->level_count[l] == 0)
+            continue;
+        // every circle on a level is at most one cell wide, so any it reaches has its centre in a neighbouring cell
+        int cell_x = (int)SDL_floor(xk / grid->cell_size[l]), cell_y = (int)SDL_floor(yk / grid->cell_size[l]);
+        for (int dy = -1; dy <= 1; dy++)
+        {
+            for (int dx = -1; dx <= 1; dx++)
+            {
+                int b = hashGridCell(l, cell_x + dx, cell_y + dy) & (grid->num_buckets - 1);
+                for (int e = grid->bucket_start[b]; e < grid->bucket_start[b + 1]; e++)
+                {
+                    int j = grid->entries[e];
+                    if (grid->level[j] != l || grid->cell_x[j] != cell_x + dx || grid->cell_y[j] != cell_y + dy)
+                        continue;
+                    // circles on the same level find each other, the one in the lower slot keeps the pair
+                    if (j == k || (l == grid->level[k] && tiles->slot[j] < tiles->slot[k]))
+                        continue;
+                    REAL dist_x = tiles->x[j] - xk, dist_y = tiles->y[j] - yk;
+                    REAL dist_squared = dist_x * dist_x + dist_y * dist_y;
+                    REAL reach = rk + tiles->radius[j] + grid->margin;
+                    if (dist_squared >= reach * reach || (sleeping && tiles->asleep[j] && tiles->asleep[k]))
+                        continue;
+                    int slot_min = SDL_min(tiles->slot[k], tiles->slot[j]), slot_max = SDL_max(tiles->slot[k], tiles->slot[j]);
+                    if (!sleeping)
+                    {
+                        addContact(contacts, slot_min, slot_max);
+                        continue;
+                    }
+                    addContact(links, slot_min, slot_max);
+                    REAL radii = rk + tiles->radius[j];
+                    if (dist_squared < radii * radii)
+                        addContact(contacts, slot_min, slot_max);
+                }
+            }
+        }
+    }
+}
+
+// circles that move a few pixels per frame keep the same neighbours for many frames, so the pairs found with a
+// skin around every circle are reused, leaving a frame with only their distances to check until the list goes stale
+void simulateContactsWithNeighbourList(ENGINE_2D *engine, SDL_bool sleeping)
+{
+    NEIGHBOUR_LIST *list = &engine->neighbours;
+    // new circles, merges that grew a radius, rewinds, frames spent on other passes and turning sleeping on or off
+    // all void the list
+    SDL_bool stale = !list->valid || list->updated_frame != engine->frame - 1 || list->built_next_id != engine->next_id ||
+                     list->built_merges != SDL_AtomicGet(&engine->merge_count) || list->built_sleeping != sleeping;
+    if (stale && !buildNeighbourList(engine, sleeping))
+    {
+        list->valid = SDL_FALSE;
+        return;
+    }
+    list->updated_frame = engine->frame;
+    int num_chunks = (list->pairs->size + NEIGHBOUR_CHECK_CHUNK - 1) / NEIGHBOUR_CHECK_CHUNK;
+    if (!reserveRoundContacts(&engine->pair_tiles, num_chunks))
+        return;
+    ThreadPool_ParallelFor(engine->thread_pool, num_chunks, 1, checkNeighbourRange, engine);
+    mergeRoundContacts(engine, num_chunks);
+    sortContacts(engine);
+}
+
+// finds the pairs with the size grid, keeping them by id since slots change whenever the objects are compacted or
+// sorted; with sleeping the skin goes around the link margin, and the pairs of sleeping circles are kept for when
+// they wake
+SDL_bool buildNeighbourList(ENGINE_2D *engine, SDL_bool sleeping)
+{
+    NEIGHBOUR_LIST *list = &engine->neighbours;
+    PAIR_TILES *tiles = &engine->pair_tiles;
+    OBJECT_ARRAY *objects = engine->objects;
+    int num_chunks = (objects->size + GRID_QUERY_CHUNK - 1) / GRID_QUERY_CHUNK;
+    if (!packPairTiles(tiles, objects, num_chunks, SDL_FALSE) ||
+        !buildSizeGrid(&engine->grid, tiles, NEIGHBOUR_SKIN + (sleeping ? SLEEP_CONTACT_MARGIN : 0)))
+        return SDL_FALSE;
+    if (engine->next_id > list->built_cap)
+    {
+        int cap = SDL_max(engine->next_id, list->built_cap * 2);
+        REAL **columns[] = {&list->built_x, &list->built_y};
+        for (size_t c = 0; c < SDL_arraysize(columns); c++)
+        {
+            REAL *temp = (REAL *)realloc(*columns[c], cap * sizeof(REAL));
+            if (temp == NULL)
+            {
+                fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+                return SDL_FALSE;
+            }
+            *columns[c] = temp;
+        }
+        list->built_cap = cap;
+    }
+
+    num_chunks = (tiles->size + GRID_QUERY_CHUNK - 1) / GRID_QUERY_CHUNK;
+    GRID_QUERY query = {engine, SDL_FALSE};
+    ThreadPool_ParallelFor(engine->thread_pool, num_chunks, 1, queryGridRange, &query);
+    list->pairs->size = 0;
+    for (int t = 0; t < num_chunks; t++)
+    {
+        CONTACT_ARRAY *found = tiles->round_contacts[t];
+        for (int k = 0; k < found->size; k++)
+            addContact(list->pairs, objects->data[found->data[k].i].id, objects->data[found->data[k].j].id);
+        found->size = 0;
+    }
+    for (int k = 0; k < tiles->size; k++)
+    {
+        list->built_x[tiles->id[k]] = tiles->x[k];
+        list->built_y[tiles->id[k]] = tiles->y[k];
+    }
+    list->valid = SDL_TRUE;
+    list->built_sleeping = sleeping;
+    list->built_next_id = engine->next_id;
+    list->built_merges = SDL_AtomicGet(&engine->merge_count);
+    return SDL_TRUE;
+}
+
+void checkNeighbourRange(void *context, int begin, int end)
+{
+    ENGINE_2D *engine = (ENGINE_2D *)context;
+    CONTACT_ARRAY *pairs = engine->neighbours.pairs;
+    SDL_bool sleeping = engine->neighbours.built_sleeping;
+    for (int chunk = begin; chunk < end; chunk++)
+    {
+        CONTACT_ARRAY *contacts = engine->pair_tiles.round_contacts[chunk];
+        CONTACT_ARRAY *links = engine->pair_tiles.round_links[chunk];
+        for (int p = chunk * NEIGHBOUR_CHECK_CHUNK; p < SDL_min((chunk + 1) * NEIGHBOUR_CHECK_CHUNK, pairs->size); p++)
+        {
+            CIRCLE_OBJ *c1 = findCircleById(engine->objects, pairs->data[p].i);
+            CIRCLE_OBJ *c2 = findCircleById(engine->objects, pairs->data[p].j);
+            if (c1 == NULL || c2 == NULL || !c1->alive || !c2->alive || (sleeping && c1->asleep && c2->asleep))
+                continue;
+            REAL dist = Vector2D_Magnitude(Vector2D_Difference(c2->phys_comp.pos, c1->phys_comp.pos));
+            int i = c1 - engine->objects->data, j = c2 - engine->objects->data;
+            if (sleeping && dist < c1->radius + c2->radius + SLEEP_CONTACT_MARGIN)
+                addContact(links, SDL_min(i, j), SDL_max(i, j));
+            if (dist < c1->radius + c2->radius)
+                addContact(contacts, SDL_min(i, j), SDL_max(i, j));
+        }
+    }
+}
+
+void freeNeighbourList(NEIGHBOUR_LIST *list)
+{
+    Contacts_Free(list->pairs);
+    free(list->built_x);
+    free(list->built_y);
+    *list = (NEIGHBOUR_LIST){0};
+}
+
+SDL_bool packPairTiles(PAIR_TILES *tiles, OBJECT_ARRAY *objects, int num_round_tasks, SDL_bool awake_first)
+{
+    if (objects->size > tiles->cap)
+    {
+        int cap = SDL_max(objects->size, tiles->cap * 2);
+        REAL **columns[] = {&tiles->x, &tiles->y, &tiles->mass, &tiles->radius, &tiles->dvx, &tiles->dvy, &tiles->potential};
+        for (size_t c = 0; c < SDL_arraysize(columns); c++)
+        {
+            REAL *temp = (REAL *)realloc(*columns[c], cap * sizeof(REAL));
+            if (temp == NULL)
+            {
+                fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+                return SDL_FALSE;
+            }
+            *columns[c] = temp;
+        }
+        int **int_columns[] = {&tiles->slot, &tiles->id, &tiles->kick_frames, &tiles->asleep};
+        for (size_t c = 0; c < SDL_arraysize(int_columns); c++)
+        {
+            int *temp = (int *)realloc(*int_columns[c], cap * sizeof(int));
+            if (temp == NULL)
+            {
+                fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+                return SDL_FALSE;
+            }
+            *int_columns[c] = temp;
+        }
+        tiles->cap = cap;
+    }
+    if (!reserveRoundContacts(tiles, num_round_tasks))
+        return SDL_FALSE;
+
+    tiles->size = 0;
+    // the awake circles in the first pass and the sleeping ones in the second, or every circle in the first
+    for (int pass = 0; pass < (awake_first ? 2 : 1); pass++)
+    {
+        for (int i = 0; i < objects->size; i++)
+        {
+            if (!objects->data[i].alive || (awake_first && objects->data[i].asleep != (pass == 1)))
+                continue;
+            int k = tiles->size++;
+            tiles->x[k] = objects->data[i].phys_comp.pos.x;
+            tiles->y[k] = objects->data[i].phys_comp.pos.y;
+            tiles->mass[k] = objects->data[i].phys_comp.mass;
+            tiles->radius[k] = objects->data[i].radius;
+            tiles->dvx[k] = tiles->dvy[k] = tiles->potential[k] = 0;
+            tiles->slot[k] = i;
+            tiles->id[k] = objects->data[i].id;
+            tiles->asleep[k] = objects->data[i].asleep;
+        }
+        if (pass == 0)
+            tiles->num_awake = tiles->size;
+    }
+    return SDL_TRUE;
+}
+
+SDL_bool reserveRoundContacts(PAIR_TILES *tiles, int num_round_tasks)
+{
+    if (num_round_tasks > tiles->num_round_contacts)
+    {
+        CONTACT_ARRAY ***arrays[] = {&tiles->round_contacts, &tiles->round_close, &tiles->round_links};
+        for (size_t a = 0; a < SDL_arraysize(arrays); a++)
+        {
+            CONTACT_ARRAY **temp = (CONTACT_ARRAY **)realloc(*arrays[a], num_round_tasks * sizeof(CONTACT_ARRAY *));
+            if (temp == NULL)
+            {
+                fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+                return SDL_FALSE;
+            }
+            *arrays[a] = temp;
+        }
+        for (; tiles->num_round_contacts < num_round_tasks; tiles->num_round_contacts++)
+        {
+            for (size_t a = 0; a < SDL_arraysize(arrays); a++)
+                (*arrays[a])[tiles->num_round_contacts] = Contacts_Init();
+        }
+    }
+    return SDL_TRUE;
+}
+
+void freePairTiles(PAIR_TILES *tiles)
+{
+    free(tiles->x);
+    free(tiles->y);
+    free(tiles->mass);
+    free(tiles->radius);
+    free(tiles->dvx);
+    free(tiles->dvy);
+    free(tiles->potential);
+    free(tiles->slot);
+    free(tiles->id);
+    free(tiles->kick_frames);
+    free(tiles->asleep);
+    for (int t = 0; t < tiles->num_round_contacts; t++)
+    {
+        Contacts_Free(tiles->round_contacts[t]);
+        Contacts_Free(tiles->round_close[t]);
+        Contacts_Free(tiles->round_links[t]);
+    }
+    free(tiles->round_contacts);
+    free(tiles->round_close);
+    free(tiles->round_links);
+    *tiles = (PAIR_TILES){0};
+}
+
+void interactTileRange(void *context, int begin, int end)
+{
+    TILE_ROUND *round = (TILE_ROUND *)context;
+    PAIR_TILES *tiles = &round->engine->pair_tiles;
+    int num_slots = round->num_tiles + (round->num_tiles & 1);
+    for (int task = begin; task < end; task++)
+    {
+        // circle method: the last slot stays put while the others rotate one place per round
+        int last = num_slots - 1, r = round->round - 1;
+        int a = round->round == 0 ? task : task == 0 ? last : (r + task) % last;
+        int b = round->round == 0 ? task : task == 0 ? r : (r - task + last) % last;
+        if (a >= round->num_tiles || b >= round->num_tiles)
+            continue;
+        // with sleeping the awake circles are packed first, and two tiles past them hold no pair to visit but for the
+        // potential energy
+        if (round->sleeping && SDL_min(a, b) * PAIR_TILE_SIZE >= tiles->num_awake && !(round->gravity && round->engine->track_potential))
+            continue;
+        interactTiles(round->engine, SDL_min(a, b), SDL_max(a, b), task, round->gravity, round->sleeping);
+    }
+}
+
+static inline void interactTilesKernel(ENGINE_2D *engine, int tile_a, int tile_b, int task, const SDL_bool gravity,
+                                       const SDL_bool track_potential, const SDL_bool spline, const SDL_bool sleeping)
+{
+    PAIR_TILES *tiles = &engine->pair_tiles;
+    CONTACT_ARRAY *contacts = tiles->round_contacts[task], *close_contacts = tiles->round_close[task], *links = tiles->round_links[task];
+    int a_begin = tile_a * PAIR_TILE_SIZE, a_end = SDL_min(a_begin + PAIR_TILE_SIZE, tiles->size);
+    int b_begin = tile_b * PAIR_TILE_SIZE, b_end = SDL_min(b_begin + PAIR_TILE_SIZE, tiles->size);
+    REAL g_dt = engine->gravitational_constant * engine->dt;
+    // both 0 without softening, and adding 0 leaves the squared distance as it was
+    REAL softening_squared = engine->softening_squared, spline_squared = engine->spline_squared;
+    REAL gap = gravity ? engine->step_close_gap : 0;
+    REAL b_dvx[PAIR_TILE_SIZE] = {0}, b_dvy[PAIR_TILE_SIZE] = {0};
+    for (int i = a_begin; i < a_end; i++)
+    {
+        REAL xi = tiles->x[i], yi = tiles->y[i], mi = tiles->mass[i], ri = tiles->radius[i], reach_i = ri + gap;
+        REAL dvx = 0, dvy = 0;
+        // mass over distance, times g_dt for the pairs that pull on each other so it comes out of the pull's scale
+        REAL potential = 0, scaled_potential = 0;
+        for (int j = tile_a == tile_b ? i + 1 : b_begin; j < b_end; j++)
+        {
+            REAL dx = tiles->x[j] - xi, dy = tiles->y[j] - yi;
+            REAL dist_squared = dx * dx + dy * dy;
+            if (sleeping)
+            {
+                if (tiles->asleep[i] && tiles->asleep[j])
+                {
+                    // neither pulling nor touching, but still counting towards the potential energy
+                    REAL softened = dist_squared + softening_squared;
+                    if (track_potential && spline && softened < spline_squared)
+                        potential += tiles->mass[j] * splineInverse(engine->spline_length, dist_squared);
+                    else if (track_potential && softened > 0)
+                        potential += tiles->mass[j] / REAL_SQRT(softened);
+                    continue;
+                }
+                REAL link = ri + tiles->radius[j] + (REAL)SLEEP_CONTACT_MARGIN;
+                if (dist_squared < link * link)
+                    addContact(links, tiles->slot[i], tiles->slot[j]);
+            }
+            REAL reach = reach_i + tiles->radius[j];
+            if (dist_squared < reach * reach)
+            {
+                REAL softened = dist_squared + softening_squared;
+                if (track_potential && spline && softened < spline_squared)
+                    potential += tiles->mass[j] * splineInverse(engine->spline_length, dist_squared);
+                else if (track_potential && softened > 0)
+                    potential += tiles->mass[j] / REAL_SQRT(softened);
+                // resolved in batches by resolveContacts once every pair has been visited, or only close and taken
+                // through the step by integrateClosePairs
+                REAL radii = ri + tiles->radius[j];
+                addContact(dist_squared < radii * radii ? contacts : close_contacts, tiles->slot[i], tiles->slot[j]);
+                continue;
+            }
+            if (gravity)
+            {
+                REAL softened = dist_squared + softening_squared;
+                REAL scale;
+                if (spline && softened < spline_squared)
+                {
+                    scale = g_dt * splineInverseCube(engine->spline_length, dist_squared);
+                    if (track_potential)
+                        potential += tiles->mass[j] * splineInverse(engine->spline_length, dist_squared);
+                }
+                else
+                {
+                    scale = g_dt / (softened * REAL_SQRT(softened));
+                    if (track_potential)
+                        scaled_potential += scale * softened * tiles->mass[j];
+                }
+                dvx += scale * tiles->mass[j] * dx;
+                dvy += scale * tiles->mass[j] * dy;
+                b_dvx[j - b_begin] -= scale * mi * dx;
+                b_dvy[j - b_begin] -= scale * mi * dy;
+            }
+        }
+        tiles->dvx[i] += dvx;
+        tiles->dvy[i] += dvy;
+        if (track_potential)
+            tiles->potential[i] += potential + (g_dt != 0 ? scaled_potential / g_dt : 0);
+    }
+    for (int j = b_begin; j < b_end; j++)
+    {
+        tiles->dvx[j] += b_dvx[j - b_begin];
+        tiles->dvy[j] += b_dvy[j - b_begin];
+    }
+}
+
+// the potential energy and the spline kernel are each handled in a loop of their own, so the loops without them
+// don't pay for them; sleeping shares one loop taking every flag as it comes
+void interactTiles(ENGINE_2D *engine, int tile_a, int tile_b, int task, SDL_bool gravity, SDL_bool sleeping)
+{
+    SDL_bool spline = engine->spline_squared > 0;
+    if (sleeping)
+        interactTilesKernel(engine, tile_a, tile_b, task, gravity, gravity && engine->track_potential, spline, SDL_TRUE);
+    else if (gravity && engine->track_potential && spline)
+        interactTilesKernel(engine, tile_a, tile_b, task, SDL_TRUE, SDL_TRUE, SDL_TRUE, SDL_FALSE);
+    else if (gravity && engine->track_potential)
+        interactTilesKernel(engine, tile_a, tile_b, task, SDL_TRUE, SDL_TRUE, SDL_FALSE, SDL_FALSE);
+    else if (gravity && spline)
+        interactTilesKernel(engine, tile_a, tile_b, task, SDL_TRUE, SDL_FALSE, SDL_TRUE, SDL_FALSE);
+    else if (gravity)
+        interactTilesKernel(engine, tile_a, tile_b, task, SDL_TRUE, SDL_FALSE, SDL_FALSE, SDL_FALSE);
+    else
+        interactTilesKernel(engine, tile_a, tile_b, task, SDL_FALSE, SDL_FALSE, SDL_FALSE, SDL_FALSE);
+}
+
+int compareContacts(const void *a, const void *b)
+{
+    const CONTACT *c1 = (const CONTACT *)a, *c2 = (const CONTACT *)b;
+    if (c1->i != c2->i)
+        return c1->i < c2->i ? -1 : 1;
+    return (c1->j > c2->j) - (c1->j < c2->j);
+}
+
+// closest first, the pairs being told apart by their slots when they are as close as each other
+int compareClosePairs(const void *a, const void *b)
+{
+    const CLOSE_PAIR *p1 = (const CLOSE_PAIR *)a, *p2 = (const CLOSE_PAIR *)b;
+    if (p1->dist_squared != p2->dist_squared)
+        return p1->dist_squared < p2->dist_squared ? -1 : 1;
+    if (p1->i != p2->i)
+        return p1->i < p2->i ? -1 : 1;
+    return (p1->j > p2->j) - (p1->j < p2->j);
+}
+
+void wakeDisturbedCircles(ENGINE_2D *engine)
+{
+    OBJECT_ARRAY *objects = engine->objects;
+    // touched by an awake circle
+    for (int k = 0; k < engine->contacts->size; k++)
+    {
+        CIRCLE_OBJ *c1 = objects->data + engine->contacts->data[k].i;
+        CIRCLE_OBJ *c2 = objects->data + engine->contacts->data[k].j;
+        if (c1->asleep != c2->asleep)
+            wakeIsland(objects, c1->asleep ? c1 : c2);
+    }
+    // pulled hard enough by the awake circles
+    for (int i = 0; i < objects->size; i++)
+    {
+        CIRCLE_OBJ *circle_obj = objects->data + i;
+        if (!circle_obj->asleep)
+            continue;
+        if (Vector2D_Magnitude(circle_obj->phys_comp.vel) > WAKE_SPEED)
+            wakeIsland(objects, circle_obj);
+        else
+            circle_obj->phys_comp.vel = (VECTOR_2D){0, 0};
+    }
+}
+
+void wakeIsland(OBJECT_ARRAY *objects, CIRCLE_OBJ *circle_obj)
+{
+    if (!circle_obj->asleep)
+        return;
+    int island = circle_obj->island;
+    for (int i = 0; i < objects->size; i++)
+    {
+        if (objects->data[i].asleep && objects->data[i].island == island)
+        {
+            objects->data[i].asleep = SDL_FALSE;
+            objects->data[i].still_frames = 0;
+        }
+    }
+}
+
+void updateSleepStates(ENGINE_2D *engine)
+{
+    OBJECT_ARRAY *objects = engine->objects;
+    int *parent = (int *)malloc(objects->size * sizeof(int));
+    int *label = (int *)malloc(objects->size * sizeof(int));
+    SDL_bool *restless = (SDL_bool *)calloc(objects->size, sizeof(SDL_bool));
+    if (parent == NULL || label == NULL || restless == NULL)
+    {
+        fprintf(stderr, "ALLOCATION FAILED in %s\n", __func__);
+        free(parent);
+        free(label);
+        free(restless);
+        return;
+    }
+
+    for (int i = 0; i < objects->size; i++)
+    {
+        parent[i] = i;
+        CIRCLE_OBJ *circle_obj = objects->data + i;
+        if (!circle_obj->alive || circle_obj->asleep)
+            continue;
+        if (Vector2D_Magnitude(circle_obj->phys_comp.vel) < SLEEP_SPEED)
+            circle_obj->still_frames++;
+        else
+            circle_obj->still_frames = 0;
+    }
+
+    // islands are the connected groups of circles touching this frame
+    for (int k = 0; k < engine->island_links->size; k++)
+    {
+        int root_i = findIslandRoot(parent, engine->island_links->data[k].i);
+        int root_j = findIslandRoot(parent, engine->island_links->data[k].j);
+        if (root_i != root_j)
+            parent[SDL_max(root_i, root_j)] = SDL_min(root_i, root_j);
+    }
+
+    // an island only sleeps once every member has been still for long enough
+    for (int i = 0; i < objects->size; i++)
+        label[i] = INT_MAX;
+    for (int i = 0; i < objects->size; i++)
+    {
+        CIRCLE_OBJ *circle_obj = objects->data + i;
+        if (!circle_obj->alive)
+            continue;
+        int root = findIslandRoot(parent, i);
+        if (!circle_obj->asleep && circle_obj->still_frames < SLEEP_FRAMES)
+            restless[root] = SDL_TRUE;
+        // circles joining an island that is already asleep take over its label
+        label[root] = SDL_min(label[root], circle_obj->asleep ? circle_obj->island : circle_obj->id);
+    }
+    for (int i = 0; i < objects->size; i++)
+    {
+        CIRCLE_OBJ *circle_obj = objects->data + i;
+        int root = findIslandRoot(parent, i);
+        if (!circle_obj->alive || restless[root])
+            continue;
+        if (circle_obj->asleep && circle_obj->island != label[root])
+        {
+            // this island bridged two sleeping islands, merge them under one label
+            int old_label = circle_obj->island;
+            for (int k = 0; k < objects->size; k++)
+            {
+                if (objects->data[k].asleep && objects->data[k].island == old_label)
+                    objects->data[k].island = label[root];
+            }
+        }
+        circle_obj->asleep = SDL_TRUE;
+        circle_obj->island = label[root];
+        circle_obj->phys_comp.vel = (VECTOR_2D){0, 0};
+    }
+
+    free(parent);
+    free(label);
+    free(restless);
+}
+
+int findIslandRoot(int *parent, int i)
+{
+    while (parent[i] != i)
+    {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+void addContact(CONTACT_ARRAY *contacts, int i, int j)
+{
+    if (contacts->size >= contacts->cap)
+    {
+        CONTACT *temp = (CONTACT *)realloc(contacts->data, contacts->cap * 4 * sizeof(CONTACT));
+        CONTACT *temp_sorted = temp ? (CONTACT *)realloc(contacts->sorted, contacts->cap * 4 * sizeof(CONTACT)) : NULL;
+        if (temp)
+            contacts->data = temp;
+        if (temp_sorted)
+        {
+            contacts->cap *= 4;
+            contacts->sorted = temp_sorted;
+        }
+        else
+        {
+            fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+            return;
+        }
+    }
+    contacts->data[contacts->size++] = (CONTACT){i, j};
+}
+
+void colorContacts(CONTACT_ARRAY *contacts, int num_objects)
+{
+    // greedy edge colouring of the contact graph in gathering order, so the batches are the same on every run
+    if (num_objects > contacts->used_colors_cap)
+    {
+        Uint64 *temp = (Uint64 *)realloc(contacts->used_colors, num_objects * sizeof(Uint64));
+        if (temp == NULL)
+        {
+            fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+            num_objects = 0;
+        }
+        else
+        {
+            contacts->used_colors = temp;
+            contacts->used_colors_cap = num_objects;
+        }
+    }
+    int count[MAX_CONTACT_COLORS + 1] = {0};
+    Uint8 *color_of = (Uint8 *)malloc(contacts->size);
+    if (num_objects == 0 || color_of == NULL)
+    {
+        // resolve everything as one serial batch
+        free(color_of);
+        memcpy(contacts->sorted, contacts->data, contacts->size * sizeof(CONTACT));
+        for (int c = 0; c <= MAX_CONTACT_COLORS; c++)
+            contacts->batch_start[c] = 0;
+        contacts->batch_start[MAX_CONTACT_COLORS + 1] = contacts->size;
+        return;
+    }
+    memset(contacts->used_colors, 0, num_objects * sizeof(Uint64));
+    for (int k = 0; k < contacts->size; k++)
+    {
+        CONTACT contact = contacts->data[k];
+        Uint64 free_colors = ~(contacts->used_colors[contact.i] | contacts->used_colors[contact.j]);
+        int color = MAX_CONTACT_COLORS;
+        if (free_colors)
+        {
+            color = __builtin_ctzll(free_colors);
+            contacts->used_colors[contact.i] |= (Uint64)1 << color;
+            contacts->used_colors[contact.j] |= (Uint64)1 << color;
+        }
+        color_of[k] = color;
+        count[color]++;
+    }
+    // counting sort by colour, keeping gathering order within a colour
+    contacts->batch_start[0] = 0;
+    for (int c = 0; c <= MAX_CONTACT_COLORS; c++)
+        contacts->batch_start[c + 1] = contacts->batch_start[c] + count[c];
+    for (int c = 0; c <= MAX_CONTACT_COLORS; c++)
+        count[c] = contacts->batch_start[c];
+    for (int k = 0; k < contacts->size; k++)
+        contacts->sorted[count[color_of[k]]++] = contacts->data[k];
+    free(color_of);
+}
+
+void resolveContacts(ENGINE_2D *engine)
+{
+    CONTACT_ARRAY *contacts = engine->contacts;
+    if (contacts->size == 0)
+        return;
+    colorContacts(contacts, engine->objects->size);
+
+    CONTACT_BATCH batch = {engine, contacts->sorted};
+    for (int c = 0; c < MAX_CONTACT_COLORS; c++)
+    {
+        int begin = contacts->batch_start[c], end = contacts->batch_start[c + 1];
+        batch.contacts = contacts->sorted + begin;
+        ThreadPool_ParallelFor(engine->thread_pool, end - begin, MIN_CONTACTS_PER_THREAD, engine->step_kernel->resolve_contact_range, &batch);
+    }
+    // contacts that ran out of colours share circles, so they are resolved one after another
+    int begin = contacts->batch_start[MAX_CONTACT_COLORS];
+    batch.contacts = contacts->sorted + begin;
+    engine->step_kernel->resolve_contact_range(&batch, 0, contacts->batch_start[MAX_CONTACT_COLORS + 1] - begin);
+}
+
+static inline void resolveContactRangeKernel(void *context, int begin, int end, const SDL_bool elastic)
+{
+    CONTACT_BATCH *batch = (CONTACT_BATCH *)context;
+    CIRCLE_OBJ *data = batch->engine->objects->data;
+    for (int k = begin; k < end; k++)
+    {
+        CIRCLE_OBJ *c1 = data + batch->contacts[k].i;
+        CIRCLE_OBJ *c2 = data + batch->contacts[k].j;
+        // an earlier batch may have merged one of them away or pushed them apart
+        if (!c1->alive || !c2->alive)
             continue;
-        for (int j = i + 1; j < engine->objects->size; j++)
+        VECTOR_2D displacement = Vector2D_Difference(c2->phys_comp.pos, c1->phys_comp.pos);
+        if (Vector2D_Magnitude(displacement) >= c1->radius + c2->radius)
+            continue;
+        if (elastic)
+            bounceCircles(c1, c2);
+        else
+        {
+            mergeCircles(c1, c2, batch->engine->config.density);
+            SDL_AtomicIncRef(&batch->engine->merge_count);
+        }
+    }
+}
+
+void handleCollision(CIRCLE_OBJ *c1, CIRCLE_OBJ *c2, SDL_bool is_collision_elastic, double density)
+{
+    if (is_collision_elastic)
+        bounceCircles(c1, c2);
+    else
+        mergeCircles(c1, c2, density);
+}
+
+void bounceCircles(CIRCLE_OBJ *c1, CIRCLE_OBJ *c2)
+{
+    REAL m1 = c1->phys_comp.mass;
+    REAL m2 = c2->phys_comp.mass;
+    VECTOR_2D u1 = c1->phys_comp.vel;
+    VECTOR_2D u2 = c2->phys_comp.vel;
+    VECTOR_2D pos1 = c1->phys_comp.pos;
+    VECTOR_2D pos2 = c2->phys_comp.pos;
+    // bounce c1 and c2 off each other
+    c1->phys_comp.vel = Vector2D_ScalarProduct(
+        Vector2D_Sum(
+            Vector2D_ScalarProduct(u1, m1 - m2),
+            Vector2D_ScalarProduct(u2, m2 * 2)),
+        1 / (m1 + m2));
+
+    c2->phys_comp.vel = Vector2D_ScalarProduct(
+        Vector2D_Sum(
+            Vector2D_ScalarProduct(u2, m2 - m1),
+            Vector2D_ScalarProduct(u1, m1 * 2)),
+        1 / (m1 + m2));
+
+    // Push c1 outside of c2
+    VECTOR_2D displacement = Vector2D_Difference(pos1, pos2);
+    REAL push_back_magnitude = c1->radius + c2->radius - Vector2D_Magnitude(displacement);
+    VECTOR_2D push_back_vec = Vector2D_ScalarProduct(Vector2D_Normalised(displacement), push_back_magnitude);
+    c1->phys_comp.pos = Vector2D_Sum(c1->phys_comp.pos, push_back_vec);
+}
+
+void mergeCircles(CIRCLE_OBJ *c1, CIRCLE_OBJ *c2, double density)
+{
+    REAL m1 = c1->phys_comp.mass;
+    REAL m2 = c2->phys_comp.mass;
+    VECTOR_2D u1 = c1->phys_comp.vel;
+    VECTOR_2D u2 = c2->phys_comp.vel;
+    VECTOR_2D pos1 = c1->phys_comp.pos;
+    VECTOR_2D pos2 = c2->phys_comp.pos;
+    // Merge c2 into c1
+    c1->color = mixTwoColors(c1->color, c2->color);
+    // Conservation of Linear Momentum
+    c1->phys_comp.vel = Vector2D_ScalarProduct(
+        Vector2D_Sum(
+            Vector2D_ScalarProduct(u1, m1),
+            Vector2D_ScalarProduct(u2, m2)),
+        1 / (m1 + m2));
+    // Conservation of Centre of Mass
+    c1->phys_comp.pos = Vector2D_ScalarProduct(
+        Vector2D_Sum(
+            Vector2D_ScalarProduct(pos1, m1),
+            Vector2D_ScalarProduct(pos2, m2)),
+        1 / (m1 + m2));
+    // mass of new body is the combined mass of both bodies, and radius is recalculated according to new mass
+    c1->phys_comp.mass += c2->phys_comp.mass;
+    c1->radius = SDL_sqrt(c1->phys_comp.mass / (π * density));
+    // destroy c2
+    c2->alive = 0;
+}
+
+void sweepAndResolveImpacts(ENGINE_2D *engine)
+{
+    OBJECT_ARRAY *objects = engine->objects;
+    if (objects->size == 0)
+        return;
+    IMPACT *impacts = (IMPACT *)malloc(objects->size * sizeof(IMPACT));
+    if (impacts == NULL)
+    {
+        fprintf(stderr, "ALLOCATION FAILED in %s\n", __func__);
+        engine->step_kernel->update_positions(engine, engine->dt);
+        return;
+    }
+
+    // earliest impact of every circle, as an absolute time within this frame
+    for (int i = 0; i < objects->size; i++)
+        findEarliestImpactOf(engine, impacts, i, 0);
+
+    double now = 0;
+    int max_events = objects->size * MAX_CCD_EVENTS_PER_BODY;
+    for (int event = 0; event < max_events; event++)
+    {
+        int a = 0;
+        for (int i = 1; i < objects->size; i++)
+        {
+            if (impacts[i].time < impacts[a].time)
+                a = i;
+        }
+        if (impacts[a].time >= engine->dt)
+            break;
+
+        // sub-step every circle up to the moment of impact
+        double step = impacts[a].time - now;
+        for (int i = 0; i < objects->size; i++)
+        {
+            objects->data[i].phys_comp.pos = Vector2D_Sum(
+                objects->data[i].phys_comp.pos,
+                Vector2D_ScalarProduct(objects->data[i].phys_comp.vel, step));
+        }
+        now = impacts[a].time;
+
+        int b = impacts[a].partner;
+        CIRCLE_OBJ *circle_obj = objects->data + a;
+        if (b == WALL_X)
+        {
+            circle_obj->phys_comp.vel.x *= -1;
+            circle_obj->phys_comp.pos.x = SDL_clamp(circle_obj->phys_comp.pos.x, circle_obj->radius, engine->config.world_width - circle_obj->radius);
+            b = NO_IMPACT;
+        }
+        else if (b == WALL_Y)
+        {
+            circle_obj->phys_comp.vel.y *= -1;
+            circle_obj->phys_comp.pos.y = SDL_clamp(circle_obj->phys_comp.pos.y, circle_obj->radius, engine->config.world_height - circle_obj->radius);
+            b = NO_IMPACT;
+        }
+        else
+        {
+            // keep the lower index as c1, as the pairwise pass does
+            if (b < a)
+            {
+                int temp = a;
+                a = b;
+                b = temp;
+            }
+            wakeIsland(objects, objects->data + a);
+            wakeIsland(objects, objects->data + b);
+            handleCollision(objects->data + a, objects->data + b, engine->flags & ELASTIC_COLLISION, engine->config.density);
+            if (!(engine->flags & ELASTIC_COLLISION))
+                SDL_AtomicIncRef(&engine->merge_count);
+        }
+
+        // only impacts involving a or b have changed; everything else just moved along its line
+        findEarliestImpactOf(engine, impacts, a, now);
+        if (b != NO_IMPACT)
+            findEarliestImpactOf(engine, impacts, b, now);
+        for (int k = 0; k < objects->size; k++)
         {
-            if (!engine->objects->data[j].alive)
+            if (k == a || k == b || !objects->data[k].alive)
+                continue;
+            if (impacts[k].partner == a || (b != NO_IMPACT && impacts[k].partner == b))
+            {
+                findEarliestImpactOf(engine, impacts, k, now);
                 continue;
-            double m1 = engine->objects->data[i].phys_comp.mass;
-            double m2 = engine->objects->data[j].phys_comp.mass;
-            VECTOR_2D pos1 = engine->objects->data[i].phys_comp.pos;
-            VECTOR_2D pos2 = engine->objects->data[j].phys_comp.pos;
-            VECTOR_2D displacement = Vector2D_Difference(pos2, pos1);
-            double dist = Vector2D_Magnitude(displacement);
-            if (dist < engine->objects->data[i].radius + engine->objects->data[j].radius)
-            {
-                handleCollision(engine->objects->data + i, engine->objects->data + j, engine->flags & ELASTIC_COLLISION);
-                if (engine->flags & ELASTIC_COLLISION)
-                    // stop calculating with dead circles[j] in case of merge
+            }
+            int affected[2] = {a, b};
+            for (int n = 0; n < 2; n++)
+            {
+                int x = affected[n];
+                if (x == NO_IMPACT || !objects->data[x].alive)
                     continue;
+                double time = now + sweptCircleTimeOfImpact(objects->data + k, objects->data + x);
+                if (time < impacts[k].time)
+                {
+                    impacts[k].time = time;
+                    impacts[k].partner = x;
+                }
+                if (time < impacts[x].time)
+                {
+                    impacts[x].time = time;
+                    impacts[x].partner = k;
+                }
             }
-            if (engine->flags & ENABLE_GRAVITY)
+        }
+    }
+
+    free(impacts);
+    engine->step_kernel->update_positions(engine, engine->dt - now);
+}
+
+void findEarliestImpactOf(ENGINE_2D *engine, IMPACT *impacts, int i, double now)
+{
+    OBJECT_ARRAY *objects = engine->objects;
+    impacts[i].time = INFINITY;
+    impacts[i].partner = NO_IMPACT;
+    if (!objects->data[i].alive)
+        return;
+    for (int j = 0; j < objects->size; j++)
+    {
+        if (j == i || !objects->data[j].alive)
+            continue;
+        double time = now + sweptCircleTimeOfImpact(objects->data + i, objects->data + j);
+        if (time < impacts[i].time)
+        {
+            impacts[i].time = time;
+            impacts[i].partner = j;
+        }
+    }
+    if (!(engine->flags & BOUNDING_BOX))
+        return;
+    int wall;
+    double time = now + wallTimeOfImpact(engine, objects->data + i, &wall);
+    if (time < impacts[i].time)
+    {
+        impacts[i].time = time;
+        impacts[i].partner = wall;
+    }
+}
+
+double sweptCircleTimeOfImpact(CIRCLE_OBJ *c1, CIRCLE_OBJ *c2)
+{
+    // solve |displacement + rel_vel * t| = r1 + r2 for the earliest t >= 0, in double whatever REAL is
+    double dx = (double)c2->phys_comp.pos.x - c1->phys_comp.pos.x;
+    double dy = (double)c2->phys_comp.pos.y - c1->phys_comp.pos.y;
+    double vx = (double)c2->phys_comp.vel.x - c1->phys_comp.vel.x;
+    double vy = (double)c2->phys_comp.vel.y - c1->phys_comp.vel.y;
+    double half_b = dx * vx + dy * vy;
+    if (half_b >= 0)
+        // moving apart, or not moving relative to each other
+        return INFINITY;
+    double radii = (double)c1->radius + c2->radius;
+    double c = dx * dx + dy * dy - radii * radii;
+    if (c <= 0)
+        return 0;
+    double a = vx * vx + vy * vy;
+    double discriminant = half_b * half_b - a * c;
+    if (discriminant < 0)
+        return INFINITY;
+    // smaller root, written to avoid cancellation when c is tiny
+    return c / (-half_b + SDL_sqrt(discriminant));
+}
+
+double wallTimeOfImpact(ENGINE_2D *engine, CIRCLE_OBJ *circle_obj, int *wall)
+{
+    *wall = NO_IMPACT;
+    double time = INFINITY;
+    VECTOR_2D pos = circle_obj->phys_comp.pos;
+    VECTOR_2D vel = circle_obj->phys_comp.vel;
+    double r = circle_obj->radius;
+    if (vel.x < 0 || vel.x > 0)
+    {
+        double t = vel.x < 0 ? (r - pos.x) / vel.x : (engine->config.world_width - r - pos.x) / vel.x;
+        time = SDL_max(t, 0);
+        *wall = WALL_X;
+    }
+    if (vel.y < 0 || vel.y > 0)
+    {
+        double t = vel.y < 0 ? (r - pos.y) / vel.y : (engine->config.world_height - r - pos.y) / vel.y;
+        if (SDL_max(t, 0) < time)
+        {
+            time = SDL_max(t, 0);
+            *wall = WALL_Y;
+        }
+    }
+    return time;
+}
+
+static inline void updatePositionsKernel(ENGINE_2D *engine, double step, const SDL_bool walled, const SDL_bool sleeping)
+{
+    NEIGHBOUR_LIST *neighbours = &engine->neighbours;
+    const REAL max_drift = NEIGHBOUR_SKIN / 2;
+    for (int i = 0; i < engine->objects->size; i++)
+    {
+        if (sleeping && engine->objects->data[i].asleep)
+            continue;
+        engine->objects->data[i].phys_comp.pos = Vector2D_Sum(
+            engine->objects->data[i].phys_comp.pos,
+            Vector2D_ScalarProduct(engine->objects->data[i].phys_comp.vel, step));
+
+        if (walled)
+        {
+            if (engine->objects->data[i].phys_comp.pos.x < engine->objects->data[i].radius ||
+                engine->objects->data[i].phys_comp.pos.x > engine->config.world_width - engine->objects->data[i].radius)
             {
-                double force_magnitude = G * m1 * m2 / SDL_pow(dist, 2);
-                VECTOR_2D force = Vector2D_ScalarProduct(
-                    Vector2D_Normalised(displacement),
-                    force_magnitude);
+                engine->objects->data[i].phys_comp.vel.x *= -1;
+                engine->objects->data[i].phys_comp.pos.x = SDL_clamp(
+                    engine->objects->data[i].phys_comp.pos.x,
+                    engine->objects->data[i].radius,
+                    engine->config.world_width - engine->objects->data[i].radius);
+            }
 
-                engine->objects->data[i].phys_comp.vel = Vector2D_Sum(
-                    engine->objects->data[i].phys_comp.vel,
-                    Vector2D_ScalarProduct(force, engine->dt / m1));
+            if (engine->objects->data[i].phys_comp.pos.y < engine->objects->data[i].radius ||
+                engine->objects->data[i].phys_comp.pos.y > engine->config.world_height - engine->objects->data[i].radius)
+            {
+                engine->objects->data[i].phys_comp.vel.y *= -1;
+                engine->objects->data[i].phys_comp.pos.y = SDL_clamp(
+                    engine->objects->data[i].phys_comp.pos.y,
+                    engine->objects->data[i].radius,
+                    engine->config.world_height - engine->objects->data[i].radius);
+            }
+        }
+        else
+        {
+            if (engine->objects->data[i].phys_comp.pos.x + engine->objects->data[i].radius < 0 - engine->config.buffer_zone)
+                engine->objects->data[i].alive = 0;
+            else if (engine->objects->data[i].phys_comp.pos.y + engine->objects->data[i].radius < 0 - engine->config.buffer_zone)
+                engine->objects->data[i].alive = 0;
+            else if (engine->objects->data[i].phys_comp.pos.x - engine->objects->data[i].radius >= engine->config.world_width + engine->config.buffer_zone)
+                engine->objects->data[i].alive = 0;
+            else if (engine->objects->data[i].phys_comp.pos.y - engine->objects->data[i].radius >= engine->config.world_height + engine->config.buffer_zone)
+                engine->objects->data[i].alive = 0;
+        }
 
-                engine->objects->data[j].phys_comp.vel = Vector2D_Difference(
-                    engine->objects->data[j].phys_comp.vel,
-                    Vector2D_ScalarProduct(force, engine->dt / m2));
+        // measured from the build rather than summed per step, which also takes in the pushes apart by bounces
+        if (neighbours->valid && engine->objects->data[i].alive)
+        {
+            int id = engine->objects->data[i].id;
+            if (id >= neighbours->built_next_id)
+                neighbours->valid = SDL_FALSE;
+            else
+            {
+                REAL drift_x = engine->objects->data[i].phys_comp.pos.x - neighbours->built_x[id];
+                REAL drift_y = engine->objects->data[i].phys_comp.pos.y - neighbours->built_y[id];
+                if (drift_x * drift_x + drift_y * drift_y > max_drift * max_drift)
+                    neighbours->valid = SDL_FALSE;
             }
         }
     }
 }
 
-void handleCollision(CIRCLE_OBJ *c1, CIRCLE_OBJ *c2, SDL_bool is_collision_elastic)
+#define DEFINE_GRAVITY_KERNEL(NAME, GRAVITY, SLEEPING) \
+    void NAME(ENGINE_2D *engine) { simulateGravitationalForceKernel(engine, GRAVITY, SLEEPING); }
+#define DEFINE_CONTACT_KERNEL(NAME, ELASTIC) \
+    void NAME(void *context, int begin, int end) { resolveContactRangeKernel(context, begin, end, ELASTIC); }
+#define DEFINE_POSITION_KERNEL(NAME, WALLED, SLEEPING) \
+    void NAME(ENGINE_2D *engine, double step) { updatePositionsKernel(engine, step, WALLED, SLEEPING); }
+
+#ifdef ENGINE2D_BRANCHY_STEP
+// reads the mode flags inside the loops, kept to benchmark the specialised kernels against
+DEFINE_GRAVITY_KERNEL(simulateGravitationalForceBranchy, (engine->flags & ENABLE_GRAVITY) != 0, (engine->flags & ENABLE_SLEEPING) != 0)
+DEFINE_CONTACT_KERNEL(resolveContactRangeBranchy, (((CONTACT_BATCH *)context)->engine->flags & ELASTIC_COLLISION) != 0)
+DEFINE_POSITION_KERNEL(updatePositionsBranchy, (engine->flags & BOUNDING_BOX) != 0, (engine->flags & ENABLE_SLEEPING) != 0)
+
+const STEP_KERNEL *selectStepKernel(int flags)
+{
+    static const STEP_KERNEL branchy = {simulateGravitationalForceBranchy, resolveContactRangeBranchy, updatePositionsBranchy};
+    (void)flags;
+    return &branchy;
+}
+#else
+DEFINE_GRAVITY_KERNEL(simulateGravitationalForceContactsOnly, SDL_FALSE, SDL_FALSE)
+DEFINE_GRAVITY_KERNEL(simulateGravitationalForceWithGravity, SDL_TRUE, SDL_FALSE)
+DEFINE_GRAVITY_KERNEL(simulateGravitationalForceContactsOnlySleeping, SDL_FALSE, SDL_TRUE)
+DEFINE_GRAVITY_KERNEL(simulateGravitationalForceWithGravitySleeping, SDL_TRUE, SDL_TRUE)
+DEFINE_CONTACT_KERNEL(resolveContactRangeMerge, SDL_FALSE)
+DEFINE_CONTACT_KERNEL(resolveContactRangeBounce, SDL_TRUE)
+DEFINE_POSITION_KERNEL(updatePositionsOpen, SDL_FALSE, SDL_FALSE)
+DEFINE_POSITION_KERNEL(updatePositionsWalled, SDL_TRUE, SDL_FALSE)
+DEFINE_POSITION_KERNEL(updatePositionsOpenSleeping, SDL_FALSE, SDL_TRUE)
+DEFINE_POSITION_KERNEL(updatePositionsWalledSleeping, SDL_TRUE, SDL_TRUE)
+
+#define STEP_KERNEL_INDEX(elastic, gravity, walled, sleeping) ((elastic) | (gravity) << 1 | (walled) << 2 | (sleeping) << 3)
+#define STEP_KERNEL_ENTRY(elastic, gravity, walled, sleeping)                                                                  \
+    [STEP_KERNEL_INDEX(elastic, gravity, walled, sleeping)] = {                                                                \
+        (gravity) ? ((sleeping) ? simulateGravitationalForceWithGravitySleeping : simulateGravitationalForceWithGravity)       \
+                  : ((sleeping) ? simulateGravitationalForceContactsOnlySleeping : simulateGravitationalForceContactsOnly),    \
+        (elastic) ? resolveContactRangeBounce : resolveContactRangeMerge,                                                      \
+        (walled) ? ((sleeping) ? updatePositionsWalledSleeping : updatePositionsWalled)                                        \
+                 : ((sleeping) ? updatePositionsOpenSleeping : updatePositionsOpen),                                           \
+    }
+
+const STEP_KERNEL step_kernels[16] = {
+    STEP_KERNEL_ENTRY(0, 0, 0, 0), STEP_KERNEL_ENTRY(1, 0, 0, 0), STEP_KERNEL_ENTRY(0, 1, 0, 0), STEP_KERNEL_ENTRY(1, 1, 0, 0),
+    STEP_KERNEL_ENTRY(0, 0, 1, 0), STEP_KERNEL_ENTRY(1, 0, 1, 0), STEP_KERNEL_ENTRY(0, 1, 1, 0), STEP_KERNEL_ENTRY(1, 1, 1, 0),
+    STEP_KERNEL_ENTRY(0, 0, 0, 1), STEP_KERNEL_ENTRY(1, 0, 0, 1), STEP_KERNEL_ENTRY(0, 1, 0, 1), STEP_KERNEL_ENTRY(1, 1, 0, 1),
+    STEP_KERNEL_ENTRY(0, 0, 1, 1), STEP_KERNEL_ENTRY(1, 0, 1, 1), STEP_KERNEL_ENTRY(0, 1, 1, 1), STEP_KERNEL_ENTRY(1, 1, 1, 1),
+};
+
+const STEP_KERNEL *selectStepKernel(int flags)
+{
+    return step_kernels + STEP_KERNEL_INDEX(
+                              (flags & ELASTIC_COLLISION) != 0,
+                              (flags & ENABLE_GRAVITY) != 0,
+                              (flags & BOUNDING_BOX) != 0,
+                              (flags & ENABLE_SLEEPING) != 0);
+}
+#endif
+
+void RenderFillCircle(ENGINE_2D *engine, CIRCLE_OBJ *circle_obj)
+{
+    SDL_Renderer *renderer = engine->renderer;
+    VECTOR_2D origin = viewOrigin(engine);
+    int x = (circle_obj->phys_comp.pos.x - origin.x) * engine->camera_zoom;
+    int y = (circle_obj->phys_comp.pos.y - origin.y) * engine->camera_zoom;
+    int r = circle_obj->radius * engine->camera_zoom;
+    SDL_SetRenderDrawColor(renderer, circle_obj->color.r, circle_obj->color.g, circle_obj->color.b, SDL_ALPHA_OPAQUE);
+    for (int i = x - r; i <= x + r; i++)
+    {
+        if (i < 0 || i >= engine->view_width)
+            continue;
+        for (int j = y - r; j <= y + r; j++)
+        {
+            if (j < 0 || j >= engine->view_height)
+                continue;
+            double dist = Vector2D_Magnitude(Vector2D_Difference((VECTOR_2D){i, j}, (VECTOR_2D){x, y}));
+            if (dist <= r)
+                SDL_RenderDrawPoint(renderer, i, j);
+        }
+    }
+}
+
+// reads the console on a thread of its own until the console closes or the engine is freed
+void startConsole(ENGINE_2D *engine)
+{
+    if (pipe(engine->console_wake_fds) != 0)
+    {
+        fprintf(stderr, "console: cannot create a wake pipe: %s\n", strerror(errno));
+        SDL_AtomicSet(&console_claimed, 0);
+        return;
+    }
+    engine->input_thread = SDL_CreateThread(processUserInput, "input thread", engine);
+    if (engine->input_thread == NULL)
+    {
+        fprintf(stderr, "THREAD CREATION FAILED in %s: %s\n", __func__, SDL_GetError());
+        close(engine->console_wake_fds[0]);
+        close(engine->console_wake_fds[1]);
+        SDL_AtomicSet(&console_claimed, 0);
+        return;
+    }
+    engine->owns_console = SDL_TRUE;
+}
+
+// wakes the input thread and waits for it, so that no line typed in afterwards reaches a freed engine, then hands
+// the console on to the next engine that asks for it
+void stopConsole(ENGINE_2D *engine)
+{
+    char byte = 0;
+    if (write(engine->console_wake_fds[1], &byte, 1) != 1)
+        fprintf(stderr, "console: cannot wake the input thread: %s\n", strerror(errno));
+    SDL_WaitThread(engine->input_thread, NULL);
+    engine->input_thread = NULL;
+    close(engine->console_wake_fds[0]);
+    close(engine->console_wake_fds[1]);
+    engine->owns_console = SDL_FALSE;
+    SDL_AtomicSet(&console_claimed, 0);
+}
+
+// reads stdin with poll and read rather than fgets, which couldn't be woken to stop while waiting for a line
+int SDLCALL processUserInput(void *data)
+{
+    ENGINE_2D *engine = (ENGINE_2D *)data;
+    printf("Supported Commands: create, clear, set, pause, resume, step, rewind, source, stats\n");
+    // what has been read of lines not yet complete, and the line handled next, newline and all as fgets gave it
+    char pending[INPUT_BUFFER_SIZE], input[INPUT_BUFFER_SIZE];
+    size_t size = 0;
+    SDL_bool closed = SDL_FALSE;
+    printf("$ ");
+    fflush(stdout);
+    while (!closed || size > 0)
+    {
+        char *newline = (char *)memchr(pending, '\n', size);
+        // a line too long for the buffer is handled in pieces, and the last one even without its newline
+        size_t length = newline != NULL ? (size_t)(newline - pending) + 1 : size == sizeof(pending) - 1 || closed ? size : 0;
+        if (length > 0)
+        {
+            SDL_memcpy(input, pending, length);
+            input[length] = '\0';
+            size -= length;
+            memmove(pending, pending + length, size);
+            handleConsoleLine(engine, input);
+            printf("$ ");
+            fflush(stdout);
+            continue;
+        }
+        struct pollfd fds[] = {{.fd = STDIN_FILENO, .events = POLLIN}, {.fd = engine->console_wake_fds[0], .events = POLLIN}};
+        if (poll(fds, SDL_arraysize(fds), -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return 0;
+        }
+        if (fds[1].revents != 0)
+            return 0;
+        if (fds[0].revents == 0)
+            continue;
+        ssize_t num_read = read(STDIN_FILENO, pending + size, sizeof(pending) - 1 - size);
+        if (num_read < 0 && errno == EINTR)
+            continue;
+        // the console closing only ends the input, the simulation carries on
+        if (num_read <= 0)
+            closed = SDL_TRUE;
+        else
+            size += num_read;
+    }
+    return 0;
+}
+
+void handleConsoleLine(ENGINE_2D *engine, char *input)
+{
+    char command[10];
+    if (sscanf(input, "%9s", command) != 1 || handleControlCommand(engine, command, input))
+        return;
+    // a script is read before taking the lock, so reading it doesn't hold up the frames
+    if (strcasecmp(command, "source") == 0)
+        handleSourceCommand(engine, input);
+    else
+    {
+        SDL_LockMutex(engine->shared_state_mutex);
+        if (engine->flags & DETERMINISTIC)
+            queueCommand(&engine->pending_commands, input);
+        else
+            executeCommand(engine, input);
+        SDL_UnlockMutex(engine->shared_state_mutex);
+    }
+}
+
+void executeCommand(ENGINE_2D *engine, char *input)
+{
+    input[strcspn(input, "\r\n")] = '\0';
+    char command[10];
+    if (sscanf(input, "%9s", command) != 1)
+        return;
+    // a sourced script records its commands one by one as they run
+    if (engine->record_file != NULL && strcasecmp(command, "source") != 0)
+        fprintf(engine->record_file, "%d command %s\n", engine->frame, input);
+    engine->applying_command = SDL_TRUE;
+    if (strcasecmp(command, "create") == 0)
+        handleCreateCommand(engine, input);
+    else if (strcasecmp(command, "clear") == 0)
+        handleClearCommand(engine, input);
+    else if (strcasecmp(command, "set") == 0)
+        handleSetCommand(engine, input);
+    else if (strcasecmp(command, "rewind") == 0)
+        handleRewindCommand(engine, input);
+    else if (strcasecmp(command, "source") == 0)
+        handleSourceCommand(engine, input);
+    else
+        printf("command not supported: '%s'\n", command);
+    engine->applying_command = SDL_FALSE;
+}
+
+void queueCommand(COMMAND_QUEUE *queue, char *input)
 {
-    double m1 = c1->phys_comp.mass;
-    double m2 = c2->phys_comp.mass;
-    VECTOR_2D u1 = c1->phys_comp.vel;
-    VECTOR_2D u2 = c2->phys_comp.vel;
-    VECTOR_2D pos1 = c1->phys_comp.pos;
-    VECTOR_2D pos2 = c2->phys_comp.pos;
-    if (is_collision_elastic)
+    if (queue->size >= queue->cap)
     {
-        // bounce c1 and c2 off each other
-        c1->phys_comp.vel = Vector2D_ScalarProduct(
-            Vector2D_Sum(
-                Vector2D_ScalarProduct(u1, m1 - m2),
-                Vector2D_ScalarProduct(u2, m2 * 2)),
-            1 / (m1 + m2));
-
-        c2->phys_comp.vel = Vector2D_ScalarProduct(
-            Vector2D_Sum(
-                Vector2D_ScalarProduct(u2, m2 - m1),
-                Vector2D_ScalarProduct(u1, m1 * 2)),
-            1 / (m1 + m2));
-
-        // Push c1 outside of c2
-        VECTOR_2D displacement = Vector2D_Difference(pos1, pos2);
-        double push_back_magnitude = c1->radius + c2->radius - Vector2D_Magnitude(displacement);
-        VECTOR_2D push_back_vec = Vector2D_ScalarProduct(Vector2D_Normalised(displacement), push_back_magnitude);
-        c1->phys_comp.pos = Vector2D_Sum(c1->phys_comp.pos, push_back_vec);
+        int cap = queue->cap > 0 ? queue->cap * 2 : 8;
+        char(*temp)[INPUT_BUFFER_SIZE] = (char(*)[INPUT_BUFFER_SIZE])realloc(queue->lines, cap * sizeof(*queue->lines));
+        if (temp == NULL)
+        {
+            fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+            return;
+        }
+        queue->cap = cap;
+        queue->lines = temp;
     }
+    SDL_strlcpy(queue->lines[queue->size++], input, INPUT_BUFFER_SIZE);
+}
+
+// pausing and stepping don't change the simulation, only whether it steps, and stats only read it, so they never
+// wait for a frame
+SDL_bool handleControlCommand(ENGINE_2D *engine, char *command, char *input)
+{
+    if (strcasecmp(command, "pause") == 0)
+        handlePauseCommand(engine, input);
+    else if (strcasecmp(command, "resume") == 0)
+        handleResumeCommand(engine, input);
+    else if (strcasecmp(command, "step") == 0)
+        handleStepCommand(engine, input);
+    else if (strcasecmp(command, "stats") == 0)
+        handleStatsCommand(engine, input);
     else
-    {
-        // Merge c2 into c1
-        c1->color = mixTwoColors(c1->color, c2->color);
-        // Conservation of Linear Momentum
-        c1->phys_comp.vel = Vector2D_ScalarProduct(
-            Vector2D_Sum(
-                Vector2D_ScalarProduct(u1, m1),
-                Vector2D_ScalarProduct(u2, m2)),
-            1 / (m1 + m2));
-        // Conservation of Centre of Mass
-        c1->phys_comp.pos = Vector2D_ScalarProduct(
-            Vector2D_Sum(
-                Vector2D_ScalarProduct(pos1, m1),
-                Vector2D_ScalarProduct(pos2, m2)),
-            1 / (m1 + m2));
-        // mass of new body is the combined mass of both bodies, and radius is recalculated according to new mass
-        c1->phys_comp.mass += c2->phys_comp.mass;
-        c1->radius = SDL_sqrt(c1->phys_comp.mass / (π * DENSITY));
-        // destroy c2
-        c2->alive = 0;
-    }
-}
-
-void updatePositionsAndCheckBounds(ENGINE_2D *engine)
+        return SDL_FALSE;
+    return SDL_TRUE;
+}
+
+// reads all of the script at path a chunk at a time, which works as well for a pipe as for a file
+char *loadScript(const char *path, size_t *size)
 {
-    for (int i = 0; i < engine->objects->size; i++)
+    FILE *script_file = fopen(path, "r");
+    if (script_file == NULL)
     {
-        engine->objects->data[i].phys_comp.pos = Vector2D_Sum(
-            engine->objects->data[i].phys_comp.pos,
-            Vector2D_ScalarProduct(engine->objects->data[i].phys_comp.vel, engine->dt));
-
-        if (engine->flags & BOUNDING_BOX)
+        printf("source: cannot open '%s'\n", path);
+        return NULL;
+    }
+    char *text = NULL;
+    size_t cap = 0, num_read;
+    *size = 0;
+    do
+    {
+        if (*size + SCRIPT_CHUNK_SIZE >= cap)
         {
-            if (engine->objects->data[i].phys_comp.pos.x < engine->objects->data[i].radius ||
-                engine->objects->data[i].phys_comp.pos.x > WINDOW_WIDTH - engine->objects->data[i].radius)
-            {
-                engine->objects->data[i].phys_comp.vel.x *= -1;
-                engine->objects->data[i].phys_comp.pos.x = SDL_clamp(
-                    engine->objects->data[i].phys_comp.pos.x,
-                    engine->objects->data[i].radius,
-                    WINDOW_WIDTH - engine->objects->data[i].radius);
-            }
-
-            if (engine->objects->data[i].phys_comp.pos.y < engine->objects->data[i].radius ||
-                engine->objects->data[i].phys_comp.pos.y > WINDOW_HEIGHT - engine->objects->data[i].radius)
+            cap = SDL_max(2 * cap, *size + SCRIPT_CHUNK_SIZE + 1);
+            char *temp = (char *)realloc(text, cap);
+            if (temp == NULL)
             {
-                engine->objects->data[i].phys_comp.vel.y *= -1;
-                engine->objects->data[i].phys_comp.pos.y = SDL_clamp(
-                    engine->objects->data[i].phys_comp.pos.y,
-                    engine->objects->data[i].radius,
-                    WINDOW_HEIGHT - engine->objects->data[i].radius);
+                fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+                free(text);
+                fclose(script_file);
+                return NULL;
             }
+            text = temp;
         }
-        else
-        {
-            if (engine->objects->data[i].phys_comp.pos.x + engine->objects->data[i].radius < 0 - BUFFER_ZONE)
-                engine->objects->data[i].alive = 0;
-            else if (engine->objects->data[i].phys_comp.pos.y + engine->objects->data[i].radius < 0 - BUFFER_ZONE)
-                engine->objects->data[i].alive = 0;
-            else if (engine->objects->data[i].phys_comp.pos.x - engine->objects->data[i].radius >= WINDOW_WIDTH + BUFFER_ZONE)
-                engine->objects->data[i].alive = 0;
-            else if (engine->objects->data[i].phys_comp.pos.y - engine->objects->data[i].radius >= WINDOW_HEIGHT + BUFFER_ZONE)
-                engine->objects->data[i].alive = 0;
-        }
-    }
+        num_read = fread(text + *size, 1, SCRIPT_CHUNK_SIZE, script_file);
+        *size += num_read;
+    } while (num_read > 0);
+    fclose(script_file);
+    return text;
 }
 
-void RenderFillCircle(SDL_Renderer *renderer, CIRCLE_OBJ *circle_obj)
+// applies every line of the script under one lock, so no frame sees part of it; in deterministic mode the lines are
+// queued for the next frame boundary together, unless the script was itself sourced at one
+void applyScript(ENGINE_2D *engine, const char *path, const char *text, size_t size)
 {
-    int x = circle_obj->phys_comp.pos.x;
-    int y = circle_obj->phys_comp.pos.y;
-    int r = circle_obj->radius;
-    SDL_SetRenderDrawColor(renderer, circle_obj->color.r, circle_obj->color.g, circle_obj->color.b, SDL_ALPHA_OPAQUE);
-    for (int i = x - r; i <= x + r; i++)
+    SDL_LockMutex(engine->shared_state_mutex);
+    if (engine->script_depth >= MAX_SCRIPT_DEPTH)
     {
-        if (i < 0 || i >= WINDOW_WIDTH)
-            continue;
-        for (int j = y - r; j <= y + r; j++)
+        printf("source: '%s' is sourced more than %d scripts deep\n", path, MAX_SCRIPT_DEPTH);
+        SDL_UnlockMutex(engine->shared_state_mutex);
+        return;
+    }
+    SDL_bool queue = (engine->flags & DETERMINISTIC) && !engine->applying_command;
+    engine->script_depth++;
+    int line_number = 0;
+    for (const char *line = text, *end; line < text + size; line = end + 1)
+    {
+        end = (const char *)memchr(line, '\n', text + size - line);
+        if (end == NULL)
+            end = text + size;
+        line_number++;
+        char input[INPUT_BUFFER_SIZE], command[10];
+        if (end - line >= INPUT_BUFFER_SIZE)
         {
-            if (j < 0 || j >= WINDOW_HEIGHT)
-                continue;
-            double dist = Vector2D_Magnitude(Vector2D_Difference((VECTOR_2D){i, j}, (VECTOR_2D){x, y}));
-            if (dist <= r)
-                SDL_RenderDrawPoint(renderer, i, j);
+            printf("source: %s:%d: line longer than %d characters\n", path, line_number, INPUT_BUFFER_SIZE - 1);
+            continue;
         }
-    }
-}
-
-int SDLCALL processUserInput(void *data)
-{
-    ENGINE_2D *engine = (ENGINE_2D *)data;
-    printf("Supported Commands: create, clear, set, pause, resume\n");
-    while (SDL_TRUE)
-    {
-        printf("$ ");
-        char input[INPUT_BUFFER_SIZE];
-        char command[10];
-        fgets(input, INPUT_BUFFER_SIZE, stdin);
-        sscanf(input, "%s", command);
-        if (strcasecmp(command, "create") == 0)
-            handleCreateCommand(engine, input);
-        else if (strcasecmp(command, "clear") == 0)
-            handleClearCommand(engine, input);
-        else if (strcasecmp(command, "set") == 0)
-            handleSetCommand(engine, input);
-        else if (strcasecmp(command, "pause") == 0)
-            handlePauseCommand(engine, input);
-        else if (strcasecmp(command, "resume") == 0)
-            handleResumeCommand(engine, input);
+        SDL_memcpy(input, line, end - line);
+        input[end - line] = '\0';
+        // blank lines and lines starting with '#' are skipped
+        if (sscanf(input, "%9s", command) != 1 || command[0] == '#' || handleControlCommand(engine, command, input))
+            continue;
+        if (queue)
+            queueCommand(&engine->pending_commands, input);
         else
-            printf("command not supported: '%s'\n", command);
+            executeCommand(engine, input);
     }
+    engine->script_depth--;
+    SDL_UnlockMutex(engine->shared_state_mutex);
 }
 
 void handleCreateCommand(ENGINE_2D *engine, char *input)
 {
-    char *command = strtok(input, DELIM);
+    char *save_ptr;
+    char *command = strtok_r(input, DELIM, &save_ptr);
     char *flag;
     char color_char = 'w';
     RGB24 color = RGB_WHITE;
-    double radius = MIN_RADIUS, mass = π * radius * radius * DENSITY;
-    VECTOR_2D pos = {WINDOW_WIDTH / 2, WINDOW_HEIGHT / 2}, vel = {0, 0};
-    while ((flag = strtok(NULL, DELIM)) != NULL)
+    double radius = MIN_RADIUS, mass = π * radius * radius * engine->config.density, arg_value;
+    VECTOR_2D pos = {engine->config.world_width / 2, engine->config.world_height / 2}, vel = {0, 0};
+    while ((flag = strtok_r(NULL, DELIM, &save_ptr)) != NULL)
     {
         if (strcasecmp(flag, "--help") == 0)
         {
@@ -441,7 +3871,7 @@ void handleCreateCommand(ENGINE_2D *engine, char *input)
             printf("\t--vely NUM\tset the velocity of the circle object in the y-axis (default: %d)\n", (int)vel.y);
             printf("\t--help\tdisplay this help and exit\n");
         }
-        else if (tryParseCharOptionArg(command, flag, "-c", "--color", &color_char))
+        else if (tryParseCharOptionArg(command, flag, &save_ptr, "-c", "--color", &color_char))
         {
             switch (color_char)
             {
@@ -470,18 +3900,18 @@ void handleCreateCommand(ENGINE_2D *engine, char *input)
                 printf("try 'create --help' for more information\n");
             }
         }
-        else if (tryParseFloatOptionArg(command, flag, "-r", "--radius", &radius))
-            ;
-        else if (tryParseFloatOptionArg(command, flag, "-m", "--mass", &mass))
-            ;
-        else if (tryParseFloatOptionArg(command, flag, NULL, "--posx", &pos.x))
+        else if (tryParseFloatOptionArg(command, flag, &save_ptr, "-r", "--radius", &radius))
             ;
-        else if (tryParseFloatOptionArg(command, flag, NULL, "--posy", &pos.y))
-            ;
-        else if (tryParseFloatOptionArg(command, flag, NULL, "--velx", &vel.x))
-            ;
-        else if (tryParseFloatOptionArg(command, flag, NULL, "--vely", &vel.y))
+        else if (tryParseFloatOptionArg(command, flag, &save_ptr, "-m", "--mass", &mass))
             ;
+        else if (tryParseFloatOptionArg(command, flag, &save_ptr, NULL, "--posx", &arg_value))
+            pos.x = arg_value;
+        else if (tryParseFloatOptionArg(command, flag, &save_ptr, NULL, "--posy", &arg_value))
+            pos.y = arg_value;
+        else if (tryParseFloatOptionArg(command, flag, &save_ptr, NULL, "--velx", &arg_value))
+            vel.x = arg_value;
+        else if (tryParseFloatOptionArg(command, flag, &save_ptr, NULL, "--vely", &arg_value))
+            vel.y = arg_value;
     }
     Engine2D_CreateCircleObject(engine, color, radius, (PHYS_BODY){mass, pos, vel});
 }
@@ -489,14 +3919,14 @@ void handleCreateCommand(ENGINE_2D *engine, char *input)
 void handleClearCommand(ENGINE_2D *engine, char *input)
 {
     SDL_LockMutex(engine->shared_state_mutex);
-    strtok(input, DELIM); // skip the command
-    char *flag = strtok(NULL, DELIM);
+    char *save_ptr;
+    strtok_r(input, DELIM, &save_ptr); // skip the command
+    char *flag = strtok_r(NULL, DELIM, &save_ptr);
     int id;
     if (flag == NULL || strcasecmp(flag, "--all") == 0 || strcasecmp(flag, "-a") == 0)
     {
-        // clear the object array before the next frame
+        // clear the object array before the next frame; the next steps give back its memory as they find it empty
         engine->objects->size = 0;
-        engine->objects->cap = DEFAULT_ARR_CAPACITY;
     }
     else if (sscanf(flag, "--id=%d", &id) == 1)
     {
@@ -508,7 +3938,7 @@ void handleClearCommand(ENGINE_2D *engine, char *input)
     }
     else if (strcasecmp(flag, "--id") == 0)
     {
-        char *id_str = strtok(NULL, DELIM);
+        char *id_str = strtok_r(NULL, DELIM, &save_ptr);
         if (id_str == NULL)
         {
             printf("clear: option requires an argument -- '%s'\n", flag);
@@ -551,13 +3981,15 @@ void handleClearCommand(ENGINE_2D *engine, char *input)
 
 void handleSetCommand(ENGINE_2D *engine, char *input)
 {
-    char *cmd = strtok(input, DELIM);
+    char *save_ptr;
+    char *cmd = strtok_r(input, DELIM, &save_ptr);
     char *flag;
     SDL_bool is_flag_provided = SDL_FALSE;
-    while ((flag = strtok(NULL, DELIM)) != NULL)
+    while ((flag = strtok_r(NULL, DELIM, &save_ptr)) != NULL)
     {
         is_flag_provided = SDL_TRUE;
         int num_arg;
+        double float_arg;
         int arg_buf_size = 16;
         char arg_buf[arg_buf_size];
         if (sscanf(flag, "--elasticity=%d", &num_arg) == 1 || sscanf(flag, "-e=%d", &num_arg) == 1)
@@ -574,7 +4006,7 @@ void handleSetCommand(ENGINE_2D *engine, char *input)
         }
         else if (strcasecmp(flag, "-e") == 0 || strcasecmp(flag, "--elasticity") == 0)
         {
-            char *flag_val_str = strtok(NULL, DELIM);
+            char *flag_val_str = strtok_r(NULL, DELIM, &save_ptr);
             if (flag_val_str == NULL)
             {
                 printf("set: option requires an argument -- '%s'\n", flag);
@@ -598,7 +4030,7 @@ void handleSetCommand(ENGINE_2D *engine, char *input)
                 }
             }
         }
-        else if (tryParseStrOptionArg(cmd, flag, "-g", "--gravity", arg_buf, arg_buf_size))
+        else if (tryParseStrOptionArg(cmd, flag, &save_ptr, "-g", "--gravity", arg_buf, arg_buf_size))
         {
             if (strcasecmp(arg_buf, "on") == 0)
                 engine->flags |= ENABLE_GRAVITY;
@@ -610,6 +4042,232 @@ void handleSetCommand(ENGINE_2D *engine, char *input)
                 printf("Try 'set --help' for more information.\n");
             }
         }
+        else if (tryParseStrOptionArg(cmd, flag, &save_ptr, "-s", "--sleep", arg_buf, arg_buf_size))
+        {
+            if (strcasecmp(arg_buf, "on") == 0)
+                engine->flags |= ENABLE_SLEEPING;
+            else if (strcasecmp(arg_buf, "off") == 0)
+            {
+                SDL_LockMutex(engine->shared_state_mutex);
+                engine->flags &= ~ENABLE_SLEEPING;
+                for (int i = 0; i < engine->objects->size; i++)
+                    engine->objects->data[i].asleep = SDL_FALSE;
+                SDL_UnlockMutex(engine->shared_state_mutex);
+            }
+            else
+            {
+                printf("set: sleep can either be 'on' or 'off', not %s\n", arg_buf);
+                printf("Try 'set --help' for more information.\n");
+            }
+        }
+        else if (tryParseStrOptionArg(cmd, flag, &save_ptr, "-o", "--order", arg_buf, arg_buf_size))
+        {
+            if (strcasecmp(arg_buf, "on") == 0)
+                engine->flags |= SPATIAL_SORT;
+            else if (strcasecmp(arg_buf, "off") == 0)
+                engine->flags &= ~SPATIAL_SORT;
+            else
+            {
+                printf("set: order can either be 'on' or 'off', not %s\n", arg_buf);
+                printf("Try 'set --help' for more information.\n");
+            }
+        }
+        else if (tryParseStrOptionArg(cmd, flag, &save_ptr, "-c", "--ccd", arg_buf, arg_buf_size))
+        {
+            if (strcasecmp(arg_buf, "on") == 0)
+                engine->flags |= CONTINUOUS_COLLISION;
+            else if (strcasecmp(arg_buf, "off") == 0)
+                engine->flags &= ~CONTINUOUS_COLLISION;
+            else
+            {
+                printf("set: ccd can either be 'on' or 'off', not %s\n", arg_buf);
+                printf("Try 'set --help' for more information.\n");
+            }
+        }
+        else if (tryParseStrOptionArg(cmd, flag, &save_ptr, "-b", "--barnes-hut", arg_buf, arg_buf_size))
+        {
+            if (strcasecmp(arg_buf, "on") == 0)
+                engine->flags |= BARNES_HUT;
+            else if (strcasecmp(arg_buf, "off") == 0)
+                engine->flags &= ~BARNES_HUT;
+            else
+            {
+                printf("set: barnes-hut can either be 'on' or 'off', not %s\n", arg_buf);
+                printf("Try 'set --help' for more information.\n");
+            }
+        }
+        else if (tryParseStrOptionArg(cmd, flag, &save_ptr, "-m", "--multi-rate", arg_buf, arg_buf_size))
+        {
+            if (strcasecmp(arg_buf, "on") == 0)
+            {
+                // nothing kept the last kicks up to date while it was off
+                for (int i = 0; !(engine->flags & MULTI_RATE) && i < engine->objects->size; i++)
+                    engine->objects->data[i].kicked_frame = engine->frame - 1;
+                engine->flags |= MULTI_RATE;
+            }
+            else if (strcasecmp(arg_buf, "off") == 0)
+                engine->flags &= ~MULTI_RATE;
+            else
+            {
+                printf("set: multi-rate can either be 'on' or 'off', not %s\n", arg_buf);
+                printf("Try 'set --help' for more information.\n");
+            }
+        }
+        else if (tryParseIntOptionArg(cmd, flag, &save_ptr, NULL, "--far-interval", &num_arg))
+        {
+            if (num_arg >= 1)
+                engine->far_interval = num_arg;
+            else
+            {
+                printf("set: far-interval must be at least 1, not %d\n", num_arg);
+                printf("Try 'set --help' for more information.\n");
+            }
+        }
+        else if (tryParseStrOptionArg(cmd, flag, &save_ptr, "-d", "--diagnostics", arg_buf, arg_buf_size))
+        {
+            if (strcasecmp(arg_buf, "on") == 0)
+            {
+                // what was measured before they were off is no reference for what comes after
+                if (!(engine->flags & DIAGNOSTICS))
+                    engine->diagnostics.reference_frame = -1;
+                engine->flags |= DIAGNOSTICS;
+            }
+            else if (strcasecmp(arg_buf, "off") == 0)
+                engine->flags &= ~DIAGNOSTICS;
+            else
+            {
+                printf("set: diagnostics can either be 'on' or 'off', not %s\n", arg_buf);
+                printf("Try 'set --help' for more information.\n");
+            }
+        }
+        else if (tryParseFloatOptionArg(cmd, flag, &save_ptr, NULL, "--drift-limit", &float_arg))
+        {
+            if (float_arg >= 0)
+                engine->drift_limit = float_arg;
+            else
+            {
+                printf("set: drift-limit can't be negative, not %g\n", float_arg);
+                printf("Try 'set --help' for more information.\n");
+            }
+        }
+        else if (tryParseStrOptionArg(cmd, flag, &save_ptr, NULL, "--drift-action", arg_buf, arg_buf_size))
+        {
+            if (strcasecmp(arg_buf, "alert") == 0)
+                engine->drift_action = DRIFT_ALERT;
+            else if (strcasecmp(arg_buf, "dt") == 0)
+                engine->drift_action = DRIFT_HALVE_DT;
+            else
+            {
+                printf("set: drift-action can either be 'alert' or 'dt', not %s\n", arg_buf);
+                printf("Try 'set --help' for more information.\n");
+            }
+        }
+        else if (tryParseStrOptionArg(cmd, flag, &save_ptr, NULL, "--softening", arg_buf, arg_buf_size))
+        {
+            if (strcasecmp(arg_buf, "off") == 0)
+                Engine2D_SetSoftening(engine, SOFTENING_NONE, engine->softening_length);
+            else if (strcasecmp(arg_buf, "plummer") == 0)
+                Engine2D_SetSoftening(engine, SOFTENING_PLUMMER, engine->softening_length);
+            else if (strcasecmp(arg_buf, "spline") == 0)
+                Engine2D_SetSoftening(engine, SOFTENING_SPLINE, engine->softening_length);
+            else
+            {
+                printf("set: softening can either be 'off', 'plummer' or 'spline', not %s\n", arg_buf);
+                printf("Try 'set --help' for more information.\n");
+            }
+        }
+        else if (tryParseFloatOptionArg(cmd, flag, &save_ptr, NULL, "--softening-length", &float_arg))
+        {
+            if (float_arg >= 0)
+                Engine2D_SetSoftening(engine, engine->softening_kernel, float_arg);
+            else
+            {
+                printf("set: softening-length can't be negative, not %g\n", float_arg);
+                printf("Try 'set --help' for more information.\n");
+            }
+        }
+        else if (tryParseFloatOptionArg(cmd, flag, &save_ptr, NULL, "--close-gap", &float_arg))
+        {
+            if (float_arg >= 0)
+                engine->close_gap = float_arg;
+            else
+            {
+                printf("set: close-gap can't be negative, not %g\n", float_arg);
+                printf("Try 'set --help' for more information.\n");
+            }
+        }
+        else if (tryParseStrOptionArg(cmd, flag, &save_ptr, "-n", "--neighbours", arg_buf, arg_buf_size))
+        {
+            if (strcasecmp(arg_buf, "on") == 0)
+                engine->flags |= NEIGHBOUR_LISTS;
+            else if (strcasecmp(arg_buf, "off") == 0)
+                engine->flags &= ~NEIGHBOUR_LISTS;
+            else
+            {
+                printf("set: neighbours can either be 'on' or 'off', not %s\n", arg_buf);
+                printf("Try 'set --help' for more information.\n");
+            }
+        }
+        else if (tryParseStrOptionArg(cmd, flag, &save_ptr, "-r", "--raster", arg_buf, arg_buf_size))
+        {
+            if (strcasecmp(arg_buf, "on") == 0)
+                engine->flags |= SOFTWARE_RENDER;
+            else if (strcasecmp(arg_buf, "off") == 0)
+                engine->flags &= ~SOFTWARE_RENDER;
+            else
+            {
+                printf("set: raster can either be 'on' or 'off', not %s\n", arg_buf);
+                printf("Try 'set --help' for more information.\n");
+            }
+        }
+        else if (tryParseStrOptionArg(cmd, flag, &save_ptr, "-l", "--lod", arg_buf, arg_buf_size))
+        {
+            if (strcasecmp(arg_buf, "off") == 0)
+                engine->lod = RASTERIZER_LOD_OFF;
+            else if (strcasecmp(arg_buf, "splats") == 0)
+                engine->lod = RASTERIZER_LOD_SPLATS;
+            else if (strcasecmp(arg_buf, "heat") == 0)
+                engine->lod = RASTERIZER_LOD_HEAT_MAP;
+            else
+            {
+                printf("set: lod can either be 'off', 'splats' or 'heat', not %s\n", arg_buf);
+                printf("Try 'set --help' for more information.\n");
+            }
+        }
+        else if (tryParseFloatOptionArg(cmd, flag, &save_ptr, NULL, "--lod-radius", &float_arg))
+        {
+            if (float_arg >= 0)
+                engine->lod_radius = float_arg;
+            else
+            {
+                printf("set: lod-radius can't be negative, not %g\n", float_arg);
+                printf("Try 'set --help' for more information.\n");
+            }
+        }
+        else if (tryParseFloatOptionArg(cmd, flag, &save_ptr, "-z", "--zoom", &float_arg))
+        {
+            if (float_arg >= MIN_CAMERA_ZOOM && float_arg <= MAX_CAMERA_ZOOM)
+                engine->camera_zoom = float_arg;
+            else
+            {
+                printf("set: zoom must be between %g and %g, not %g\n", MIN_CAMERA_ZOOM, MAX_CAMERA_ZOOM, float_arg);
+                printf("Try 'set --help' for more information.\n");
+            }
+        }
+        else if (tryParseFloatOptionArg(cmd, flag, &save_ptr, NULL, "--view-x", &float_arg))
+            engine->camera_centre.x = float_arg;
+        else if (tryParseFloatOptionArg(cmd, flag, &save_ptr, NULL, "--view-y", &float_arg))
+            engine->camera_centre.y = float_arg;
+        else if (tryParseFloatOptionArg(cmd, flag, &save_ptr, NULL, "--buffer-zone", &float_arg))
+        {
+            if (float_arg >= 0)
+                engine->config.buffer_zone = float_arg;
+            else
+            {
+                printf("set: buffer-zone can't be negative, not %g\n", float_arg);
+                printf("Try 'set --help' for more information.\n");
+            }
+        }
         else if (strcasecmp(flag, "--help") == 0)
         {
             printf("Usage: set OPTION...\n"
@@ -617,7 +4275,27 @@ void handleSetCommand(ENGINE_2D *engine, char *input)
                    "\n"
                    "Mandatory arguments to long options are mandatory for short options too.\n"
                    "-e, --elasticity[=]{0|1}\tset collisions to be inelastic (0), or perfectly elastic (1)\n"
-                   "-g, --gravity STRING\tturn gravity 'on' or 'off'"
+                   "-g, --gravity STRING\tturn gravity 'on' or 'off'\n"
+                   "-c, --ccd STRING\tturn continuous collision detection 'on' or 'off'\n"
+                   "-s, --sleep STRING\tlet resting objects fall 'on' or 'off' to sleep\n"
+                   "-o, --order STRING\tkeep objects that are close in space close in memory 'on' or 'off'\n"
+                   "-b, --barnes-hut STRING\tapproximate gravity from distant groups of objects 'on' or 'off'\n"
+                   "-m, --multi-rate STRING\twith barnes-hut, pull on objects far from the view less often 'on' or 'off'\n"
+                   "\t--far-interval NUM\tpull on far objects every NUM frames with multi-rate on\n"
+                   "-d, --diagnostics STRING\tkeep track of energy, momentum and the centre of mass 'on' or 'off'\n"
+                   "\t--drift-limit NUM\twith diagnostics on, act once energy drifts by more than the fraction NUM, never if NUM is 0\n"
+                   "\t--drift-action STRING\tprint an 'alert' or halve 'dt' once energy drifts past the limit\n"
+                   "\t--softening STRING\tsoften gravity near objects 'off', as 'plummer' spheres or with a 'spline' kernel\n"
+                   "\t--softening-length NUM\tsoften gravity within about NUM units of an object's centre\n"
+                   "\t--close-gap NUM\tfollow the orbits of pairs passing within NUM units of touching through the step, never if NUM is 0\n"
+                   "-n, --neighbours STRING\treuse the pairs of nearby objects across frames 'on' or 'off'\n"
+                   "-r, --raster STRING\tdraw objects on the CPU into a single texture 'on' or 'off'\n"
+                   "-l, --lod STRING\tdraw small objects whole 'off', as single pixel 'splats', or as a density 'heat' map\n"
+                   "\t--lod-radius NUM\tapply the lod to objects narrower than NUM pixels, all of them if NUM is large enough\n"
+                   "-z, --zoom NUM\tdraw the world at NUM pixels per unit, keeping the centre of the view where it is\n"
+                   "\t--view-x NUM\tcentre the view on the world x coordinate NUM\n"
+                   "\t--view-y NUM\tcentre the view on the world y coordinate NUM\n"
+                   "\t--buffer-zone NUM\twithout a bounding box, remove objects NUM units past the edges of the world, never if NUM is 'inf'\n"
                    "\t--help\tdisplay this help and exit\n");
         }
         else
@@ -635,8 +4313,9 @@ void handleSetCommand(ENGINE_2D *engine, char *input)
 
 void handlePauseCommand(ENGINE_2D *engine, char *input)
 {
-    strtok(input, DELIM); // skip the command
-    char *flag = strtok(NULL, DELIM);
+    char *save_ptr;
+    strtok_r(input, DELIM, &save_ptr); // skip the command
+    char *flag = strtok_r(NULL, DELIM, &save_ptr);
     if (flag == NULL)
         engine->flags |= PAUSED;
     else if (strcasecmp(flag, "--help") == 0)
@@ -653,10 +4332,49 @@ void handlePauseCommand(ENGINE_2D *engine, char *input)
     }
 }
 
+void handleStatsCommand(ENGINE_2D *engine, char *input)
+{
+    char *save_ptr;
+    strtok_r(input, DELIM, &save_ptr); // skip the command
+    char *flag = strtok_r(NULL, DELIM, &save_ptr);
+    if (flag != NULL)
+    {
+        if (strcasecmp(flag, "--help") == 0)
+        {
+            printf("Usage: stats [OPTION]\n"
+                   "Print the energy, momentum and centre of mass as of the last step taken with diagnostics on.\n"
+                   "\n"
+                   "\t--help\tdisplay this help and exit\n");
+        }
+        else
+        {
+            printf("stats: invalid option -- '%s'\n", flag);
+            printf("Try 'stats --help' for more information.\n");
+        }
+        return;
+    }
+    SDL_LockMutex(engine->shared_state_mutex);
+    ENGINE_2D_DIAGNOSTICS diagnostics = engine->diagnostics;
+    SDL_bool is_on = (engine->flags & DIAGNOSTICS) != 0;
+    SDL_UnlockMutex(engine->shared_state_mutex);
+    if (!is_on)
+    {
+        printf("stats: diagnostics are off, turn them on with 'set --diagnostics on'\n");
+        return;
+    }
+    printf("frame %d, %d bodies of total mass %g\n", diagnostics.frame, diagnostics.bodies, diagnostics.mass);
+    printf("energy: kinetic %g, potential %g, total %g, drifted by %.3g%% since frame %d\n", diagnostics.kinetic_energy,
+           diagnostics.potential_energy, diagnostics.kinetic_energy + diagnostics.potential_energy,
+           100 * diagnostics.energy_drift, diagnostics.reference_frame);
+    printf("momentum: (%g, %g), angular %g\n", diagnostics.momentum.x, diagnostics.momentum.y, diagnostics.angular_momentum);
+    printf("centre of mass: (%g, %g)\n", diagnostics.centre_of_mass.x, diagnostics.centre_of_mass.y);
+}
+
 void handleResumeCommand(ENGINE_2D *engine, char *input)
 {
-    strtok(input, DELIM); // skip the command
-    char *flag = strtok(NULL, DELIM);
+    char *save_ptr;
+    strtok_r(input, DELIM, &save_ptr); // skip the command
+    char *flag = strtok_r(NULL, DELIM, &save_ptr);
     if (flag == NULL)
         engine->flags &= ~PAUSED;
     else if (strcasecmp(flag, "--help") == 0)
@@ -673,24 +4391,115 @@ void handleResumeCommand(ENGINE_2D *engine, char *input)
     }
 }
 
-CIRCLE_OBJ *findCircleById(OBJECT_ARRAY *objects, int id)
+void handleStepCommand(ENGINE_2D *engine, char *input)
 {
-    for (int i = 0; i < objects->size; i++)
+    char *save_ptr;
+    strtok_r(input, DELIM, &save_ptr); // skip the command
+    char *flag = strtok_r(NULL, DELIM, &save_ptr);
+    int num_frames = 1;
+    if (flag != NULL && strcasecmp(flag, "--help") == 0)
+    {
+        printf("Usage: step [NUM]\n"
+               "Advance the paused simulation by NUM frames (default: 1).\n"
+               "\n"
+               "\t--help\tdisplay this help and exit\n");
+    }
+    else if (flag != NULL && (sscanf(flag, "%d", &num_frames) != 1 || num_frames <= 0))
+    {
+        printf("step: invalid number of frames: '%s'\n", flag);
+        printf("Try 'step --help' for more information.\n");
+    }
+    else
     {
-        if (objects->data[i].id == id)
-            return objects->data + i;
+        SDL_LockMutex(engine->shared_state_mutex);
+        if (engine->flags & PAUSED)
+            engine->pending_steps += num_frames;
+        else
+            printf("step: the simulation is not paused\n");
+        SDL_UnlockMutex(engine->shared_state_mutex);
+    }
+}
+
+void handleRewindCommand(ENGINE_2D *engine, char *input)
+{
+    char *save_ptr;
+    strtok_r(input, DELIM, &save_ptr); // skip the command
+    char *flag = strtok_r(NULL, DELIM, &save_ptr);
+    int num_frames;
+    if (flag == NULL)
+    {
+        printf("Usage: rewind NUM\n"
+               "Try 'rewind --help' for more information.\n");
+    }
+    else if (strcasecmp(flag, "--help") == 0)
+    {
+        printf("Usage: rewind NUM\n"
+               "Go back NUM frames and continue from there, forgetting the frames after it.\n"
+               "Frames between keyframes are restored to within 1/%d of a pixel.\n"
+               "\n"
+               "\t--help\tdisplay this help and exit\n",
+               (int)HISTORY_POSITION_SCALE);
+    }
+    else if (sscanf(flag, "%d", &num_frames) != 1 || num_frames < 0)
+    {
+        printf("rewind: invalid number of frames: '%s'\n", flag);
+        printf("Try 'rewind --help' for more information.\n");
+    }
+    else
+    {
+        SDL_LockMutex(engine->shared_state_mutex);
+        if (engine->config.history_budget == 0)
+            printf("rewind: no history is kept for this simulation\n");
+        else if (engine->record_file != NULL || engine->replay_file != NULL)
+            printf("rewind: not available while a session is recorded or replayed\n");
+        else if (!rewindHistory(engine, num_frames))
+        {
+            printf("rewind: only %d frames of history are kept\n", engine->frame - History_OldestFrame(engine->history, engine->frame));
+        }
+        SDL_UnlockMutex(engine->shared_state_mutex);
+    }
+}
+
+void handleSourceCommand(ENGINE_2D *engine, char *input)
+{
+    char *save_ptr;
+    strtok_r(input, DELIM, &save_ptr); // skip the command
+    char *path = strtok_r(NULL, DELIM, &save_ptr);
+    if (path == NULL)
+    {
+        printf("Usage: source FILE\n"
+               "Try 'source --help' for more information.\n");
+    }
+    else if (strcasecmp(path, "--help") == 0)
+    {
+        printf("Usage: source FILE\n"
+               "Run the commands in FILE, one per line, all between the same two frames.\n"
+               "Blank lines and lines starting with '#' are skipped.\n"
+               "\n"
+               "\t--help\tdisplay this help and exit\n");
     }
-    return NULL;
+    else
+        Engine2D_RunScript(engine, path);
+}
+
+CIRCLE_OBJ *findCircleById(OBJECT_ARRAY *objects, int id)
+{
+    if (id < 0 || id >= objects->id_cap)
+        return NULL;
+    int slot = objects->slot_of_id[id];
+    if (slot < 0 || slot >= objects->size || objects->data[slot].id != id)
+        return NULL;
+    return objects->data + slot;
 }
 
-SDL_bool tryParseIntOptionArg(char *command_name, char *input_flag, char *short_option, char *long_option, int *p_arg_value)
+SDL_bool tryParseIntOptionArg(char *command_name, char *input_flag, char **save_ptr, char *short_option, char *long_option, int *p_arg_value)
 {
     if (short_option == NULL)
         short_option = long_option;
     SDL_bool parse_status = SDL_FALSE;
     if (strcasecmp(input_flag, short_option) == 0 || strcasecmp(input_flag, long_option) == 0)
     {
-        char *arg_str = strtok(NULL, DELIM);
+        char *arg_str = strtok_r(NULL, DELIM, save_ptr);
         if (arg_str == NULL)
         {
             printf("%s: option requires an argument -- '%s'\n", command_name, input_flag);
@@ -709,40 +4518,43 @@ SDL_bool tryParseIntOptionArg(char *command_name, char *input_flag, char *short_
     return parse_status;
 }
 
-SDL_bool tryParseFloatOptionArg(char *command_name, char *input_flag, char *short_option, char *long_option, double *p_arg_value)
+SDL_bool tryParseFloatOptionArg(char *command_name, char *input_flag, char **save_ptr, char *short_option, char *long_option, double *p_arg_value)
 {
     if (short_option == NULL)
         short_option = long_option;
     SDL_bool parse_status = SDL_FALSE;
     if (strcasecmp(input_flag, short_option) == 0 || strcasecmp(input_flag, long_option) == 0)
     {
-        char *arg_str = strtok(NULL, DELIM);
+        char *arg_str = strtok_r(NULL, DELIM, save_ptr), *arg_end = arg_str;
+        // strtod reads a number as sscanf would without setting up a stream for it, which adds up over a long script
+        double arg_value = arg_str != NULL ? strtod(arg_str, &arg_end) : 0;
         if (arg_str == NULL)
         {
             printf("%s: option requires an argument -- '%s'\n", command_name, input_flag);
             printf("Try '%s --help' for more information.\n", command_name);
         }
-        else if (sscanf(arg_str, "%lf", p_arg_value) != 1)
+        else if (arg_end == arg_str)
         {
             printf("%s: invalid value for %s: expected float, got '%s'\n", command_name, input_flag, arg_str);
             printf("Try '%s --help' for more information.\n", command_name);
         }
         else
         {
+            *p_arg_value = arg_value;
             parse_status = SDL_TRUE;
         }
     }
     return parse_status;
 }
 
-SDL_bool tryParseCharOptionArg(char *command_name, char *input_flag, char *short_option, char *long_option, char *p_arg_value)
+SDL_bool tryParseCharOptionArg(char *command_name, char *input_flag, char **save_ptr, char *short_option, char *long_option, char *p_arg_value)
 {
     if (short_option == NULL)
         short_option = long_option;
     SDL_bool parse_status = SDL_FALSE;
     if (strcasecmp(input_flag, short_option) == 0 || strcasecmp(input_flag, long_option) == 0)
     {
-        char *arg_str = strtok(NULL, DELIM);
+        char *arg_str = strtok_r(NULL, DELIM, save_ptr);
         if (arg_str == NULL)
         {
             printf("%s: option requires an argument -- '%s'\n", command_name, input_flag);
@@ -761,14 +4573,14 @@ SDL_bool tryParseCharOptionArg(char *command_name, char *input_flag, char *short
     return parse_status;
 }
 
-SDL_bool tryParseStrOptionArg(char *command_name, char *input_flag, char *short_option, char *long_option, char *buffer, int buf_size)
+SDL_bool tryParseStrOptionArg(char *command_name, char *input_flag, char **save_ptr, char *short_option, char *long_option, char *buffer, int buf_size)
 {
     if (short_option == NULL)
         short_option = long_option;
     SDL_bool parse_status = SDL_FALSE;
     if (strcasecmp(input_flag, short_option) == 0 || strcasecmp(input_flag, long_option) == 0)
     {
-        char *arg = strtok(NULL, DELIM);
+        char *arg = strtok_r(NULL, DELIM, save_ptr);
         if (arg == NULL)
         {
             printf("%s: option requires an argument -- '%s'\n", command_name, input_flag);
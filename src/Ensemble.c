@@ -0,0 +1,367 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Ensemble.h"
+#include "Engine2D.h"
+#include "ThreadPool.h"
+#include "Random.h"
+
+#define WORLD_WIDTH 1280
+#define WORLD_HEIGHT 720
+#define MIN_RADIUS 8
+#define MAX_RADIUS 16
+#define DEFAULT_SPEED 196
+#define DEFAULT_FRAMES 300
+#define DEFAULT_FPS 30
+#define DEFAULT_DT (1.0 / DEFAULT_FPS)
+#define DEFAULT_BODIES 48
+#define MAX_PARAM_VALUES 64
+#define MAX_MEMBERS 65536
+#define LIST_BUFFER_SIZE 256
+#define LIST_DELIM ","
+
+typedef struct
+{
+    double values[MAX_PARAM_VALUES];
+    int count;
+} PARAM_LIST;
+
+// everything a member shares with the rest of the ensemble, plus the values swept over
+typedef struct
+{
+    int frames;
+    SDL_bool walled;
+    double speed;
+    PARAM_LIST elasticity, gravity, dt, bodies, seed;
+} SCENARIO;
+
+typedef struct
+{
+    SDL_bool elastic, gravity;
+    double dt;
+    int bodies;
+    Uint32 seed;
+    double steps_per_sec;
+    ENGINE_2D_STATS stats;
+} ENSEMBLE_MEMBER;
+
+typedef struct
+{
+    const SCENARIO *scenario;
+    ENSEMBLE_MEMBER *members;
+} ENSEMBLE_RUN;
+
+int parseNumberList(const char *option, const char *str, PARAM_LIST *list, SDL_bool integral);
+int parseSwitchList(const char *option, const char *str, PARAM_LIST *list);
+int expandMembers(const SCENARIO *scenario, ENSEMBLE_MEMBER **members);
+void runMemberRange(void *context, int begin, int end);
+void runMember(const SCENARIO *scenario, ENSEMBLE_MEMBER *member);
+void printEnsembleHelp();
+
+int Ensemble_Main(int argc, char *argv[])
+{
+    SCENARIO scenario = {
+        .frames = DEFAULT_FRAMES,
+        .walled = SDL_TRUE,
+        .speed = DEFAULT_SPEED,
+        .elasticity = {{1}, 1},
+        .gravity = {{0}, 1},
+        .dt = {{DEFAULT_DT}, 1},
+        .bodies = {{DEFAULT_BODIES}, 1},
+        .seed = {{1}, 1},
+    };
+    int jobs = SDL_GetCPUCount();
+
+    for (int i = 1; i < argc; i++)
+    {
+        char *flag = argv[i];
+        if (strcasecmp(flag, "--help") == 0)
+        {
+            printEnsembleHelp();
+            return 0;
+        }
+        if (i + 1 >= argc)
+        {
+            printf("ensemble: option requires an argument -- '%s'\n", flag);
+            printf("Try 'ensemble --help' for more information.\n");
+            return 1;
+        }
+        char *arg = argv[++i];
+        int status = 0;
+        if (strcasecmp(flag, "-e") == 0 || strcasecmp(flag, "--elasticity") == 0)
+        {
+            status = parseNumberList(flag, arg, &scenario.elasticity, SDL_TRUE);
+            for (int k = 0; status == 0 && k < scenario.elasticity.count; k++)
+            {
+                if (scenario.elasticity.values[k] != 0 && scenario.elasticity.values[k] != 1)
+                {
+                    printf("ensemble: elasticity can either be 0 or 1, not %g\n", scenario.elasticity.values[k]);
+                    status = 1;
+                }
+            }
+        }
+        else if (strcasecmp(flag, "-g") == 0 || strcasecmp(flag, "--gravity") == 0)
+            status = parseSwitchList(flag, arg, &scenario.gravity);
+        else if (strcasecmp(flag, "-t") == 0 || strcasecmp(flag, "--dt") == 0)
+            status = parseNumberList(flag, arg, &scenario.dt, SDL_FALSE);
+        else if (strcasecmp(flag, "-n") == 0 || strcasecmp(flag, "--bodies") == 0)
+            status = parseNumberList(flag, arg, &scenario.bodies, SDL_TRUE);
+        else if (strcasecmp(flag, "-s") == 0 || strcasecmp(flag, "--seed") == 0)
+            status = parseNumberList(flag, arg, &scenario.seed, SDL_TRUE);
+        else if (strcasecmp(flag, "-f") == 0 || strcasecmp(flag, "--frames") == 0)
+        {
+            if (sscanf(arg, "%d", &scenario.frames) != 1 || scenario.frames <= 0)
+            {
+                printf("ensemble: invalid value for %s: expected positive integer, got '%s'\n", flag, arg);
+                status = 1;
+            }
+        }
+        else if (strcasecmp(flag, "-j") == 0 || strcasecmp(flag, "--jobs") == 0)
+        {
+            if (sscanf(arg, "%d", &jobs) != 1 || jobs <= 0)
+            {
+                printf("ensemble: invalid value for %s: expected positive integer, got '%s'\n", flag, arg);
+                status = 1;
+            }
+        }
+        else if (strcasecmp(flag, "-w") == 0 || strcasecmp(flag, "--walls") == 0)
+        {
+            if (strcasecmp(arg, "on") == 0)
+                scenario.walled = SDL_TRUE;
+            else if (strcasecmp(arg, "off") == 0)
+                scenario.walled = SDL_FALSE;
+            else
+            {
+                printf("ensemble: invalid value for %s: expected 'on' or 'off', got '%s'\n", flag, arg);
+                status = 1;
+            }
+        }
+        else if (strcasecmp(flag, "-v") == 0 || strcasecmp(flag, "--speed") == 0)
+        {
+            if (sscanf(arg, "%lf", &scenario.speed) != 1 || scenario.speed < 0)
+            {
+                printf("ensemble: invalid value for %s: expected non-negative number, got '%s'\n", flag, arg);
+                status = 1;
+            }
+        }
+        else
+        {
+            printf("ensemble: invalid option -- '%s'\n", flag);
+            status = 1;
+        }
+        if (status != 0)
+        {
+            printf("Try 'ensemble --help' for more information.\n");
+            return 1;
+        }
+    }
+
+    ENSEMBLE_MEMBER *members = NULL;
+    int num_members = expandMembers(&scenario, &members);
+    if (num_members < 0)
+    {
+        printf("ensemble: more than %d members requested\n", MAX_MEMBERS);
+        printf("Try 'ensemble --help' for more information.\n");
+        return 1;
+    }
+
+    // every member steps on a single thread, so at most 'jobs' engines are alive at any time
+    THREAD_POOL *pool = ThreadPool_Init(jobs);
+    ENSEMBLE_RUN run = {&scenario, members};
+    Uint64 start = SDL_GetPerformanceCounter();
+    ThreadPool_ParallelFor(pool, num_members, 1, runMemberRange, &run);
+    double elapsed = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+    ThreadPool_Free(pool);
+
+    printf("member\telastic\tgravity\tdt\tbodies\tseed\tsteps/s\tmerges\tbodies left\tenergy\n");
+    for (int m = 0; m < num_members; m++)
+    {
+        ENSEMBLE_MEMBER *member = members + m;
+        printf("%d\t%d\t%s\t%.5lf\t%d\t%u\t%.1lf\t%d\t%d\t%.6e\n",
+               m, member->elastic, member->gravity ? "on" : "off", member->dt, member->bodies, member->seed,
+               member->steps_per_sec, member->stats.merges, member->stats.bodies,
+               member->stats.kinetic_energy + member->stats.potential_energy);
+    }
+    printf("%d members, %d frames each, %d jobs, %.2lf s\n", num_members, scenario.frames, jobs, elapsed);
+    free(members);
+    return 0;
+}
+
+// accepts comma-separated numbers; integral lists take values of 0 and up and also inclusive ranges such as 1-8
+int parseNumberList(const char *option, const char *str, PARAM_LIST *list, SDL_bool integral)
+{
+    char buffer[LIST_BUFFER_SIZE];
+    SDL_strlcpy(buffer, str, sizeof(buffer));
+    list->count = 0;
+    for (char *token = strtok(buffer, LIST_DELIM); token != NULL; token = strtok(NULL, LIST_DELIM))
+    {
+        int first, last;
+        double value;
+        char extra;
+        if (!integral)
+        {
+            if (sscanf(token, "%lf%c", &value, &extra) != 1 || value <= 0)
+            {
+                printf("ensemble: invalid value for %s: '%s'\n", option, token);
+                return 1;
+            }
+            first = last = 0;
+        }
+        else if (sscanf(token, "%d-%d%c", &first, &last, &extra) != 2 || first > last)
+        {
+            if (sscanf(token, "%d%c", &first, &extra) != 1)
+            {
+                printf("ensemble: invalid value for %s: '%s'\n", option, token);
+                return 1;
+            }
+            last = first;
+        }
+        if (integral && first < 0)
+        {
+            printf("ensemble: invalid value for %s: expected non-negative integer, got '%s'\n", option, token);
+            return 1;
+        }
+        if ((long long)last - first + 1 > MAX_PARAM_VALUES - list->count)
+        {
+            printf("ensemble: too many values for %s (max %d)\n", option, MAX_PARAM_VALUES);
+            return 1;
+        }
+        if (!integral)
+            list->values[list->count++] = value;
+        for (int v = first; integral && v <= last; v++)
+            list->values[list->count++] = v;
+    }
+    if (list->count == 0)
+    {
+        printf("ensemble: invalid value for %s: empty list\n", option);
+        return 1;
+    }
+    return 0;
+}
+
+int parseSwitchList(const char *option, const char *str, PARAM_LIST *list)
+{
+    char buffer[LIST_BUFFER_SIZE];
+    SDL_strlcpy(buffer, str, sizeof(buffer));
+    list->count = 0;
+    for (char *token = strtok(buffer, LIST_DELIM); token != NULL; token = strtok(NULL, LIST_DELIM))
+    {
+        if (list->count >= MAX_PARAM_VALUES)
+        {
+            printf("ensemble: too many values for %s (max %d)\n", option, MAX_PARAM_VALUES);
+            return 1;
+        }
+        if (strcasecmp(token, "on") == 0)
+            list->values[list->count++] = 1;
+        else if (strcasecmp(token, "off") == 0)
+            list->values[list->count++] = 0;
+        else
+        {
+            printf("ensemble: invalid value for %s: expected 'on' or 'off', got '%s'\n", option, token);
+            return 1;
+        }
+    }
+    if (list->count == 0)
+    {
+        printf("ensemble: invalid value for %s: empty list\n", option);
+        return 1;
+    }
+    return 0;
+}
+
+// fills one member per combination of the swept values, returns -1 if there would be too many
+int expandMembers(const SCENARIO *scenario, ENSEMBLE_MEMBER **members)
+{
+    long long count = (long long)scenario->elasticity.count * scenario->gravity.count * scenario->dt.count *
+                      scenario->bodies.count * scenario->seed.count;
+    if (count > MAX_MEMBERS)
+        return -1;
+    *members = (ENSEMBLE_MEMBER *)calloc(count, sizeof(ENSEMBLE_MEMBER));
+    int m = 0;
+    for (int e = 0; e < scenario->elasticity.count; e++)
+        for (int g = 0; g < scenario->gravity.count; g++)
+            for (int t = 0; t < scenario->dt.count; t++)
+                for (int n = 0; n < scenario->bodies.count; n++)
+                    for (int s = 0; s < scenario->seed.count; s++)
+                    {
+                        ENSEMBLE_MEMBER *member = *members + m++;
+                        member->elastic = scenario->elasticity.values[e] != 0;
+                        member->gravity = scenario->gravity.values[g] != 0;
+                        member->dt = scenario->dt.values[t];
+                        member->bodies = scenario->bodies.values[n];
+                        member->seed = scenario->seed.values[s];
+                    }
+    return m;
+}
+
+void runMemberRange(void *context, int begin, int end)
+{
+    ENSEMBLE_RUN *run = (ENSEMBLE_RUN *)context;
+    for (int m = begin; m < end; m++)
+        runMember(run->scenario, run->members + m);
+}
+
+void runMember(const SCENARIO *scenario, ENSEMBLE_MEMBER *member)
+{
+    ENGINE_2D_CONFIG config = Engine2D_DefaultConfig();
+    config.world_width = WORLD_WIDTH;
+    config.world_height = WORLD_HEIGHT;
+    config.num_threads = 1;
+    int flags = (member->elastic ? ELASTIC_COLLISION : 0) |
+                (member->gravity ? ENABLE_GRAVITY : 0) |
+                (scenario->walled ? BOUNDING_BOX : 0);
+    SDL_mutex *mutex = SDL_CreateMutex();
+    ENGINE_2D *engine = Engine2D_InitWithConfig(config, NULL, mutex, NULL, DEFAULT_FPS, flags);
+    Engine2D_SetTimeStep(engine, member->dt);
+
+    RANDOM rng;
+    Random_Seed(&rng, member->seed);
+    for (int i = 0; i < member->bodies; i++)
+    {
+        double radius = Random_Range(&rng, MIN_RADIUS, MAX_RADIUS);
+        PHYS_BODY phys_comp = {
+            .mass = M_PI * radius * radius * config.density,
+            .pos = {
+                .x = Random_Unit(&rng) * WORLD_WIDTH,
+                .y = Random_Unit(&rng) * WORLD_HEIGHT,
+            },
+            .vel = {
+                .x = (2 * Random_Unit(&rng) - 1) * scenario->speed,
+                .y = (2 * Random_Unit(&rng) - 1) * scenario->speed,
+            },
+        };
+        Engine2D_CreateCircleObject(engine, RGB_WHITE, radius, phys_comp);
+    }
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int frame = 0; frame < scenario->frames; frame++)
+        Engine2D_RunSimulation(engine);
+    double elapsed = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+    member->steps_per_sec = elapsed > 0 ? scenario->frames / elapsed : 0;
+    member->stats = Engine2D_GetStats(engine);
+
+    Engine2D_Free(engine);
+    SDL_DestroyMutex(mutex);
+}
+
+void printEnsembleHelp()
+{
+    printf("Usage: ensemble [OPTION]...\n"
+           "Run every combination of the given parameters headless, several members at a time,\n"
+           "and print step throughput, merge count and final energy for each member.\n"
+           "LIST is a comma-separated list of values, e.g. '0,1'; integer lists also take ranges, e.g. '1-8'.\n"
+           "\n"
+           "-e, --elasticity LIST\telasticities to run, each either 0 or 1 (default 1)\n"
+           "-g, --gravity LIST\tgravity settings to run, each either 'on' or 'off' (default off)\n"
+           "-t, --dt LIST\t\ttime steps in seconds (default 1/30)\n"
+           "-n, --bodies LIST\tnumbers of bodies (default %d)\n"
+           "-s, --seed LIST\t\tseeds for the initial positions and velocities (default 1)\n"
+           "-f, --frames NUM\tnumber of steps per member (default %d)\n"
+           "-w, --walls STRING\tkeep bodies inside the world 'on' or 'off' (default on)\n"
+           "-v, --speed NUM\t\tlargest initial speed along each axis (default %d)\n"
+           "-j, --jobs NUM\t\tnumber of members to run at once (default: one per CPU)\n"
+           "\t--help\t\tdisplay this help and exit\n",
+           DEFAULT_BODIES, DEFAULT_FRAMES, DEFAULT_SPEED);
+}
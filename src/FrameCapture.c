@@ -0,0 +1,202 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "FrameCapture.h"
+
+struct FRAME_CAPTURE
+{
+    FILE *file;
+    SDL_bool is_pipe;
+    int policy;
+    SDL_Thread *writer;
+    SDL_mutex *mutex;
+    SDL_cond *frame_ready, *buffer_free;
+    // frames waiting to be written are buffers[(head + q) % num_buffers] for q < queued, the first of them possibly
+    // being written right now; the buffer after the last of them is the one handed out next
+    uint32_t **buffers;
+    int num_buffers, head, queued;
+    // every frame has the size of the first one, which is when the buffers are allocated
+    int width, height;
+    // the writer's RGB24 copy of the frame it is writing
+    unsigned char *rgb;
+    SDL_bool closing, failed;
+    int frames_written, frames_dropped;
+};
+
+int SDLCALL writerLoop(void *data);
+SDL_bool allocateCaptureBuffers(FRAME_CAPTURE *capture, int width, int height);
+void writeFrame(FRAME_CAPTURE *capture, const uint32_t *pixels);
+
+FRAME_CAPTURE *FrameCapture_Open(const char *path, int num_buffers, int policy)
+{
+    FRAME_CAPTURE *capture = (FRAME_CAPTURE *)calloc(1, sizeof(FRAME_CAPTURE));
+    if (capture == NULL)
+    {
+        fprintf(stderr, "ALLOCATION FAILED in %s\n", __func__);
+        return NULL;
+    }
+    capture->is_pipe = path[0] == '|';
+    capture->file = capture->is_pipe ? popen(path + 1, "w") : fopen(path, "wb");
+    if (capture->file == NULL)
+    {
+        fprintf(stderr, "capture: cannot open '%s'\n", path);
+        free(capture);
+        return NULL;
+    }
+    capture->policy = policy;
+    capture->num_buffers = SDL_max(num_buffers, 1);
+    capture->mutex = SDL_CreateMutex();
+    capture->frame_ready = SDL_CreateCond();
+    capture->buffer_free = SDL_CreateCond();
+    capture->writer = SDL_CreateThread(writerLoop, "capture writer", capture);
+    if (capture->writer == NULL)
+    {
+        fprintf(stderr, "THREAD CREATION FAILED in %s: %s\n", __func__, SDL_GetError());
+        capture->failed = SDL_TRUE;
+        FrameCapture_Close(capture);
+        return NULL;
+    }
+    return capture;
+}
+
+// under the throttle policy, waits until the writer has a buffer free for the next frame; to be called before taking
+// any lock the frame is drawn under, so that only drawing waits on the writer
+void FrameCapture_WaitForBuffer(FRAME_CAPTURE *capture)
+{
+    if (capture->policy != FRAME_CAPTURE_THROTTLE)
+        return;
+    SDL_LockMutex(capture->mutex);
+    while (capture->queued == capture->num_buffers && !capture->failed)
+        SDL_CondWait(capture->buffer_free, capture->mutex);
+    SDL_UnlockMutex(capture->mutex);
+}
+
+// a buffer of width * height pixels, packed row after row, to draw or copy the next frame into and then submit; NULL
+// when the frame is dropped, because it isn't the size of the first one or because no buffer is free
+uint32_t *FrameCapture_Acquire(FRAME_CAPTURE *capture, int width, int height)
+{
+    SDL_LockMutex(capture->mutex);
+    if (capture->buffers == NULL && !capture->failed && !allocateCaptureBuffers(capture, width, height))
+        capture->failed = SDL_TRUE;
+    uint32_t *buffer = NULL;
+    if (!capture->failed && width == capture->width && height == capture->height && capture->queued < capture->num_buffers)
+        buffer = capture->buffers[(capture->head + capture->queued) % capture->num_buffers];
+    else
+        capture->frames_dropped++;
+    SDL_UnlockMutex(capture->mutex);
+    return buffer;
+}
+
+// queues the buffer handed out by the last FrameCapture_Acquire; one that is never submitted is handed out again
+void FrameCapture_Submit(FRAME_CAPTURE *capture)
+{
+    SDL_LockMutex(capture->mutex);
+    capture->queued++;
+    SDL_CondSignal(capture->frame_ready);
+    SDL_UnlockMutex(capture->mutex);
+}
+
+// writes out the frames still queued before closing the file or waiting for the command to exit
+FRAME_CAPTURE_STATS FrameCapture_Close(FRAME_CAPTURE *capture)
+{
+    SDL_LockMutex(capture->mutex);
+    capture->closing = SDL_TRUE;
+    SDL_CondSignal(capture->frame_ready);
+    SDL_UnlockMutex(capture->mutex);
+    if (capture->writer != NULL)
+        SDL_WaitThread(capture->writer, NULL);
+    int status = capture->is_pipe ? pclose(capture->file) : fclose(capture->file);
+    FRAME_CAPTURE_STATS stats = {
+        .frames_written = capture->frames_written,
+        .frames_dropped = capture->frames_dropped,
+        .width = capture->width,
+        .height = capture->height,
+        .failed = capture->failed || status != 0,
+    };
+    for (int b = 0; capture->buffers != NULL && b < capture->num_buffers; b++)
+        free(capture->buffers[b]);
+    free(capture->buffers);
+    free(capture->rgb);
+    SDL_DestroyCond(capture->frame_ready);
+    SDL_DestroyCond(capture->buffer_free);
+    SDL_DestroyMutex(capture->mutex);
+    free(capture);
+    return stats;
+}
+
+int SDLCALL writerLoop(void *data)
+{
+    FRAME_CAPTURE *capture = (FRAME_CAPTURE *)data;
+    SDL_LockMutex(capture->mutex);
+    while (SDL_TRUE)
+    {
+        while (capture->queued == 0 && !capture->closing)
+            SDL_CondWait(capture->frame_ready, capture->mutex);
+        if (capture->queued == 0)
+            break;
+        const uint32_t *pixels = capture->buffers[capture->head];
+        SDL_bool failed = capture->failed;
+        SDL_UnlockMutex(capture->mutex);
+
+        // the buffer stays queued while it is written, so it isn't handed out again underneath the writer
+        if (!failed)
+            writeFrame(capture, pixels);
+
+        SDL_LockMutex(capture->mutex);
+        capture->head = (capture->head + 1) % capture->num_buffers;
+        capture->queued--;
+        SDL_CondSignal(capture->buffer_free);
+    }
+    SDL_UnlockMutex(capture->mutex);
+    return 0;
+}
+
+SDL_bool allocateCaptureBuffers(FRAME_CAPTURE *capture, int width, int height)
+{
+    if (width <= 0 || height <= 0)
+        return SDL_FALSE;
+    capture->buffers = (uint32_t **)calloc(capture->num_buffers, sizeof(uint32_t *));
+    capture->rgb = (unsigned char *)malloc((size_t)width * height * 3);
+    if (capture->buffers == NULL || capture->rgb == NULL)
+    {
+        fprintf(stderr, "ALLOCATION FAILED in %s\n", __func__);
+        return SDL_FALSE;
+    }
+    for (int b = 0; b < capture->num_buffers; b++)
+    {
+        capture->buffers[b] = (uint32_t *)malloc((size_t)width * height * sizeof(uint32_t));
+        if (capture->buffers[b] == NULL)
+        {
+            fprintf(stderr, "ALLOCATION FAILED in %s\n", __func__);
+            return SDL_FALSE;
+        }
+    }
+    capture->width = width;
+    capture->height = height;
+    return SDL_TRUE;
+}
+
+// converts to RGB24 on the writer's thread, which keeps the copy made while drawing down to a plain memcpy
+void writeFrame(FRAME_CAPTURE *capture, const uint32_t *pixels)
+{
+    size_t num_pixels = (size_t)capture->width * capture->height;
+    unsigned char *rgb = capture->rgb;
+    for (size_t p = 0; p < num_pixels; p++)
+    {
+        rgb[3 * p] = pixels[p] >> 16;
+        rgb[3 * p + 1] = pixels[p] >> 8;
+        rgb[3 * p + 2] = pixels[p];
+    }
+    SDL_bool failed = fwrite(rgb, 3, num_pixels, capture->file) != num_pixels;
+    SDL_LockMutex(capture->mutex);
+    if (failed && !capture->failed)
+    {
+        fprintf(stderr, "capture: write failed after %d frames\n", capture->frames_written);
+        capture->failed = SDL_TRUE;
+        // a throttled frame waiting on the writer would otherwise wait forever
+        SDL_CondSignal(capture->buffer_free);
+    }
+    else if (!failed)
+        capture->frames_written++;
+    SDL_UnlockMutex(capture->mutex);
+}
@@ -0,0 +1,393 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "History.h"
+
+// low bits of a delta entry: 0-8 encode a position nudge of -1..1 on each axis, or one of these
+#define HISTORY_ENTRY_RESIDUALS 9
+#define HISTORY_ENTRY_WHOLE 10
+#define HISTORY_ENTRY_BITS 4
+
+// a keyframe followed by the deltas of the frames after it, each record starting at offsets[frame - first_frame]
+typedef struct
+{
+    int first_frame, num_frames;
+    size_t *offsets;
+    int offsets_cap;
+    unsigned char *data;
+    size_t size, cap;
+} HISTORY_SEGMENT;
+
+// oldest segment first
+struct HISTORY
+{
+    HISTORY_LAYOUT layout;
+    size_t budget;
+    int keyframe_interval;
+    HISTORY_SEGMENT *segments;
+    int count, cap;
+    size_t bytes;
+    // the last captured frame exactly as decoding the history reproduces it
+    unsigned char *shadow;
+    int shadow_size, shadow_cap;
+    // set when the bodies were shuffled, which would make every body in the next delta a whole one
+    SDL_bool needs_keyframe;
+};
+
+SDL_bool beginHistorySegment(HISTORY *history, int frame);
+void appendHistoryFrame(HISTORY *history, int next_id, double dt, const unsigned char *records, int count);
+void dropOldestHistorySegment(HISTORY *history);
+void writeHistoryBytes(HISTORY *history, HISTORY_SEGMENT *segment, const void *bytes, size_t size);
+void writeHistoryVarint(HISTORY *history, HISTORY_SEGMENT *segment, uint64_t value);
+uint64_t readHistoryVarint(const unsigned char **cursor);
+PHYS_BODY *motionOf(const HISTORY *history, const unsigned char *records, int i);
+void predictMotion(const PHYS_BODY *phys, double dt, long long *quantized);
+void applyMotionResiduals(PHYS_BODY *phys, double dt, const long long *residuals);
+void reserveHistoryShadow(HISTORY *history, int cap);
+void decodeHistoryKeyframe(HISTORY *history, int *next_id, const unsigned char **cursor);
+void decodeHistoryDelta(HISTORY *history, int *next_id, const unsigned char **cursor);
+
+// keeps nothing with a budget of 0
+HISTORY *History_Init(HISTORY_LAYOUT layout, size_t budget, int keyframe_interval)
+{
+    HISTORY *history = (HISTORY *)calloc(1, sizeof(HISTORY));
+    if (history == NULL)
+    {
+        fprintf(stderr, "ALLOCATION FAILED in %s\n", __func__);
+        return NULL;
+    }
+    history->layout = layout;
+    history->budget = budget;
+    history->keyframe_interval = keyframe_interval;
+    return history;
+}
+
+// records the bodies as they are at the end of frame, dt after the frame captured before it
+void History_Capture(HISTORY *history, int frame, int next_id, double dt, const void *records, int count)
+{
+    if (history->budget == 0)
+        return;
+    HISTORY_SEGMENT *current = history->count > 0 ? history->segments + history->count - 1 : NULL;
+    // a segment on its own over budget is cut short, so the next one can replace it
+    if (current == NULL || current->num_frames >= history->keyframe_interval || history->needs_keyframe ||
+        (history->count == 1 && history->bytes > history->budget))
+    {
+        if (!beginHistorySegment(history, frame))
+            return;
+        history->needs_keyframe = SDL_FALSE;
+    }
+    appendHistoryFrame(history, next_id, dt, (const unsigned char *)records, count);
+    while (history->count > 1 && history->bytes > history->budget)
+        dropOldestHistorySegment(history);
+}
+
+// starts a new segment with the next frame captured, for when the bodies were reordered
+void History_RequestKeyframe(HISTORY *history)
+{
+    history->needs_keyframe = SDL_TRUE;
+}
+
+// the bodies as they were at the end of frame, NULL if that frame isn't kept; everything after it is forgotten
+const void *History_Rewind(HISTORY *history, int frame, int *count, int *next_id)
+{
+    int s = history->count - 1;
+    while (s >= 0 && history->segments[s].first_frame > frame)
+        s--;
+    if (s < 0 || frame >= history->segments[s].first_frame + history->segments[s].num_frames)
+        return NULL;
+
+    HISTORY_SEGMENT *segment = history->segments + s;
+    int kept_frames = frame - segment->first_frame + 1;
+    const unsigned char *cursor = segment->data;
+    decodeHistoryKeyframe(history, next_id, &cursor);
+    for (int f = 1; f < kept_frames; f++)
+        decodeHistoryDelta(history, next_id, &cursor);
+
+    while (history->count > s + 1)
+    {
+        HISTORY_SEGMENT *newest = history->segments + --history->count;
+        history->bytes -= newest->cap + newest->offsets_cap * sizeof(size_t);
+        free(newest->data);
+        free(newest->offsets);
+    }
+    if (kept_frames < segment->num_frames)
+        segment->size = segment->offsets[kept_frames];
+    segment->num_frames = kept_frames;
+    *count = history->shadow_size;
+    return history->shadow;
+}
+
+// the first frame kept, frame itself when none is
+int History_OldestFrame(const HISTORY *history, int frame)
+{
+    return history->count > 0 ? history->segments[0].first_frame : frame;
+}
+
+void History_Free(HISTORY *history)
+{
+    if (history == NULL)
+        return;
+    while (history->count > 0)
+        dropOldestHistorySegment(history);
+    free(history->segments);
+    free(history->shadow);
+    free(history);
+}
+
+SDL_bool beginHistorySegment(HISTORY *history, int frame)
+{
+    if (history->count >= history->cap)
+    {
+        int cap = history->cap > 0 ? history->cap * 2 : 8;
+        HISTORY_SEGMENT *temp = (HISTORY_SEGMENT *)realloc(history->segments, cap * sizeof(HISTORY_SEGMENT));
+        if (temp == NULL)
+        {
+            fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+            return SDL_FALSE;
+        }
+        history->cap = cap;
+        history->segments = temp;
+    }
+    history->segments[history->count++] = (HISTORY_SEGMENT){.first_frame = frame};
+    return SDL_TRUE;
+}
+
+// writes the frame to the newest segment; the segment's first frame is written as a keyframe
+void appendHistoryFrame(HISTORY *history, int next_id, double dt, const unsigned char *records, int count)
+{
+    HISTORY_SEGMENT *segment = history->segments + history->count - 1;
+    size_t record_size = history->layout.record_size;
+    if (segment->num_frames >= segment->offsets_cap)
+    {
+        int cap = segment->offsets_cap > 0 ? segment->offsets_cap * 2 : 64;
+        size_t *temp = (size_t *)realloc(segment->offsets, cap * sizeof(size_t));
+        if (temp == NULL)
+        {
+            fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+            return;
+        }
+        history->bytes += (cap - segment->offsets_cap) * sizeof(size_t);
+        segment->offsets_cap = cap;
+        segment->offsets = temp;
+    }
+    size_t offset = segment->size;
+    segment->offsets[segment->num_frames] = offset;
+
+    if (segment->num_frames == 0)
+    {
+        writeHistoryVarint(history, segment, next_id);
+        writeHistoryVarint(history, segment, count);
+        writeHistoryBytes(history, segment, records, count * record_size);
+    }
+    else
+    {
+        writeHistoryBytes(history, segment, &dt, sizeof(double));
+        writeHistoryVarint(history, segment, next_id);
+        writeHistoryVarint(history, segment, count);
+        // each entry is a run of bodies that moved exactly as predicted followed by the body after it,
+        // which is stored whole, as motion residuals, or, most often, as a nudge of its predicted position
+        int run = 0;
+        for (int i = 0; i < count; i++)
+        {
+            const unsigned char *record = records + i * record_size;
+            if (i >= history->shadow_size || !history->layout.same_apart_from_motion(record, history->shadow + i * record_size))
+            {
+                writeHistoryVarint(history, segment, (uint64_t)run << HISTORY_ENTRY_BITS | HISTORY_ENTRY_WHOLE);
+                writeHistoryBytes(history, segment, record, record_size);
+                run = 0;
+                continue;
+            }
+            const PHYS_BODY *phys = motionOf(history, records, i);
+            long long predicted[4], residuals[4];
+            predictMotion(motionOf(history, history->shadow, i), dt, predicted);
+            residuals[0] = llround(phys->pos.x * HISTORY_POSITION_SCALE) - predicted[0];
+            residuals[1] = llround(phys->pos.y * HISTORY_POSITION_SCALE) - predicted[1];
+            residuals[2] = llround(phys->vel.x * HISTORY_VELOCITY_SCALE) - predicted[2];
+            residuals[3] = llround(phys->vel.y * HISTORY_VELOCITY_SCALE) - predicted[3];
+            if (residuals[0] == 0 && residuals[1] == 0 && residuals[2] == 0 && residuals[3] == 0)
+            {
+                run++;
+                continue;
+            }
+            if (residuals[2] == 0 && residuals[3] == 0 && llabs(residuals[0]) <= 1 && llabs(residuals[1]) <= 1)
+            {
+                int nudge = (residuals[1] + 1) * 3 + residuals[0] + 1;
+                writeHistoryVarint(history, segment, (uint64_t)run << HISTORY_ENTRY_BITS | nudge);
+            }
+            else
+            {
+                writeHistoryVarint(history, segment, (uint64_t)run << HISTORY_ENTRY_BITS | HISTORY_ENTRY_RESIDUALS);
+                for (int k = 0; k < 4; k++)
+                    writeHistoryVarint(history, segment, residuals[k] < 0 ? ~((uint64_t)residuals[k] << 1) : (uint64_t)residuals[k] << 1);
+            }
+            run = 0;
+        }
+        if (run > 0)
+            writeHistoryVarint(history, segment, (uint64_t)run << HISTORY_ENTRY_BITS | HISTORY_ENTRY_RESIDUALS);
+    }
+    segment->num_frames++;
+
+    // bring the shadow up to date by decoding what was just written, so it can never drift from a rewind
+    int decoded_next_id;
+    const unsigned char *cursor = segment->data + offset;
+    if (segment->num_frames == 1)
+        decodeHistoryKeyframe(history, &decoded_next_id, &cursor);
+    else
+        decodeHistoryDelta(history, &decoded_next_id, &cursor);
+}
+
+void dropOldestHistorySegment(HISTORY *history)
+{
+    HISTORY_SEGMENT *oldest = history->segments;
+    history->bytes -= oldest->cap + oldest->offsets_cap * sizeof(size_t);
+    free(oldest->data);
+    free(oldest->offsets);
+    memmove(history->segments, history->segments + 1, --history->count * sizeof(HISTORY_SEGMENT));
+}
+
+void writeHistoryBytes(HISTORY *history, HISTORY_SEGMENT *segment, const void *bytes, size_t size)
+{
+    if (segment->size + size > segment->cap)
+    {
+        size_t cap = segment->cap > 0 ? segment->cap : 4096;
+        while (cap < segment->size + size)
+            cap *= 2;
+        unsigned char *temp = (unsigned char *)realloc(segment->data, cap);
+        if (temp == NULL)
+        {
+            fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+            return;
+        }
+        history->bytes += cap - segment->cap;
+        segment->cap = cap;
+        segment->data = temp;
+    }
+    memcpy(segment->data + segment->size, bytes, size);
+    segment->size += size;
+}
+
+// LEB128: seven bits per byte, high bit set on every byte but the last
+void writeHistoryVarint(HISTORY *history, HISTORY_SEGMENT *segment, uint64_t value)
+{
+    unsigned char bytes[10];
+    size_t size = 0;
+    do
+    {
+        bytes[size] = value & 0x7F;
+        value >>= 7;
+        if (value != 0)
+            bytes[size] |= 0x80;
+        size++;
+    } while (value != 0);
+    writeHistoryBytes(history, segment, bytes, size);
+}
+
+uint64_t readHistoryVarint(const unsigned char **cursor)
+{
+    uint64_t value = 0;
+    int shift = 0;
+    unsigned char byte;
+    do
+    {
+        byte = *(*cursor)++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+PHYS_BODY *motionOf(const HISTORY *history, const unsigned char *records, int i)
+{
+    return (PHYS_BODY *)(records + i * history->layout.record_size + history->layout.motion_offset);
+}
+
+// quantised position after moving at constant velocity for dt, followed by the unchanged quantised velocity
+void predictMotion(const PHYS_BODY *phys, double dt, long long *quantized)
+{
+    VECTOR_2D pos = phys->pos, vel = phys->vel;
+    quantized[0] = llround(pos.x * HISTORY_POSITION_SCALE) + llround(vel.x * dt * HISTORY_POSITION_SCALE);
+    quantized[1] = llround(pos.y * HISTORY_POSITION_SCALE) + llround(vel.y * dt * HISTORY_POSITION_SCALE);
+    quantized[2] = llround(vel.x * HISTORY_VELOCITY_SCALE);
+    quantized[3] = llround(vel.y * HISTORY_VELOCITY_SCALE);
+}
+
+void applyMotionResiduals(PHYS_BODY *phys, double dt, const long long *residuals)
+{
+    long long quantized[4];
+    predictMotion(phys, dt, quantized);
+    phys->pos.x = (quantized[0] + residuals[0]) / HISTORY_POSITION_SCALE;
+    phys->pos.y = (quantized[1] + residuals[1]) / HISTORY_POSITION_SCALE;
+    phys->vel.x = (quantized[2] + residuals[2]) / HISTORY_VELOCITY_SCALE;
+    phys->vel.y = (quantized[3] + residuals[3]) / HISTORY_VELOCITY_SCALE;
+}
+
+void reserveHistoryShadow(HISTORY *history, int cap)
+{
+    if (cap <= history->shadow_cap)
+        return;
+    unsigned char *temp = (unsigned char *)realloc(history->shadow, cap * history->layout.record_size);
+    if (temp)
+    {
+        history->shadow_cap = cap;
+        history->shadow = temp;
+    }
+    else
+        fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+}
+
+void decodeHistoryKeyframe(HISTORY *history, int *next_id, const unsigned char **cursor)
+{
+    size_t record_size = history->layout.record_size;
+    *next_id = readHistoryVarint(cursor);
+    int size = readHistoryVarint(cursor);
+    reserveHistoryShadow(history, size);
+    memcpy(history->shadow, *cursor, size * record_size);
+    *cursor += size * record_size;
+    history->shadow_size = size;
+}
+
+void decodeHistoryDelta(HISTORY *history, int *next_id, const unsigned char **cursor)
+{
+    const long long no_residuals[4] = {0, 0, 0, 0};
+    size_t record_size = history->layout.record_size;
+    double dt;
+    memcpy(&dt, *cursor, sizeof(double));
+    *cursor += sizeof(double);
+    *next_id = readHistoryVarint(cursor);
+    int size = readHistoryVarint(cursor);
+    reserveHistoryShadow(history, size);
+    int i = 0;
+    while (i < size)
+    {
+        uint64_t entry = readHistoryVarint(cursor);
+        for (uint64_t run = entry >> HISTORY_ENTRY_BITS; run > 0; run--, i++)
+            applyMotionResiduals(motionOf(history, history->shadow, i), dt, no_residuals);
+        if (i >= size)
+            break;
+        int code = entry & ((1 << HISTORY_ENTRY_BITS) - 1);
+        if (code == HISTORY_ENTRY_WHOLE)
+        {
+            memcpy(history->shadow + i * record_size, *cursor, record_size);
+            *cursor += record_size;
+        }
+        else if (code < HISTORY_ENTRY_RESIDUALS)
+        {
+            const long long residuals[4] = {code % 3 - 1, code / 3 - 1, 0, 0};
+            applyMotionResiduals(motionOf(history, history->shadow, i), dt, residuals);
+        }
+        else
+        {
+            long long residuals[4];
+            for (int k = 0; k < 4; k++)
+            {
+                uint64_t zigzag = readHistoryVarint(cursor);
+                residuals[k] = zigzag & 1 ? (long long)~(zigzag >> 1) : (long long)(zigzag >> 1);
+            }
+            applyMotionResiduals(motionOf(history, history->shadow, i), dt, residuals);
+        }
+        i++;
+    }
+    history->shadow_size = size;
+}
@@ -0,0 +1,619 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "Quadtree.h"
+
+#define DEFAULT_POINTS_CAPACITY 512
+#define DEFAULT_NODES_CAPACITY 256
+#define LEAF_SIZE 8
+// every pass over the points works on chunks of this many, so the result doesn't depend on the thread count
+#define CHUNK_SIZE 4096
+#define MIN_NODES_PER_THREAD 64
+#define AXIS_BITS 16
+#define RADIX_BITS 8
+#define RADIX_DIGITS (1 << RADIX_BITS)
+// a node is restructured once its children's boxes add up to this much more than its own box
+#define MAX_CHILD_OVERLAP 1.5
+// past this fraction of the points in loose subtrees, a build does better than a refit
+#define MAX_LOOSE_FRACTION 0.5
+// walks open nodes by their size, so once the nodes have grown this much in all a build does better too
+#define MAX_EXTENT_GROWTH 1.05
+
+typedef struct
+{
+    QUADTREE *tree;
+    const REAL *x, *y, *mass, *radius;
+    int n, num_chunks;
+    int shift;
+    int level;
+} BUILD_PASS;
+
+typedef struct
+{
+    uint32_t code;
+    int point_index;
+} KEYED_POINT;
+
+SDL_bool reservePoints(QUADTREE *tree, int n, int num_chunks);
+SDL_bool reserveNodes(QUADTREE *tree, int num_nodes);
+void boundChunks(void *context, int begin, int end);
+void encodeChunks(void *context, int begin, int end);
+void countDescentChunks(void *context, int begin, int end);
+void countDigitChunks(void *context, int begin, int end);
+void scatterDigitChunks(void *context, int begin, int end);
+void gatherChunks(void *context, int begin, int end);
+void countChildNodes(void *context, int begin, int end);
+void linkChildNodes(void *context, int begin, int end);
+void sumNodeMoments(void *context, int begin, int end);
+void sumTreeMoments(QUADTREE *tree, THREAD_POOL *pool, BUILD_PASS *pass);
+double sumNodeExtents(QUADTREE *tree);
+int findLooseNodes(QUADTREE *tree);
+SDL_bool isLooseNode(QUADTREE *tree, int node);
+void restructureLooseNodes(void *context, int begin, int end);
+int compareKeyedPoints(const void *a, const void *b);
+uint32_t encodePoint(QUADTREE *tree, REAL x, REAL y);
+int quadrantOf(QUADTREE *tree, int point, int level);
+int findQuadrantEnd(QUADTREE *tree, int begin, int end, int level, int quadrant);
+
+QUADTREE *Quadtree_Init()
+{
+    QUADTREE *tree = (QUADTREE *)calloc(1, sizeof(QUADTREE));
+    if (tree == NULL)
+        fprintf(stderr, "ALLOCATION FAILED in %s\n", __func__);
+    return tree;
+}
+
+// sorts the points along a Morton curve, splits them top down a level at a time and sums the moments bottom up,
+// every level being one parallel loop over its nodes
+int Quadtree_Build(QUADTREE *tree, THREAD_POOL *pool, const REAL *x, const REAL *y, const REAL *mass, const REAL *radius, int n)
+{
+    tree->num_points = tree->num_nodes = tree->num_levels = 0;
+    if (n <= 0)
+        return 0;
+    BUILD_PASS pass = {.tree = tree, .x = x, .y = y, .mass = mass, .radius = radius, .n = n, .num_chunks = (n + CHUNK_SIZE - 1) / CHUNK_SIZE};
+    if (!reservePoints(tree, n, pass.num_chunks) || !reserveNodes(tree, 1))
+        return -1;
+    tree->num_points = n;
+
+    // quantise within the points' bounding box, since nothing keeps them inside the world
+    ThreadPool_ParallelFor(pool, pass.num_chunks, 1, boundChunks, &pass);
+    REAL min_x = tree->chunk_bounds[0], min_y = tree->chunk_bounds[1];
+    REAL max_x = tree->chunk_bounds[2], max_y = tree->chunk_bounds[3];
+    for (int c = 1; c < pass.num_chunks; c++)
+    {
+        min_x = SDL_min(min_x, tree->chunk_bounds[4 * c]);
+        min_y = SDL_min(min_y, tree->chunk_bounds[4 * c + 1]);
+        max_x = SDL_max(max_x, tree->chunk_bounds[4 * c + 2]);
+        max_y = SDL_max(max_y, tree->chunk_bounds[4 * c + 3]);
+    }
+    double extent = SDL_max(SDL_max(max_x - min_x, max_y - min_y), 1.0);
+    tree->origin_x = min_x;
+    tree->origin_y = min_y;
+    tree->scale = ((1 << AXIS_BITS) - 1) / extent;
+    ThreadPool_ParallelFor(pool, pass.num_chunks, 1, encodeChunks, &pass);
+
+    // points kept in Morton order by their owner, which barely move between builds, often need no sorting at all
+    ThreadPool_ParallelFor(pool, pass.num_chunks, 1, countDescentChunks, &pass);
+    int descents = 0;
+    for (int c = 0; c < pass.num_chunks; c++)
+        descents += tree->chunk_offsets[c * RADIX_DIGITS];
+    // least significant digit radix sort; each chunk scatters into its own run of every bucket
+    for (pass.shift = 0; descents > 0 && pass.shift < 2 * AXIS_BITS; pass.shift += RADIX_BITS)
+    {
+        ThreadPool_ParallelFor(pool, pass.num_chunks, 1, countDigitChunks, &pass);
+        for (int d = 0, sum = 0; d < RADIX_DIGITS; d++)
+        {
+            for (int c = 0; c < pass.num_chunks; c++)
+            {
+                int count = tree->chunk_offsets[c * RADIX_DIGITS + d];
+                tree->chunk_offsets[c * RADIX_DIGITS + d] = sum;
+                sum += count;
+            }
+        }
+        ThreadPool_ParallelFor(pool, pass.num_chunks, 1, scatterDigitChunks, &pass);
+        uint32_t *code_temp = tree->code;
+        tree->code = tree->code_scratch;
+        tree->code_scratch = code_temp;
+        int *index_temp = tree->point_index;
+        tree->point_index = tree->index_scratch;
+        tree->index_scratch = index_temp;
+    }
+    ThreadPool_ParallelFor(pool, pass.num_chunks, 1, gatherChunks, &pass);
+
+    tree->first[0] = 0;
+    tree->count[0] = n;
+    tree->num_nodes = 1;
+    tree->level_start[0] = 0;
+    tree->level_start[1] = 1;
+    tree->num_levels = 1;
+    for (pass.level = 0; pass.level < QUADTREE_MAX_LEVELS; pass.level++)
+    {
+        int begin = tree->level_start[pass.level], end = tree->level_start[pass.level + 1];
+        ThreadPool_ParallelFor(pool, end - begin, MIN_NODES_PER_THREAD, countChildNodes, &pass);
+        int num_children = 0;
+        for (int node = begin; node < end; node++)
+        {
+            tree->first_child[node] = end + num_children;
+            num_children += tree->num_children[node];
+        }
+        if (num_children == 0)
+            break;
+        if (!reserveNodes(tree, end + num_children))
+            return -1;
+        ThreadPool_ParallelFor(pool, end - begin, MIN_NODES_PER_THREAD, linkChildNodes, &pass);
+        tree->num_nodes = end + num_children;
+        tree->level_start[pass.level + 2] = tree->num_nodes;
+        tree->num_levels++;
+    }
+    // the deepest level has no children to count
+    for (int node = tree->level_start[tree->num_levels - 1]; node < tree->num_nodes; node++)
+    {
+        tree->num_children[node] = 0;
+        tree->first_child[node] = tree->num_nodes;
+    }
+
+    sumTreeMoments(tree, pool, &pass);
+    tree->built_extent = sumNodeExtents(tree);
+    return 0;
+}
+
+// re-reads the points, indexed as they were for the last build, and re-sums the moments over the same nodes.
+// A node whose children have drifted into each other re-sorts its points over its own leaves.
+// Returns the number of nodes restructured, or -1 if so much of the tree has gone loose that it needs a build.
+int Quadtree_Refit(QUADTREE *tree, THREAD_POOL *pool, const REAL *x, const REAL *y, const REAL *mass, const REAL *radius)
+{
+    if (tree->num_nodes == 0)
+        return 0;
+    int n = tree->num_points;
+    BUILD_PASS pass = {.tree = tree, .x = x, .y = y, .mass = mass, .radius = radius, .n = n, .num_chunks = (n + CHUNK_SIZE - 1) / CHUNK_SIZE};
+    ThreadPool_ParallelFor(pool, pass.num_chunks, 1, gatherChunks, &pass);
+    sumTreeMoments(tree, pool, &pass);
+    if (sumNodeExtents(tree) > MAX_EXTENT_GROWTH * tree->built_extent)
+        return -1;
+
+    int num_loose = findLooseNodes(tree);
+    if (num_loose <= 0)
+        return num_loose;
+    ThreadPool_ParallelFor(pool, num_loose, 1, restructureLooseNodes, &pass);
+    sumTreeMoments(tree, pool, &pass);
+    return num_loose;
+}
+
+// writes the points whose circles reach into [min_x, max_x) x [min_y, max_y) to points, which needs room for all of
+// them, and returns how many it wrote. A node wholly inside gives all its points at once and one wholly outside none,
+// so the cost follows the number of points found rather than the number in the tree.
+int Quadtree_Query(const QUADTREE *tree, REAL min_x, REAL min_y, REAL max_x, REAL max_y, int *points)
+{
+    int num_found = 0;
+    if (tree->num_nodes == 0)
+        return 0;
+    // a node pushes at most 4 children in place of itself on each level
+    int stack[3 * (QUADTREE_MAX_LEVELS + 1) + 1];
+    int depth = 0;
+    stack[depth++] = 0;
+    while (depth > 0)
+    {
+        int node = stack[--depth];
+        REAL reach = tree->max_radius[node];
+        if (tree->max_x[node] + reach < min_x || tree->max_y[node] + reach < min_y ||
+            tree->min_x[node] - reach >= max_x || tree->min_y[node] - reach >= max_y)
+            continue;
+        int first = tree->first[node], last = first + tree->count[node];
+        if (tree->min_x[node] >= min_x && tree->min_y[node] >= min_y && tree->max_x[node] < max_x && tree->max_y[node] < max_y)
+        {
+            for (int p = first; p < last; p++)
+                points[num_found++] = p;
+        }
+        else if (tree->num_children[node] == 0)
+        {
+            for (int p = first; p < last; p++)
+            {
+                if (tree->x[p] + tree->radius[p] >= min_x && tree->y[p] + tree->radius[p] >= min_y &&
+                    tree->x[p] - tree->radius[p] < max_x && tree->y[p] - tree->radius[p] < max_y)
+                    points[num_found++] = p;
+            }
+        }
+        else
+        {
+            for (int child = tree->first_child[node]; child < tree->first_child[node] + tree->num_children[node]; child++)
+                stack[depth++] = child;
+        }
+    }
+    return num_found;
+}
+
+// interleaves the bits of x and y, so codes that are close tend to be close in space
+uint32_t Quadtree_MortonCode(uint32_t x, uint32_t y)
+{
+    uint32_t spread[2] = {x & 0xFFFF, y & 0xFFFF};
+    for (int axis = 0; axis < 2; axis++)
+    {
+        spread[axis] = (spread[axis] | spread[axis] << 8) & 0x00FF00FF;
+        spread[axis] = (spread[axis] | spread[axis] << 4) & 0x0F0F0F0F;
+        spread[axis] = (spread[axis] | spread[axis] << 2) & 0x33333333;
+        spread[axis] = (spread[axis] | spread[axis] << 1) & 0x55555555;
+    }
+    return spread[0] | spread[1] << 1;
+}
+
+void Quadtree_Free(QUADTREE *tree)
+{
+    if (tree == NULL)
+        return;
+    void *arrays[] = {
+        tree->point_index, tree->code, tree->x, tree->y, tree->mass, tree->radius,
+        tree->first, tree->count, tree->first_child, tree->num_children,
+        tree->total_mass, tree->com_x, tree->com_y,
+        tree->min_x, tree->min_y, tree->max_x, tree->max_y, tree->max_radius,
+        tree->code_scratch, tree->index_scratch, tree->chunk_offsets, tree->chunk_bounds, tree->loose_nodes};
+    for (size_t a = 0; a < SDL_arraysize(arrays); a++)
+        free(arrays[a]);
+    free(tree);
+}
+
+SDL_bool reservePoints(QUADTREE *tree, int n, int num_chunks)
+{
+    if (n > tree->points_cap)
+    {
+        int cap = SDL_max(SDL_max(n, 2 * tree->points_cap), DEFAULT_POINTS_CAPACITY);
+        void **arrays[] = {
+            (void **)&tree->point_index, (void **)&tree->code, (void **)&tree->code_scratch, (void **)&tree->index_scratch,
+            (void **)&tree->x, (void **)&tree->y, (void **)&tree->mass, (void **)&tree->radius};
+        size_t sizes[] = {sizeof(int), sizeof(uint32_t), sizeof(uint32_t), sizeof(int), sizeof(REAL), sizeof(REAL), sizeof(REAL), sizeof(REAL)};
+        for (size_t a = 0; a < SDL_arraysize(arrays); a++)
+        {
+            void *temp = realloc(*arrays[a], cap * sizes[a]);
+            if (temp == NULL)
+            {
+                fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+                return SDL_FALSE;
+            }
+            *arrays[a] = temp;
+        }
+        tree->points_cap = cap;
+    }
+    if (num_chunks > tree->chunks_cap)
+    {
+        int *temp_offsets = (int *)realloc(tree->chunk_offsets, num_chunks * RADIX_DIGITS * sizeof(int));
+        if (temp_offsets != NULL)
+            tree->chunk_offsets = temp_offsets;
+        REAL *temp_bounds = (REAL *)realloc(tree->chunk_bounds, num_chunks * 4 * sizeof(REAL));
+        if (temp_bounds != NULL)
+            tree->chunk_bounds = temp_bounds;
+        if (temp_offsets == NULL || temp_bounds == NULL)
+        {
+            fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+            return SDL_FALSE;
+        }
+        tree->chunks_cap = num_chunks;
+    }
+    return SDL_TRUE;
+}
+
+SDL_bool reserveNodes(QUADTREE *tree, int num_nodes)
+{
+    if (num_nodes <= tree->nodes_cap)
+        return SDL_TRUE;
+    int cap = SDL_max(SDL_max(num_nodes, 2 * tree->nodes_cap), DEFAULT_NODES_CAPACITY);
+    int **int_arrays[] = {&tree->first, &tree->count, &tree->first_child, &tree->num_children};
+    REAL **real_arrays[] = {
+        &tree->total_mass, &tree->com_x, &tree->com_y,
+        &tree->min_x, &tree->min_y, &tree->max_x, &tree->max_y, &tree->max_radius};
+    for (size_t a = 0; a < SDL_arraysize(int_arrays); a++)
+    {
+        int *temp = (int *)realloc(*int_arrays[a], cap * sizeof(int));
+        if (temp == NULL)
+        {
+            fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+            return SDL_FALSE;
+        }
+        *int_arrays[a] = temp;
+    }
+    for (size_t a = 0; a < SDL_arraysize(real_arrays); a++)
+    {
+        REAL *temp = (REAL *)realloc(*real_arrays[a], cap * sizeof(REAL));
+        if (temp == NULL)
+        {
+            fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+            return SDL_FALSE;
+        }
+        *real_arrays[a] = temp;
+    }
+    tree->nodes_cap = cap;
+    return SDL_TRUE;
+}
+
+void boundChunks(void *context, int begin, int end)
+{
+    BUILD_PASS *pass = (BUILD_PASS *)context;
+    for (int c = begin; c < end; c++)
+    {
+        int first = c * CHUNK_SIZE, last = SDL_min(first + CHUNK_SIZE, pass->n);
+        REAL *bounds = pass->tree->chunk_bounds + 4 * c;
+        bounds[0] = bounds[2] = pass->x[first];
+        bounds[1] = bounds[3] = pass->y[first];
+        for (int i = first + 1; i < last; i++)
+        {
+            bounds[0] = SDL_min(bounds[0], pass->x[i]);
+            bounds[1] = SDL_min(bounds[1], pass->y[i]);
+            bounds[2] = SDL_max(bounds[2], pass->x[i]);
+            bounds[3] = SDL_max(bounds[3], pass->y[i]);
+        }
+    }
+}
+
+void encodeChunks(void *context, int begin, int end)
+{
+    BUILD_PASS *pass = (BUILD_PASS *)context;
+    QUADTREE *tree = pass->tree;
+    for (int i = begin * CHUNK_SIZE; i < SDL_min(end * CHUNK_SIZE, pass->n); i++)
+    {
+        tree->code[i] = encodePoint(tree, pass->x[i], pass->y[i]);
+        tree->point_index[i] = i;
+    }
+}
+
+void countDescentChunks(void *context, int begin, int end)
+{
+    BUILD_PASS *pass = (BUILD_PASS *)context;
+    QUADTREE *tree = pass->tree;
+    for (int c = begin; c < end; c++)
+    {
+        int descents = 0;
+        for (int i = SDL_max(c * CHUNK_SIZE, 1); i < SDL_min((c + 1) * CHUNK_SIZE, pass->n); i++)
+            descents += tree->code[i] < tree->code[i - 1];
+        tree->chunk_offsets[c * RADIX_DIGITS] = descents;
+    }
+}
+
+void countDigitChunks(void *context, int begin, int end)
+{
+    BUILD_PASS *pass = (BUILD_PASS *)context;
+    QUADTREE *tree = pass->tree;
+    for (int c = begin; c < end; c++)
+    {
+        int *counts = tree->chunk_offsets + c * RADIX_DIGITS;
+        SDL_memset(counts, 0, RADIX_DIGITS * sizeof(int));
+        for (int i = c * CHUNK_SIZE; i < SDL_min((c + 1) * CHUNK_SIZE, pass->n); i++)
+            counts[tree->code[i] >> pass->shift & (RADIX_DIGITS - 1)]++;
+    }
+}
+
+void scatterDigitChunks(void *context, int begin, int end)
+{
+    BUILD_PASS *pass = (BUILD_PASS *)context;
+    QUADTREE *tree = pass->tree;
+    for (int c = begin; c < end; c++)
+    {
+        int *offsets = tree->chunk_offsets + c * RADIX_DIGITS;
+        for (int i = c * CHUNK_SIZE; i < SDL_min((c + 1) * CHUNK_SIZE, pass->n); i++)
+        {
+            int k = offsets[tree->code[i] >> pass->shift & (RADIX_DIGITS - 1)]++;
+            tree->code_scratch[k] = tree->code[i];
+            tree->index_scratch[k] = tree->point_index[i];
+        }
+    }
+}
+
+void gatherChunks(void *context, int begin, int end)
+{
+    BUILD_PASS *pass = (BUILD_PASS *)context;
+    QUADTREE *tree = pass->tree;
+    for (int i = begin * CHUNK_SIZE; i < SDL_min(end * CHUNK_SIZE, pass->n); i++)
+    {
+        int p = tree->point_index[i];
+        tree->x[i] = pass->x[p];
+        tree->y[i] = pass->y[p];
+        tree->mass[i] = pass->mass[p];
+        tree->radius[i] = pass->radius[p];
+    }
+}
+
+void countChildNodes(void *context, int begin, int end)
+{
+    BUILD_PASS *pass = (BUILD_PASS *)context;
+    QUADTREE *tree = pass->tree;
+    int level_begin = tree->level_start[pass->level];
+    for (int node = level_begin + begin; node < level_begin + end; node++)
+    {
+        tree->num_children[node] = 0;
+        if (tree->count[node] <= LEAF_SIZE)
+            continue;
+        int first = tree->first[node], last = first + tree->count[node];
+        // the codes are sorted, so the quadrants of the next level come in order
+        for (int i = first; i < last; tree->num_children[node]++)
+            i = findQuadrantEnd(tree, i, last, pass->level, quadrantOf(tree, i, pass->level));
+    }
+}
+
+void linkChildNodes(void *context, int begin, int end)
+{
+    BUILD_PASS *pass = (BUILD_PASS *)context;
+    QUADTREE *tree = pass->tree;
+    int level_begin = tree->level_start[pass->level];
+    for (int node = level_begin + begin; node < level_begin + end; node++)
+    {
+        int first = tree->first[node], last = first + tree->count[node];
+        int child = tree->first_child[node];
+        for (int i = first; child < tree->first_child[node] + tree->num_children[node]; child++)
+        {
+            int quadrant_end = findQuadrantEnd(tree, i, last, pass->level, quadrantOf(tree, i, pass->level));
+            tree->first[child] = i;
+            tree->count[child] = quadrant_end - i;
+            i = quadrant_end;
+        }
+    }
+}
+
+void sumNodeMoments(void *context, int begin, int end)
+{
+    BUILD_PASS *pass = (BUILD_PASS *)context;
+    QUADTREE *tree = pass->tree;
+    int level_begin = tree->level_start[pass->level];
+    for (int node = level_begin + begin; node < level_begin + end; node++)
+    {
+        // a leaf sums its points and an inner node its children, which the level below has already summed
+        SDL_bool is_leaf = tree->num_children[node] == 0;
+        int first = is_leaf ? tree->first[node] : tree->first_child[node];
+        int last = first + (is_leaf ? tree->count[node] : tree->num_children[node]);
+        REAL *mass = is_leaf ? tree->mass : tree->total_mass;
+        REAL *x = is_leaf ? tree->x : tree->com_x, *y = is_leaf ? tree->y : tree->com_y;
+        REAL *min_x = is_leaf ? tree->x : tree->min_x, *min_y = is_leaf ? tree->y : tree->min_y;
+        REAL *max_x = is_leaf ? tree->x : tree->max_x, *max_y = is_leaf ? tree->y : tree->max_y;
+        REAL *radius = is_leaf ? tree->radius : tree->max_radius;
+        REAL total_mass = 0, moment_x = 0, moment_y = 0;
+        tree->min_x[node] = min_x[first];
+        tree->min_y[node] = min_y[first];
+        tree->max_x[node] = max_x[first];
+        tree->max_y[node] = max_y[first];
+        tree->max_radius[node] = radius[first];
+        for (int k = first; k < last; k++)
+        {
+            total_mass += mass[k];
+            moment_x += mass[k] * x[k];
+            moment_y += mass[k] * y[k];
+            tree->min_x[node] = SDL_min(tree->min_x[node], min_x[k]);
+            tree->min_y[node] = SDL_min(tree->min_y[node], min_y[k]);
+            tree->max_x[node] = SDL_max(tree->max_x[node], max_x[k]);
+            tree->max_y[node] = SDL_max(tree->max_y[node], max_y[k]);
+            tree->max_radius[node] = SDL_max(tree->max_radius[node], radius[k]);
+        }
+        tree->total_mass[node] = total_mass;
+        tree->com_x[node] = total_mass > 0 ? moment_x / total_mass : x[first];
+        tree->com_y[node] = total_mass > 0 ? moment_y / total_mass : y[first];
+    }
+}
+
+void sumTreeMoments(QUADTREE *tree, THREAD_POOL *pool, BUILD_PASS *pass)
+{
+    for (pass->level = tree->num_levels - 1; pass->level >= 0; pass->level--)
+    {
+        int begin = tree->level_start[pass->level], end = tree->level_start[pass->level + 1];
+        ThreadPool_ParallelFor(pool, end - begin, MIN_NODES_PER_THREAD, sumNodeMoments, pass);
+    }
+}
+
+double sumNodeExtents(QUADTREE *tree)
+{
+    double extent = 0;
+    for (int node = 0; node < tree->num_nodes; node++)
+        extent += SDL_max(tree->max_x[node] - tree->min_x[node], tree->max_y[node] - tree->min_y[node]);
+    return extent;
+}
+
+// collects the shallowest loose nodes, whose subtrees are disjoint; -1 if they hold too many of the points
+int findLooseNodes(QUADTREE *tree)
+{
+    if (tree->num_nodes > tree->loose_cap)
+    {
+        int *temp = (int *)realloc(tree->loose_nodes, tree->num_nodes * sizeof(int));
+        if (temp == NULL)
+        {
+            fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+            return 0;
+        }
+        tree->loose_nodes = temp;
+        tree->loose_cap = tree->num_nodes;
+    }
+    // a node pushes at most 4 children in place of itself on each level
+    int stack[3 * QUADTREE_MAX_LEVELS + 1];
+    int depth = 0, num_loose = 0, loose_points = 0;
+    stack[depth++] = 0;
+    while (depth > 0)
+    {
+        int node = stack[--depth];
+        if (tree->num_children[node] == 0)
+            continue;
+        if (isLooseNode(tree, node))
+        {
+            tree->loose_nodes[num_loose++] = node;
+            loose_points += tree->count[node];
+            continue;
+        }
+        for (int child = tree->first_child[node]; child < tree->first_child[node] + tree->num_children[node]; child++)
+            stack[depth++] = child;
+    }
+    return loose_points > MAX_LOOSE_FRACTION * tree->num_points ? -1 : num_loose;
+}
+
+SDL_bool isLooseNode(QUADTREE *tree, int node)
+{
+    // children of a fresh node cover disjoint quadrants, so their boxes never add up to more than its box
+    REAL children_area = 0;
+    for (int child = tree->first_child[node]; child < tree->first_child[node] + tree->num_children[node]; child++)
+        children_area += (tree->max_x[child] - tree->min_x[child]) * (tree->max_y[child] - tree->min_y[child]);
+    REAL area = (tree->max_x[node] - tree->min_x[node]) * (tree->max_y[node] - tree->min_y[node]);
+    return children_area > MAX_CHILD_OVERLAP * area;
+}
+
+// re-sorts the points under each loose node along the curve and deals them out again to its leaves, which
+// keep their sizes, so the layout of the nodes never changes
+void restructureLooseNodes(void *context, int begin, int end)
+{
+    BUILD_PASS *pass = (BUILD_PASS *)context;
+    QUADTREE *tree = pass->tree;
+    for (int l = begin; l < end; l++)
+    {
+        int node = tree->loose_nodes[l];
+        int first = tree->first[node], count = tree->count[node];
+        KEYED_POINT *points = (KEYED_POINT *)malloc(count * sizeof(KEYED_POINT));
+        if (points == NULL)
+        {
+            fprintf(stderr, "ALLOCATION FAILED in %s\n", __func__);
+            continue;
+        }
+        for (int k = 0; k < count; k++)
+        {
+            int i = first + k;
+            points[k] = (KEYED_POINT){encodePoint(tree, tree->x[i], tree->y[i]), tree->point_index[i]};
+        }
+        qsort(points, count, sizeof(KEYED_POINT), compareKeyedPoints);
+        for (int k = 0; k < count; k++)
+        {
+            int i = first + k, p = points[k].point_index;
+            tree->code[i] = points[k].code;
+            tree->point_index[i] = p;
+            tree->x[i] = pass->x[p];
+            tree->y[i] = pass->y[p];
+            tree->mass[i] = pass->mass[p];
+            tree->radius[i] = pass->radius[p];
+        }
+        free(points);
+    }
+}
+
+int compareKeyedPoints(const void *a, const void *b)
+{
+    const KEYED_POINT *p1 = (const KEYED_POINT *)a, *p2 = (const KEYED_POINT *)b;
+    if (p1->code != p2->code)
+        return p1->code < p2->code ? -1 : 1;
+    return (p1->point_index > p2->point_index) - (p1->point_index < p2->point_index);
+}
+
+// points that have left the box of the last build are clamped to its edges
+uint32_t encodePoint(QUADTREE *tree, REAL x, REAL y)
+{
+    const REAL max_cell = (1 << AXIS_BITS) - 1;
+    REAL cell_x = SDL_clamp((x - tree->origin_x) * tree->scale, 0, max_cell);
+    REAL cell_y = SDL_clamp((y - tree->origin_y) * tree->scale, 0, max_cell);
+    return Quadtree_MortonCode((uint32_t)cell_x, (uint32_t)cell_y);
+}
+
+int quadrantOf(QUADTREE *tree, int point, int level)
+{
+    return tree->code[point] >> (2 * (QUADTREE_MAX_LEVELS - 1 - level)) & 3;
+}
+
+// first point in [begin, end) past the given quadrant of the next level
+int findQuadrantEnd(QUADTREE *tree, int begin, int end, int level, int quadrant)
+{
+    while (begin < end)
+    {
+        int mid = begin + (end - begin) / 2;
+        if (quadrantOf(tree, mid, level) <= quadrant)
+            begin = mid + 1;
+        else
+            end = mid;
+    }
+    return begin;
+}
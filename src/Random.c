@@ -0,0 +1,25 @@
+#include "Random.h"
+
+void Random_Seed(RANDOM *rng, uint64_t seed)
+{
+    rng->state = seed;
+}
+
+// PCG-style linear congruential step, returning the better-mixed high bits
+uint32_t Random_Next(RANDOM *rng)
+{
+    rng->state = rng->state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (uint32_t)(rng->state >> 32);
+}
+
+// uniform in [0, 1)
+double Random_Unit(RANDOM *rng)
+{
+    return Random_Next(rng) / 4294967296.0;
+}
+
+// uniform in [low, high)
+int Random_Range(RANDOM *rng, int low, int high)
+{
+    return low + Random_Next(rng) % (high - low);
+}
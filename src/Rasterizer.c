@@ -0,0 +1,245 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "Rasterizer.h"
+
+#define DEFAULT_CIRCLES_CAPACITY 256
+
+SDL_bool reserveCircles(RASTERIZER *raster, int n);
+SDL_bool binCircles(RASTERIZER *raster);
+void drawTileRange(void *context, int begin, int end);
+void drawCircleInTile(RASTERIZER *raster, int circle, int x0, int y0, int x1, int y1);
+void drawHeatMapInTile(RASTERIZER *raster, int tile, int x0, int y0, int x1, int y1);
+
+RASTERIZER *Rasterizer_Init()
+{
+    RASTERIZER *raster = (RASTERIZER *)calloc(1, sizeof(RASTERIZER));
+    if (raster == NULL)
+    {
+        fprintf(stderr, "ALLOCATION FAILED in %s\n", __func__);
+        return NULL;
+    }
+    // dark red through yellow to white, on a log scale since a few pixels hold most of a dense cluster
+    for (int level = 1; level < RASTERIZER_HEAT_LEVELS; level++)
+    {
+        double t = SDL_log(1 + level) / SDL_log(RASTERIZER_HEAT_LEVELS);
+        double red = SDL_min(3 * t, 1), green = SDL_clamp(3 * t - 1, 0, 1), blue = SDL_clamp(3 * t - 2, 0, 1);
+        raster->heat_palette[level] = 0xFF000000u | (uint32_t)(red * 255) << 16 | (uint32_t)(green * 255) << 8 | (uint32_t)(blue * 255);
+    }
+    return raster;
+}
+
+// circles narrower than lod_radius are drawn as lod says, which bounds the cost of each by a pixel
+void Rasterizer_SetLevelOfDetail(RASTERIZER *raster, int lod, double lod_radius)
+{
+    raster->lod = lod;
+    raster->lod_radius = lod_radius;
+}
+
+void Rasterizer_Begin(RASTERIZER *raster)
+{
+    raster->num_circles = 0;
+}
+
+int Rasterizer_AddCircle(RASTERIZER *raster, double x, double y, double radius, uint32_t argb)
+{
+    if (!reserveCircles(raster, raster->num_circles + 1))
+        return -1;
+    int c = raster->num_circles++;
+    raster->x[c] = x;
+    raster->y[c] = y;
+    raster->radius[c] = raster->lod != RASTERIZER_LOD_OFF && radius < raster->lod_radius ? -1 : (int)radius;
+    raster->color[c] = argb;
+    return 0;
+}
+
+// fills every pixel of the framebuffer, so it needs no clearing beforehand
+int Rasterizer_Draw(RASTERIZER *raster, THREAD_POOL *pool, uint32_t *pixels, int pitch, int width, int height, uint32_t background)
+{
+    raster->pixels = pixels;
+    raster->pitch = pitch;
+    raster->width = width;
+    raster->height = height;
+    raster->background = background;
+    if (width <= 0 || height <= 0)
+        return 0;
+    if (!binCircles(raster))
+        return -1;
+    if (raster->lod == RASTERIZER_LOD_HEAT_MAP && width * height > raster->density_cap)
+    {
+        uint32_t *temp = (uint32_t *)realloc(raster->density, (size_t)width * height * sizeof(uint32_t));
+        if (temp == NULL)
+        {
+            fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+            return -1;
+        }
+        raster->density = temp;
+        raster->density_cap = width * height;
+    }
+    ThreadPool_ParallelFor(pool, raster->tiles_x * raster->tiles_y, 1, drawTileRange, raster);
+    return 0;
+}
+
+void Rasterizer_Free(RASTERIZER *raster)
+{
+    if (raster == NULL)
+        return;
+    void *arrays[] = {raster->x, raster->y, raster->radius, raster->color, raster->tile_start, raster->entries, raster->density};
+    for (size_t a = 0; a < SDL_arraysize(arrays); a++)
+        free(arrays[a]);
+    free(raster);
+}
+
+SDL_bool reserveCircles(RASTERIZER *raster, int n)
+{
+    if (n > raster->circles_cap)
+    {
+        int cap = SDL_max(SDL_max(n, 2 * raster->circles_cap), DEFAULT_CIRCLES_CAPACITY);
+        void **arrays[] = {(void **)&raster->x, (void **)&raster->y, (void **)&raster->radius, (void **)&raster->color};
+        size_t sizes[] = {sizeof(int), sizeof(int), sizeof(int), sizeof(uint32_t)};
+        for (size_t a = 0; a < SDL_arraysize(arrays); a++)
+        {
+            void *temp = realloc(*arrays[a], cap * sizes[a]);
+            if (temp == NULL)
+            {
+                fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+                return SDL_FALSE;
+            }
+            *arrays[a] = temp;
+        }
+        raster->circles_cap = cap;
+    }
+    return SDL_TRUE;
+}
+
+// counting sort of the circles into the tiles their bounding boxes overlap, keeping the order they were added in
+SDL_bool binCircles(RASTERIZER *raster)
+{
+    raster->tiles_x = (raster->width + RASTERIZER_TILE_SIZE - 1) / RASTERIZER_TILE_SIZE;
+    raster->tiles_y = (raster->height + RASTERIZER_TILE_SIZE - 1) / RASTERIZER_TILE_SIZE;
+    int num_tiles = raster->tiles_x * raster->tiles_y;
+    if (num_tiles + 1 > raster->tiles_cap)
+    {
+        int *temp = (int *)realloc(raster->tile_start, (num_tiles + 1) * sizeof(int));
+        if (temp == NULL)
+        {
+            fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+            return SDL_FALSE;
+        }
+        raster->tile_start = temp;
+        raster->tiles_cap = num_tiles + 1;
+    }
+
+    SDL_memset(raster->tile_start, 0, (num_tiles + 1) * sizeof(int));
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int c = 0; c < raster->num_circles; c++)
+        {
+            // a splat covers the pixel its centre is in
+            int x = raster->x[c], y = raster->y[c], r = SDL_max(raster->radius[c], 0);
+            if (x + r < 0 || y + r < 0 || x - r >= raster->width || y - r >= raster->height)
+                continue;
+            int tile_x0 = SDL_max(x - r, 0) / RASTERIZER_TILE_SIZE, tile_x1 = SDL_min(x + r, raster->width - 1) / RASTERIZER_TILE_SIZE;
+            int tile_y0 = SDL_max(y - r, 0) / RASTERIZER_TILE_SIZE, tile_y1 = SDL_min(y + r, raster->height - 1) / RASTERIZER_TILE_SIZE;
+            for (int ty = tile_y0; ty <= tile_y1; ty++)
+            {
+                for (int tx = tile_x0; tx <= tile_x1; tx++)
+                {
+                    int t = ty * raster->tiles_x + tx;
+                    if (pass == 0)
+                        raster->tile_start[t + 1]++;
+                    else
+                        // filling a tile moves its start to its end, which is where the next one starts
+                        raster->entries[raster->tile_start[t]++] = c;
+                }
+            }
+        }
+        if (pass == 0)
+        {
+            for (int t = 0; t < num_tiles; t++)
+                raster->tile_start[t + 1] += raster->tile_start[t];
+            int num_entries = raster->tile_start[num_tiles];
+            if (num_entries > raster->entries_cap)
+            {
+                int cap = SDL_max(num_entries, 2 * raster->entries_cap);
+                int *temp = (int *)realloc(raster->entries, cap * sizeof(int));
+                if (temp == NULL)
+                {
+                    fprintf(stderr, "REALLOCATION FAILED in %s\n", __func__);
+                    return SDL_FALSE;
+                }
+                raster->entries = temp;
+                raster->entries_cap = cap;
+            }
+        }
+    }
+    for (int t = num_tiles; t > 0; t--)
+        raster->tile_start[t] = raster->tile_start[t - 1];
+    raster->tile_start[0] = 0;
+    return SDL_TRUE;
+}
+
+void drawTileRange(void *context, int begin, int end)
+{
+    RASTERIZER *raster = (RASTERIZER *)context;
+    for (int t = begin; t < end; t++)
+    {
+        int x0 = t % raster->tiles_x * RASTERIZER_TILE_SIZE, y0 = t / raster->tiles_x * RASTERIZER_TILE_SIZE;
+        int x1 = SDL_min(x0 + RASTERIZER_TILE_SIZE, raster->width), y1 = SDL_min(y0 + RASTERIZER_TILE_SIZE, raster->height);
+        if (raster->lod == RASTERIZER_LOD_HEAT_MAP)
+            drawHeatMapInTile(raster, t, x0, y0, x1, y1);
+        else
+        {
+            for (int py = y0; py < y1; py++)
+            {
+                uint32_t *row = (uint32_t *)((unsigned char *)raster->pixels + (size_t)py * raster->pitch);
+                for (int px = x0; px < x1; px++)
+                    row[px] = raster->background;
+            }
+        }
+        for (int e = raster->tile_start[t]; e < raster->tile_start[t + 1]; e++)
+        {
+            int c = raster->entries[e];
+            if (raster->radius[c] >= 0)
+                drawCircleInTile(raster, c, x0, y0, x1, y1);
+            else if (raster->lod == RASTERIZER_LOD_SPLATS)
+                ((uint32_t *)((unsigned char *)raster->pixels + (size_t)raster->y[c] * raster->pitch))[raster->x[c]] = raster->color[c];
+        }
+    }
+}
+
+// counts the splats landing on every pixel of the tile, then colours each pixel by its count
+void drawHeatMapInTile(RASTERIZER *raster, int tile, int x0, int y0, int x1, int y1)
+{
+    for (int py = y0; py < y1; py++)
+        SDL_memset(raster->density + (size_t)py * raster->width + x0, 0, (x1 - x0) * sizeof(uint32_t));
+    for (int e = raster->tile_start[tile]; e < raster->tile_start[tile + 1]; e++)
+    {
+        int c = raster->entries[e];
+        if (raster->radius[c] < 0)
+            raster->density[(size_t)raster->y[c] * raster->width + raster->x[c]]++;
+    }
+    for (int py = y0; py < y1; py++)
+    {
+        const uint32_t *counts = raster->density + (size_t)py * raster->width;
+        uint32_t *row = (uint32_t *)((unsigned char *)raster->pixels + (size_t)py * raster->pitch);
+        for (int px = x0; px < x1; px++)
+            row[px] = counts[px] == 0 ? raster->background : raster->heat_palette[SDL_min(counts[px], RASTERIZER_HEAT_LEVELS - 1)];
+    }
+}
+
+// one square root per row gives the span of the row, which are the pixels no farther than the radius from the centre
+void drawCircleInTile(RASTERIZER *raster, int circle, int x0, int y0, int x1, int y1)
+{
+    int x = raster->x[circle], y = raster->y[circle], r = raster->radius[circle];
+    uint32_t color = raster->color[circle];
+    for (int py = SDL_max(y - r, y0); py <= SDL_min(y + r, y1 - 1); py++)
+    {
+        int dy = py - y;
+        int half = (int)SDL_sqrt((double)r * r - (double)dy * dy);
+        int from = SDL_max(x - half, x0), to = SDL_min(x + half, x1 - 1);
+        uint32_t *row = (uint32_t *)((unsigned char *)raster->pixels + (size_t)py * raster->pitch);
+        for (int px = from; px <= to; px++)
+            row[px] = color;
+    }
+}
@@ -0,0 +1,204 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "StateExport.h"
+
+// a ticket is an even sequence number with the buffer in its low bit, kept non-negative as the sequence wraps round
+#define SEQUENCE_MASK 0x7FFFFFFE
+
+struct STATE_EXPORT
+{
+    char *name;
+    STATE_EXPORT_HEADER *header;
+    size_t size;
+    // the buffer handed out by the last StateExport_Begin, -1 if none is being filled
+    int writing;
+    SDL_bool reported_failure;
+};
+
+STATE_EXPORT_HEADER *createSegment(const char *name, int capacity, size_t *size);
+STATE_EXPORT_BODY *bufferBodies(const STATE_EXPORT_HEADER *header, int b);
+int loadShared(const SDL_atomic_t *atomic);
+
+// publishes into the segment called name, a POSIX shared memory name such as "/engine2d", replacing any segment of
+// that name; capacity bodies fit in each buffer to begin with, and the segment is replaced by a larger one as needed
+STATE_EXPORT *StateExport_Open(const char *name, int capacity)
+{
+    STATE_EXPORT *export = (STATE_EXPORT *)calloc(1, sizeof(STATE_EXPORT));
+    if (export == NULL || (export->name = strdup(name)) == NULL)
+    {
+        fprintf(stderr, "ALLOCATION FAILED in %s\n", __func__);
+        free(export);
+        return NULL;
+    }
+    export->writing = -1;
+    export->header = createSegment(name, SDL_max(capacity, 1), &export->size);
+    if (export->header == NULL)
+    {
+        free(export->name);
+        free(export);
+        return NULL;
+    }
+    return export;
+}
+
+// the buffer to write the next frame's count bodies into, NULL if the segment couldn't be grown to hold them
+STATE_EXPORT_BODY *StateExport_Begin(STATE_EXPORT *export, int count)
+{
+    STATE_EXPORT_HEADER *header = export->header;
+    if (count > header->capacity)
+    {
+        size_t size;
+        STATE_EXPORT_HEADER *grown = createSegment(export->name, SDL_max(count, 2 * header->capacity), &size);
+        if (grown == NULL)
+        {
+            if (!export->reported_failure)
+                fprintf(stderr, "export: cannot grow '%s' to %d bodies, frames with more are not published\n", export->name, count);
+            export->reported_failure = SDL_TRUE;
+            return NULL;
+        }
+        // readers of the old segment can finish the frame they are on, it stays mapped for them after the unlink
+        SDL_AtomicSet(&header->stale, 1);
+        munmap(header, export->size);
+        export->header = header = grown;
+        export->size = size;
+    }
+    int latest = SDL_AtomicGet(&header->latest);
+    export->writing = latest < 0 ? 0 : latest ^ 1;
+    // odd from here on, so a reader that lapped onto this buffer knows to try again
+    SDL_AtomicAdd(&header->buffers[export->writing].sequence, 1);
+    return bufferBodies(header, export->writing);
+}
+
+// makes the buffer filled since the last StateExport_Begin the latest one
+void StateExport_Publish(STATE_EXPORT *export, int frame, int count)
+{
+    if (export->writing < 0)
+        return;
+    STATE_EXPORT_BUFFER *buffer = export->header->buffers + export->writing;
+    buffer->frame = frame;
+    buffer->count = count;
+    SDL_AtomicAdd(&buffer->sequence, 1);
+    SDL_AtomicSet(&export->header->latest, export->writing);
+    export->writing = -1;
+}
+
+// marks the segment stale for its readers and removes its name
+void StateExport_Close(STATE_EXPORT *export)
+{
+    SDL_AtomicSet(&export->header->stale, 1);
+    munmap(export->header, export->size);
+    shm_unlink(export->name);
+    free(export->name);
+    free(export);
+}
+
+STATE_EXPORT_HEADER *createSegment(const char *name, int capacity, size_t *size)
+{
+    *size = sizeof(STATE_EXPORT_HEADER) + 2 * (size_t)capacity * sizeof(STATE_EXPORT_BODY);
+    // a new segment rather than a resized one, so readers never see the old one shrink or move under them
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        fprintf(stderr, "export: cannot create '%s': %s\n", name, strerror(errno));
+        return NULL;
+    }
+    STATE_EXPORT_HEADER *header = MAP_FAILED;
+    if (ftruncate(fd, *size) == 0)
+        header = (STATE_EXPORT_HEADER *)mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (header == MAP_FAILED)
+    {
+        fprintf(stderr, "export: cannot map '%s': %s\n", name, strerror(errno));
+        shm_unlink(name);
+        return NULL;
+    }
+    header->version = STATE_EXPORT_VERSION;
+    header->header_size = sizeof(STATE_EXPORT_HEADER);
+    header->body_size = sizeof(STATE_EXPORT_BODY);
+    header->capacity = capacity;
+    SDL_AtomicSet(&header->latest, -1);
+    // written last, so a reader that maps the segment early sees it isn't ready yet
+    SDL_MemoryBarrierRelease();
+    header->magic = STATE_EXPORT_MAGIC;
+    return header;
+}
+
+STATE_EXPORT_BODY *bufferBodies(const STATE_EXPORT_HEADER *header, int b)
+{
+    return (STATE_EXPORT_BODY *)((char *)header + header->header_size + (size_t)b * header->capacity * header->body_size);
+}
+
+// maps the segment called name for reading, NULL if there is none or it isn't one this version can read
+const STATE_EXPORT_HEADER *StateExport_Map(const char *name, size_t *size)
+{
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return NULL;
+    struct stat segment_stat;
+    const STATE_EXPORT_HEADER *header = MAP_FAILED;
+    if (fstat(fd, &segment_stat) == 0 && (size_t)segment_stat.st_size >= sizeof(STATE_EXPORT_HEADER))
+        header = (const STATE_EXPORT_HEADER *)mmap(NULL, segment_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (header == MAP_FAILED)
+        return NULL;
+    *size = segment_stat.st_size;
+    SDL_bool valid = header->magic == STATE_EXPORT_MAGIC;
+    SDL_MemoryBarrierAcquire();
+    valid = valid && header->version == STATE_EXPORT_VERSION && header->body_size == sizeof(STATE_EXPORT_BODY) &&
+            header->header_size + 2 * (size_t)header->capacity * header->body_size <= *size;
+    if (!valid)
+    {
+        StateExport_Unmap(header, *size);
+        return NULL;
+    }
+    return header;
+}
+
+void StateExport_Unmap(const STATE_EXPORT_HEADER *header, size_t size)
+{
+    munmap((void *)header, size);
+}
+
+// points bodies at the latest frame, to be read in place and then checked with StateExport_EndRead; returns the
+// ticket to check it with, or -1 once the segment is stale and should be mapped again
+int StateExport_BeginRead(const STATE_EXPORT_HEADER *header, const STATE_EXPORT_BODY **bodies, int *frame, int *count)
+{
+    while (!loadShared(&header->stale))
+    {
+        int b = loadShared(&header->latest);
+        if (b < 0)
+            continue;
+        int sequence = loadShared(&header->buffers[b].sequence);
+        // odd only when the writer has come all the way round to the latest buffer again, which is then the older one
+        if (sequence & 1)
+            continue;
+        *bodies = bufferBodies(header, b);
+        *frame = header->buffers[b].frame;
+        *count = SDL_min(header->buffers[b].count, header->capacity);
+        return (sequence & SEQUENCE_MASK) | b;
+    }
+    return -1;
+}
+
+// false if the frame was overwritten while it was read, in which case what was read should be thrown away
+SDL_bool StateExport_EndRead(const STATE_EXPORT_HEADER *header, int ticket)
+{
+    SDL_MemoryBarrierAcquire();
+    return (loadShared(&header->buffers[ticket & 1].sequence) & SEQUENCE_MASK) == (ticket & ~1);
+}
+
+// a plain load then a barrier, as the reader's mapping is read-only and SDL_AtomicGet may write to make its load atomic
+int loadShared(const SDL_atomic_t *atomic)
+{
+    int value = *(const volatile int *)&atomic->value;
+    SDL_MemoryBarrierAcquire();
+    return value;
+}
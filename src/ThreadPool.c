@@ -0,0 +1,131 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "ThreadPool.h"
+
+#define CHUNKS_PER_THREAD 4
+
+struct THREAD_POOL
+{
+    SDL_Thread **workers;
+    int num_workers;
+    SDL_mutex *mutex;
+    SDL_cond *work_ready, *work_done;
+    int generation, busy_workers;
+    SDL_bool shutting_down;
+    PARALLEL_FOR_FN fn;
+    void *context;
+    int count, chunk;
+    SDL_atomic_t next_index;
+};
+
+int SDLCALL workerLoop(void *data);
+void runChunks(THREAD_POOL *pool);
+
+THREAD_POOL *ThreadPool_Init(int num_threads)
+{
+    THREAD_POOL *pool = (THREAD_POOL *)calloc(1, sizeof(THREAD_POOL));
+    if (pool == NULL)
+        return NULL;
+    pool->mutex = SDL_CreateMutex();
+    pool->work_ready = SDL_CreateCond();
+    pool->work_done = SDL_CreateCond();
+    // the calling thread takes part in every loop, so it counts as one of the threads
+    pool->num_workers = num_threads > 1 ? num_threads - 1 : 0;
+    pool->workers = (SDL_Thread **)calloc(pool->num_workers + 1, sizeof(SDL_Thread *));
+    for (int i = 0; i < pool->num_workers; i++)
+    {
+        pool->workers[i] = SDL_CreateThread(workerLoop, "worker thread", pool);
+        if (pool->workers[i] == NULL)
+        {
+            fprintf(stderr, "THREAD CREATION FAILED in %s: %s\n", __func__, SDL_GetError());
+            pool->num_workers = i;
+            break;
+        }
+    }
+    return pool;
+}
+
+int ThreadPool_Size(THREAD_POOL *pool)
+{
+    return pool == NULL ? 1 : pool->num_workers + 1;
+}
+
+void ThreadPool_ParallelFor(THREAD_POOL *pool, int count, int min_chunk, PARALLEL_FOR_FN fn, void *context)
+{
+    if (count <= 0)
+        return;
+    if (min_chunk < 1)
+        min_chunk = 1;
+    if (pool == NULL || pool->num_workers == 0 || count <= min_chunk)
+    {
+        fn(context, 0, count);
+        return;
+    }
+
+    SDL_LockMutex(pool->mutex);
+    pool->fn = fn;
+    pool->context = context;
+    pool->count = count;
+    pool->chunk = SDL_max(min_chunk, count / (ThreadPool_Size(pool) * CHUNKS_PER_THREAD));
+    SDL_AtomicSet(&pool->next_index, 0);
+    pool->busy_workers = pool->num_workers;
+    pool->generation++;
+    SDL_CondBroadcast(pool->work_ready);
+    SDL_UnlockMutex(pool->mutex);
+
+    runChunks(pool);
+
+    SDL_LockMutex(pool->mutex);
+    while (pool->busy_workers > 0)
+        SDL_CondWait(pool->work_done, pool->mutex);
+    SDL_UnlockMutex(pool->mutex);
+}
+
+void ThreadPool_Free(THREAD_POOL *pool)
+{
+    if (pool == NULL)
+        return;
+    SDL_LockMutex(pool->mutex);
+    pool->shutting_down = SDL_TRUE;
+    SDL_CondBroadcast(pool->work_ready);
+    SDL_UnlockMutex(pool->mutex);
+    for (int i = 0; i < pool->num_workers; i++)
+        SDL_WaitThread(pool->workers[i], NULL);
+    SDL_DestroyCond(pool->work_ready);
+    SDL_DestroyCond(pool->work_done);
+    SDL_DestroyMutex(pool->mutex);
+    free(pool->workers);
+    free(pool);
+}
+
+int SDLCALL workerLoop(void *data)
+{
+    THREAD_POOL *pool = (THREAD_POOL *)data;
+    int seen_generation = 0;
+    SDL_LockMutex(pool->mutex);
+    while (SDL_TRUE)
+    {
+        while (pool->generation == seen_generation && !pool->shutting_down)
+            SDL_CondWait(pool->work_ready, pool->mutex);
+        if (pool->shutting_down)
+            break;
+        seen_generation = pool->generation;
+        SDL_UnlockMutex(pool->mutex);
+
+        runChunks(pool);
+
+        SDL_LockMutex(pool->mutex);
+        if (--pool->busy_workers == 0)
+            SDL_CondSignal(pool->work_done);
+    }
+    SDL_UnlockMutex(pool->mutex);
+    return 0;
+}
+
+void runChunks(THREAD_POOL *pool)
+{
+    int begin;
+    while ((begin = SDL_AtomicAdd(&pool->next_index, pool->chunk)) < pool->count)
+        pool->fn(pool->context, begin, SDL_min(begin + pool->chunk, pool->count));
+}
@@ -1,14 +1,14 @@
 #include "Vector2D.h"
 #include <math.h>
 
-double Vector2D_Magnitude(VECTOR_2D v)
+REAL Vector2D_Magnitude(VECTOR_2D v)
 {
-    return sqrt(v.x * v.x + v.y * v.y);
+    return REAL_SQRT(v.x * v.x + v.y * v.y);
 }
 
 VECTOR_2D Vector2D_Normalised(VECTOR_2D v)
 {
-    double mag = Vector2D_Magnitude(v);
+    REAL mag = Vector2D_Magnitude(v);
     if (mag == 0)
         return (VECTOR_2D){0, 0};
     return (VECTOR_2D){
@@ -33,7 +33,7 @@ VECTOR_2D Vector2D_Difference(VECTOR_2D v1, VECTOR_2D v2)
     };
 }
 
-VECTOR_2D Vector2D_ScalarProduct(VECTOR_2D v, double c)
+VECTOR_2D Vector2D_ScalarProduct(VECTOR_2D v, REAL c)
 {
     return (VECTOR_2D){
         .x = v.x * c,
@@ -41,7 +41,7 @@ VECTOR_2D Vector2D_ScalarProduct(VECTOR_2D v, double c)
     };
 }
 
-double Vector2D_DotProduct(VECTOR_2D v1, VECTOR_2D v2)
+REAL Vector2D_DotProduct(VECTOR_2D v1, VECTOR_2D v2)
 {
     return v1.x * v2.x + v1.y * v2.y;
 }
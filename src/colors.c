@@ -1,6 +1,4 @@
 #include "colors.h"
-#include <time.h>
-#include <stdlib.h>
 
 const RGB24 RGB_BLACK = {0, 0, 0};
 const RGB24 RGB_RED = {255, 0, 0};
@@ -11,30 +9,25 @@ const RGB24 RGB_CYAN = {0, 255, 255};
 const RGB24 RGB_MAGENTA = {255, 0, 255};
 const RGB24 RGB_WHITE = {255, 255, 255};
 
-int getRandNumInRange(int low, int high)
-{
-    return low + rand() % (high - low);
-}
-
-void UCHAR_FisherYatesShuffle(unsigned char *arr, int n)
+void UCHAR_FisherYatesShuffle(RANDOM *rng, unsigned char *arr, int n)
 {
     for (int i = n - 1; i > 0; i--)
     {
-        int j = rand() % (i + 1);
+        int j = Random_Range(rng, 0, i + 1);
         unsigned char temp = arr[i];
         arr[i] = arr[j];
         arr[j] = temp;
     }
 }
 
-RGB24 generateVividColor()
+RGB24 generateVividColor(RANDOM *rng)
 {
     unsigned char bands[3];
-    bands[0] = getRandNumInRange(0, 64);
-    bands[1] = getRandNumInRange(64, 128);
-    bands[2] = getRandNumInRange(128, 256);
+    bands[0] = Random_Range(rng, 0, 64);
+    bands[1] = Random_Range(rng, 64, 128);
+    bands[2] = Random_Range(rng, 128, 256);
 
-    UCHAR_FisherYatesShuffle(bands, 3);
+    UCHAR_FisherYatesShuffle(rng, bands, 3);
 
     RGB24 color;
     color.r = bands[0];
@@ -0,0 +1,269 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <math.h>
+#include <string.h>
+#include <signal.h>
+#include "Engine2D.h"
+#include "Ensemble.h"
+#include "ControlServer.h"
+
+#define WINDOW_WIDTH 1280
+#define WINDOW_HEIGHT 720
+#define FRAMES_PER_SEC 30
+#define MIN_RADIUS 8
+#define MAX_RADIUS 16
+#define STARTUP_OBJECTS 48
+#define LOG_FILE "log.txt"
+#define LOG_INTERVAL_SECS 1
+#define DEFAULT_SPEED 196
+#define STARTUP_FRAMES 5
+#define HISTORY_BUDGET_MB 256
+#define ZOOM_STEP 1.25
+
+int runReplay(int argc, char *argv[]);
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "ensemble") == 0)
+        return Ensemble_Main(argc - 1, argv + 1);
+    if (argc > 1 && strcmp(argv[1], "replay") == 0)
+        return runReplay(argc - 1, argv + 1);
+
+    Uint64 engine_start = SDL_GetPerformanceCounter();
+    int flags = ELASTIC_COLLISION | STARTUP_MOVE | BOUNDING_BOX | ENABLE_INPUT | SPATIAL_SORT;
+    double dt = 1.0 / FRAMES_PER_SEC;
+    uint64_t seed = time(NULL);
+    char *record_path = NULL;
+    char *capture_path = NULL;
+    char *script_path = NULL;
+    char *control_path = NULL;
+    char *export_name = NULL;
+    int capture_interval = 1, capture_throttle = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        unsigned long long seed_arg;
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc && sscanf(argv[i + 1], "%llu", &seed_arg) == 1)
+        {
+            seed = seed_arg;
+            flags |= DETERMINISTIC;
+            i++;
+        }
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            record_path = argv[++i];
+        else if (strcmp(argv[i], "--script") == 0 && i + 1 < argc)
+            script_path = argv[++i];
+        else if (strcmp(argv[i], "--control") == 0 && i + 1 < argc)
+            control_path = argv[++i];
+        else if (strcmp(argv[i], "--export") == 0 && i + 1 < argc)
+            export_name = argv[++i];
+        else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+            capture_path = argv[++i];
+        else if (strcmp(argv[i], "--capture-every") == 0 && i + 1 < argc && sscanf(argv[i + 1], "%d", &capture_interval) == 1 &&
+                 capture_interval >= 1)
+            i++;
+        else if (strcmp(argv[i], "--capture-throttle") == 0)
+            capture_throttle = 1;
+        else
+        {
+            printf("Usage: %s [--seed NUM] [--record FILE] [--script FILE] [--control SOCKET] [--export NAME] [--capture FILE|'|COMMAND'] [--capture-every NUM] [--capture-throttle]\n"
+                   "       %s replay FILE [--threads NUM]\n"
+                   "       %s ensemble [OPTION]...\n",
+                   argv[0], argv[0], argv[0]);
+            return 1;
+        }
+    }
+    printf("Seed: %llu\n", (unsigned long long)seed);
+    SDL_Init(SDL_INIT_EVERYTHING);
+    SDL_Window *window = SDL_CreateWindow(
+        "Physics Engine",
+        SDL_WINDOWPOS_CENTERED,
+        SDL_WINDOWPOS_CENTERED,
+        WINDOW_WIDTH,
+        WINDOW_HEIGHT,
+        0);
+    SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    SDL_mutex *shared_state_mutex = SDL_CreateMutex();
+    FILE *log_file = NULL;
+    if (flags & ENABLE_LOGGING)
+        log_file = fopen(LOG_FILE, "w");
+
+    ENGINE_2D_CONFIG config = Engine2D_DefaultConfig();
+    config.world_width = WINDOW_WIDTH;
+    config.world_height = WINDOW_HEIGHT;
+    // the world only has edges with the bounding box on, objects that leave the window can be found with the camera
+    config.buffer_zone = INFINITY;
+    config.seed = seed;
+    config.history_budget = (size_t)HISTORY_BUDGET_MB * 1024 * 1024;
+    ENGINE_2D *engine = Engine2D_InitWithConfig(config, renderer, shared_state_mutex, log_file, FRAMES_PER_SEC, flags);
+    if (record_path != NULL && Engine2D_StartRecording(engine, record_path) != 0)
+        record_path = NULL;
+    if (capture_path != NULL)
+    {
+#ifdef SIGPIPE
+        // a capture command that exits early should end the recording, not the program
+        signal(SIGPIPE, SIG_IGN);
+#endif
+        Engine2D_StartCapture(engine, capture_path, capture_interval, capture_throttle);
+    }
+    if (export_name != NULL)
+        Engine2D_StartExport(engine, export_name);
+
+    RANDOM *rng = Engine2D_GetRandom(engine);
+    int spawn_moving = (flags & STARTUP_MOVE) != 0;
+    for (int i = 0; i < STARTUP_OBJECTS; i++)
+    {
+        int radius = Random_Range(rng, MIN_RADIUS, MAX_RADIUS);
+        PHYS_BODY phys_comp = {
+            .mass = M_PI * radius * radius * config.density,
+            .pos = {
+                .x = Random_Range(rng, 0, WINDOW_WIDTH),
+                .y = Random_Range(rng, 0, WINDOW_HEIGHT),
+            },
+            .vel = {
+                .x = (2 * Random_Unit(rng) - 1) * DEFAULT_SPEED * spawn_moving,
+                .y = (2 * Random_Unit(rng) - 1) * DEFAULT_SPEED * spawn_moving,
+            },
+        };
+        Engine2D_CreateCircleObject(engine, generateVividColor(rng), radius, phys_comp);
+    }
+    // a script can start with 'clear' to set up its scene on its own
+    if (script_path != NULL)
+        Engine2D_RunScript(engine, script_path);
+    CONTROL_SERVER *control = control_path != NULL ? ControlServer_Start(engine, control_path) : NULL;
+
+    int frames = 0, frames_over_dt = 0;
+    double frame_time_sum = 0, max_frame_time = 0, min_frame_time = dt;
+    SDL_bool application_running = SDL_TRUE;
+    while (application_running)
+    {
+        Uint64 frame_start = SDL_GetPerformanceCounter();
+        SDL_Event event;
+        while (SDL_PollEvent(&event))
+        {
+            switch (event.type)
+            {
+            case SDL_QUIT:
+                application_running = SDL_FALSE;
+                break;
+            case SDL_MOUSEBUTTONDOWN:
+                if (event.button.button == SDL_BUTTON_LEFT)
+                {
+                    VECTOR_2D point = {event.button.x, event.button.y};
+                    int id = Engine2D_FindCircleAt(engine, Engine2D_ScreenToWorld(engine, point));
+                    if (id != 0)
+                    {
+                        printf("ID: %d\n", id);
+                        fflush(stdout);
+                    }
+                }
+                break;
+            case SDL_MOUSEMOTION:
+                // dragging with the right button pans the camera
+                if (event.motion.state & SDL_BUTTON_RMASK)
+                    Engine2D_PanCamera(engine, (VECTOR_2D){event.motion.xrel, event.motion.yrel});
+                break;
+            case SDL_MOUSEWHEEL:
+            {
+                int x, y;
+                SDL_GetMouseState(&x, &y);
+                Engine2D_ZoomCamera(engine, (VECTOR_2D){x, y}, pow(ZOOM_STEP, event.wheel.y));
+                break;
+            }
+            }
+        }
+        // a paused engine still draws, so steps and rewinds show up
+        SDL_bool paused = (Engine2D_GetFlags(engine) & PAUSED) != 0;
+        SDL_SetRenderDrawColor(renderer, RGB_BLACK.r, RGB_BLACK.g, RGB_BLACK.b, SDL_ALPHA_OPAQUE);
+        SDL_RenderClear(renderer);
+        Engine2D_RunSimulation(engine);
+        SDL_RenderPresent(renderer);
+        if (paused)
+        {
+            SDL_Delay(dt * 1000);
+            continue;
+        }
+        frames++;
+        if (log_file != NULL && frames % (LOG_INTERVAL_SECS * FRAMES_PER_SEC) == 0)
+            Engine2D_LogObjects(engine);
+        Uint64 frame_end = SDL_GetPerformanceCounter();
+        double frame_time = (double)(frame_end - frame_start) / SDL_GetPerformanceFrequency();
+        if (frames > STARTUP_FRAMES)
+        {
+            frame_time_sum += frame_time;
+            if (frame_time < min_frame_time)
+                min_frame_time = frame_time;
+            if (frame_time > max_frame_time)
+                max_frame_time = frame_time;
+        }
+        if (frame_time < dt)
+            SDL_Delay((dt - frame_time) * 1000);
+        else
+            frames_over_dt++;
+    }
+
+    Uint64 engine_end = SDL_GetPerformanceCounter();
+    printf("Time passed:\t%.2lf s\n", (double)(engine_end - engine_start) / SDL_GetPerformanceFrequency());
+    printf("No. of frames:\t%d\n", frames);
+    printf("Frames over dt:\t%d\n", frames_over_dt);
+    printf("After excluding %d frames during startup:\n", STARTUP_FRAMES);
+    printf("Avg. Frame Time: %.2lf ms\n", frame_time_sum / (frames - STARTUP_FRAMES) * 1000);
+    printf("Min. Frame Time: %.2lf ms\n", min_frame_time * 1000);
+    printf("Max. Frame Time: %.2lf ms\n", max_frame_time * 1000);
+
+    ControlServer_Stop(control);
+    Engine2D_Free(engine);
+    if (log_file != NULL)
+        fclose(log_file);
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyMutex(shared_state_mutex);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return 0;
+}
+
+// steps a recorded session headless as fast as possible and checks it ends in the recorded state
+int runReplay(int argc, char *argv[])
+{
+    int num_threads = 0;
+    if (argc < 2 || strcmp(argv[1], "--help") == 0 ||
+        (argc > 2 && (argc != 4 || strcmp(argv[2], "--threads") != 0 || sscanf(argv[3], "%d", &num_threads) != 1)))
+    {
+        printf("Usage: replay FILE [--threads NUM]\n"
+               "Step the session recorded in FILE without a window and compare the final state with the recording.\n");
+        return argc < 2 || strcmp(argv[1], "--help") != 0;
+    }
+    SDL_mutex *shared_state_mutex = SDL_CreateMutex();
+    ENGINE_2D *engine = Engine2D_LoadReplay(argv[1], NULL, shared_state_mutex, num_threads);
+    if (engine == NULL)
+    {
+        SDL_DestroyMutex(shared_state_mutex);
+        return 1;
+    }
+    int frames = 0;
+    uint64_t recorded_checksum;
+    Uint64 start = SDL_GetPerformanceCounter();
+    while (!Engine2D_IsReplayFinished(engine, &recorded_checksum))
+    {
+        Engine2D_RunSimulation(engine);
+        frames++;
+    }
+    double elapsed = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+    uint64_t checksum = Engine2D_Checksum(engine);
+    printf("Replayed %d frames in %.2lf s (%.1lf frames/s)\n", frames, elapsed, elapsed > 0 ? frames / elapsed : 0);
+    int status = 0;
+    if (recorded_checksum == 0)
+        printf("Recording has no final state to compare against, state checksum: %016llx\n", (unsigned long long)checksum);
+    else if (checksum == recorded_checksum)
+        printf("Final state matches the recording: %016llx\n", (unsigned long long)checksum);
+    else
+    {
+        printf("Final state differs from the recording: %016llx, expected %016llx\n",
+               (unsigned long long)checksum, (unsigned long long)recorded_checksum);
+        status = 1;
+    }
+    Engine2D_Free(engine);
+    SDL_DestroyMutex(shared_state_mutex);
+    return status;
+}